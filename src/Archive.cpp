@@ -0,0 +1,264 @@
+#include "Archive.h"
+
+#include <cstring>
+#include "DirectoryWatcher.h"
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+const size_t kTarBlock = 512;
+
+// Directories and names DirectoryWatcher would not pick up either.
+bool Ignored(const std::string& name)
+{
+    size_t slash = name.rfind('/');
+    return name.empty() || name.back() == '/'
+        || !IsCandidateFileName(slash == std::string::npos ? name : name.substr(slash + 1));
+}
+
+std::string FieldString(const uint8_t* field, size_t size)
+{
+    return std::string(reinterpret_cast<const char*>(field), strnlen(reinterpret_cast<const char*>(field), size));
+}
+
+// Octal, or base-256 when the high bit of the first octet is set.
+uint64_t TarNumber(const uint8_t* field, size_t size)
+{
+    uint64_t value = 0;
+    if (field[0] & 0x80) {
+        value = field[0] & 0x7F;
+        for (size_t i = 1; i < size; i++) {
+            value = value << 8 | field[i];
+        }
+        return value;
+    }
+    for (size_t i = 0; i < size && field[i] != 0; i++) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = value * 8 + (field[i] - '0');
+        }
+        else if (field[i] != ' ') {
+            break;
+        }
+    }
+    return value;
+}
+
+// "length key=value\n" records of a pax extended header.
+std::string PaxPath(ByteView header)
+{
+    std::string path;
+    size_t offset = 0;
+    while (offset < header.size) {
+        size_t space = offset;
+        uint64_t length = 0;
+        while (space < header.size && header[space] >= '0' && header[space] <= '9' && length <= header.size) {
+            length = length * 10 + (header[space++] - '0');
+        }
+        // the length covers its own digits, the space and the newline
+        if (space >= header.size || header[space] != ' ' || length < space - offset + 2
+            || length > header.size - offset || header[offset + length - 1] != '\n') {
+            throw Tap3Error("Bad pax header");
+        }
+        std::string record(reinterpret_cast<const char*>(header.data) + space + 1, offset + length - space - 2);
+        if (record.compare(0, 5, "path=") == 0) {
+            path = record.substr(5);
+        }
+        offset += length;
+    }
+    return path;
+}
+
+uint16_t Le16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+uint32_t Le32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16
+        | static_cast<uint32_t>(p[3]) << 24;
+}
+
+uint64_t Le64(const uint8_t* p)
+{
+    return static_cast<uint64_t>(Le32(p)) | static_cast<uint64_t>(Le32(p + 4)) << 32;
+}
+
+const uint32_t kZipLocalHeader = 0x04034B50;
+const uint32_t kZipCentralHeader = 0x02014B50;
+const uint32_t kZipEnd = 0x06054B50;
+const uint32_t kZip64EndLocator = 0x07064B50;
+const uint32_t kZip64End = 0x06064B50;
+const size_t kZipEndSize = 22;
+
+void CheckRange(ByteView archive, uint64_t offset, uint64_t length, const char* what)
+{
+    if (offset > archive.size || length > archive.size - offset) {
+        throw Tap3Error(std::string("Zip archive truncated in ") + what);
+    }
+}
+
+} // namespace
+
+bool IsTarArchive(ByteView archive)
+{
+    return archive.size >= kTarBlock && memcmp(archive.data + 257, "ustar", 5) == 0;
+}
+
+bool IsZipArchive(ByteView archive)
+{
+    return archive.size >= 4 && (Le32(archive.data) == kZipLocalHeader || Le32(archive.data) == kZipEnd);
+}
+
+void ListTarMembers(ByteView archive, std::vector<ArchiveMember>& members)
+{
+    std::string longName;       // from a GNU 'L' or pax header, for the next member
+    uint64_t offset = 0;
+    while (offset + kTarBlock <= archive.size) {
+        const uint8_t* header = archive.data + offset;
+        if (header[0] == 0) {
+            break;      // end-of-archive blocks
+        }
+        if (memcmp(header + 257, "ustar", 5) != 0) {
+            throw Tap3Error("Bad tar header at offset " + std::to_string(offset));
+        }
+        uint64_t size = TarNumber(header + 124, 12);
+        uint64_t dataOffset = offset + kTarBlock;
+        if (size > archive.size - dataOffset) {
+            throw Tap3Error("Tar archive truncated in member at offset " + std::to_string(offset));
+        }
+        ByteView data = archive.Sub(dataOffset, size);
+        char type = static_cast<char>(header[156]);
+        if (type == 'L') {
+            longName = FieldString(data.data, data.size);
+        }
+        else if (type == 'x') {
+            longName = PaxPath(data);
+        }
+        else {
+            if (type == '0' || type == '\0' || type == '7') {
+                std::string name = longName;
+                if (name.empty()) {
+                    std::string prefix = FieldString(header + 345, 155);
+                    name = FieldString(header, 100);
+                    if (!prefix.empty()) {
+                        name = prefix + "/" + name;
+                    }
+                }
+                if (!Ignored(name)) {
+                    ArchiveMember member;
+                    member.name = name;
+                    member.data = data;
+                    member.size = size;
+                    members.push_back(member);
+                }
+            }
+            longName.clear();
+        }
+        offset = dataOffset + (size + kTarBlock - 1) / kTarBlock * kTarBlock;
+    }
+}
+
+void ListZipMembers(ByteView archive, std::vector<ArchiveMember>& members)
+{
+    // the end record is followed by a comment of up to 64 KB
+    if (archive.size < kZipEndSize) {
+        throw Tap3Error("Zip archive too short");
+    }
+    size_t end = archive.size - kZipEndSize;
+    size_t stop = archive.size > kZipEndSize + 0xFFFF ? archive.size - kZipEndSize - 0xFFFF : 0;
+    while (Le32(archive.data + end) != kZipEnd) {
+        if (end == stop) {
+            throw Tap3Error("Zip end of central directory not found");
+        }
+        end--;
+    }
+    uint64_t count = Le16(archive.data + end + 10);
+    uint64_t directorySize = Le32(archive.data + end + 12);
+    uint64_t directoryOffset = Le32(archive.data + end + 16);
+    if (end >= 20 && Le32(archive.data + end - 20) == kZip64EndLocator) {
+        uint64_t end64 = Le64(archive.data + end - 20 + 8);
+        CheckRange(archive, end64, 56, "zip64 end record");
+        if (Le32(archive.data + end64) != kZip64End) {
+            throw Tap3Error("Bad zip64 end of central directory");
+        }
+        count = Le64(archive.data + end64 + 32);
+        directorySize = Le64(archive.data + end64 + 40);
+        directoryOffset = Le64(archive.data + end64 + 48);
+    }
+    CheckRange(archive, directoryOffset, directorySize, "central directory");
+
+    uint64_t offset = directoryOffset;
+    for (uint64_t i = 0; i < count; i++) {
+        CheckRange(archive, offset, 46, "central directory");
+        const uint8_t* entry = archive.data + offset;
+        if (Le32(entry) != kZipCentralHeader) {
+            throw Tap3Error("Bad zip central directory entry " + std::to_string(i));
+        }
+        uint16_t flags = Le16(entry + 8);
+        uint16_t method = Le16(entry + 10);
+        uint64_t compressedSize = Le32(entry + 20);
+        uint64_t size = Le32(entry + 24);
+        uint16_t nameLength = Le16(entry + 28);
+        uint16_t extraLength = Le16(entry + 30);
+        uint16_t commentLength = Le16(entry + 32);
+        uint64_t localOffset = Le32(entry + 42);
+        CheckRange(archive, offset + 46, nameLength + extraLength, "central directory");
+        std::string name(reinterpret_cast<const char*>(entry + 46), nameLength);
+
+        // zip64 extended information: the values saturated above, in order
+        const uint8_t* extra = entry + 46 + nameLength;
+        for (size_t pos = 0; pos + 4 <= extraLength;) {
+            uint16_t id = Le16(extra + pos);
+            uint16_t length = Le16(extra + pos + 2);
+            if (pos + 4 + length > extraLength) {
+                break;
+            }
+            if (id == 0x0001) {
+                const uint8_t* field = extra + pos + 4;
+                const uint8_t* fieldEnd = field + length;
+                if (size == 0xFFFFFFFF && field + 8 <= fieldEnd) {
+                    size = Le64(field);
+                    field += 8;
+                }
+                if (compressedSize == 0xFFFFFFFF && field + 8 <= fieldEnd) {
+                    compressedSize = Le64(field);
+                    field += 8;
+                }
+                if (localOffset == 0xFFFFFFFF && field + 8 <= fieldEnd) {
+                    localOffset = Le64(field);
+                }
+            }
+            pos += 4 + length;
+        }
+        offset += 46 + nameLength + extraLength + commentLength;
+        if (Ignored(name)) {
+            continue;
+        }
+        if (flags & 1) {
+            throw Tap3Error("Zip member " + name + " is encrypted");
+        }
+        if (method != 0 && method != 8) {
+            throw Tap3Error("Zip member " + name + " uses unsupported compression method "
+                + std::to_string(method));
+        }
+        CheckRange(archive, localOffset, 30, "local header");
+        const uint8_t* local = archive.data + localOffset;
+        if (Le32(local) != kZipLocalHeader) {
+            throw Tap3Error("Bad zip local header for " + name);
+        }
+        uint64_t dataOffset = localOffset + 30 + Le16(local + 26) + Le16(local + 28);
+        CheckRange(archive, dataOffset, compressedSize, "member data");
+
+        ArchiveMember member;
+        member.name = name;
+        member.data = archive.Sub(dataOffset, compressedSize);
+        member.format = method == 8 ? MappedFile::Format::Deflate : MappedFile::Format::Plain;
+        member.size = size;
+        members.push_back(member);
+    }
+}
+
+} // namespace tap3
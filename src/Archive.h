@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ByteView.h"
+#include "MappedFile.h"
+
+namespace tap3 {
+
+// One file stored in an archive. data points into the archive mapping.
+struct ArchiveMember
+{
+    std::string name;
+    ByteView data;                      // as stored, possibly compressed
+    MappedFile::Format format = MappedFile::Format::Plain;  // Deflate for deflated zip members
+    uint64_t size = 0;                  // uncompressed size when the archive records it
+};
+
+// Archive formats recognised by their contents.
+bool IsTarArchive(ByteView archive);
+bool IsZipArchive(ByteView archive);
+
+// Lists the regular files of a ustar/GNU/pax tar archive. Directories,
+// links and names IsCandidateFileName rejects are left out, in both
+// formats.
+void ListTarMembers(ByteView archive, std::vector<ArchiveMember>& members);
+
+// Lists the files of a zip archive (zip64 included) from its central
+// directory. Members must be stored or deflated and not encrypted.
+void ListZipMembers(ByteView archive, std::vector<ArchiveMember>& members);
+
+} // namespace tap3
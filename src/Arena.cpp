@@ -0,0 +1,77 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace tap3 {
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(blockSize), m_currentBlock(0), m_current(0), m_end(0)
+{
+}
+
+Arena::~Arena()
+{
+    for (const Block& block : m_blocks) {
+        free(block.data);
+    }
+}
+
+void Arena::UseBlock(size_t index)
+{
+    m_currentBlock = index;
+    m_current = reinterpret_cast<uintptr_t>(m_blocks[index].data);
+    m_end = m_current + m_blocks[index].size;
+}
+
+void* Arena::AllocateSlow(size_t size, size_t alignment)
+{
+    // try the blocks kept from before the last Reset()
+    size_t index = m_blocks.empty() ? 0 : m_currentBlock + 1;
+    for (; index < m_blocks.size(); index++) {
+        if (m_blocks[index].size >= size + alignment) {
+            std::swap(m_blocks[index], m_blocks[m_currentBlock + 1]);
+            UseBlock(m_currentBlock + 1);
+            return Allocate(size, alignment);
+        }
+    }
+    size_t blockSize = std::max(m_blockSize, size + alignment);
+    Block block = { static_cast<uint8_t*>(malloc(blockSize)), blockSize };
+    if (!block.data) {
+        throw std::bad_alloc();
+    }
+    m_blocks.push_back(block);
+    std::swap(m_blocks.back(), m_blocks[m_blocks.size() == 1 ? 0 : m_currentBlock + 1]);
+    UseBlock(m_blocks.size() == 1 ? 0 : m_currentBlock + 1);
+    return Allocate(size, alignment);
+}
+
+void Arena::Reset()
+{
+    if (!m_blocks.empty()) {
+        UseBlock(0);
+    }
+}
+
+void Arena::Release()
+{
+    for (size_t i = 1; i < m_blocks.size(); i++) {
+        free(m_blocks[i].data);
+    }
+    if (!m_blocks.empty()) {
+        m_blocks.resize(1);
+        UseBlock(0);
+    }
+}
+
+size_t Arena::BytesReserved() const
+{
+    size_t total = 0;
+    for (const Block& block : m_blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+} // namespace tap3
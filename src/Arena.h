@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+#include "ByteView.h"
+
+namespace tap3 {
+
+// Monotonic allocator for objects that live no longer than the decode of
+// one file. Memory comes from large blocks and individual objects are never
+// freed: Reset() rewinds to the first block keeping all blocks for reuse,
+// Release() returns every block except the first to the system. Not
+// thread-safe; each decoding thread uses its own arena.
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 1 << 20);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        uintptr_t p = (m_current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (p + size > m_end) {
+            return AllocateSlow(size, alignment);
+        }
+        m_current = p + size;
+        return reinterpret_cast<void*>(p);
+    }
+
+    template <typename T, typename... Args>
+    T* New(Args&&... args)
+    {
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copy of an octet string whose source buffer may not outlive the decode.
+    ByteView Copy(ByteView value)
+    {
+        if (value.size == 0) {
+            return ByteView();
+        }
+        uint8_t* data = static_cast<uint8_t*>(Allocate(value.size, 1));
+        memcpy(data, value.data, value.size);
+        return ByteView(data, value.size);
+    }
+
+    void Reset();
+    void Release();
+
+    size_t BytesReserved() const;
+
+private:
+    struct Block
+    {
+        uint8_t* data;
+        size_t size;
+    };
+
+    void* AllocateSlow(size_t size, size_t alignment);
+    void UseBlock(size_t index);
+
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    size_t m_currentBlock;
+    uintptr_t m_current;
+    uintptr_t m_end;
+};
+
+// STL allocator drawing from an Arena; deallocation is a no-op.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(Arena& arena) : m_arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.GetArena()) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(m_arena->Allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    Arena* GetArena() const { return m_arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.GetArena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return m_arena != other.GetArena(); }
+
+private:
+    Arena* m_arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace tap3
@@ -0,0 +1,110 @@
+#include "ArrayBindSink.h"
+
+#include <algorithm>
+#include "Tbcd.h"
+
+namespace tap3 {
+
+void BindBuffer::Resize(size_t capacity)
+{
+    recordType.resize(capacity);
+    recordOffset.resize(capacity);
+    localTimeStamp.resize(capacity);
+    utcTimeOffsetCode.resize(capacity);
+    startTimeUtc.resize(capacity);
+    recEntityCode.resize(capacity);
+    exchangeRateCode.resize(capacity);
+    duration.resize(capacity);
+    charge.resize(capacity);
+    chargeLocal.resize(capacity);
+    chargeableUnits.resize(capacity);
+    taxValue.resize(capacity);
+    discountValue.resize(capacity);
+    dataVolumeIncoming.resize(capacity);
+    dataVolumeOutgoing.resize(capacity);
+    imsi.Resize(capacity);
+    msisdn.Resize(capacity);
+    imei.Resize(capacity);
+    otherParty.Resize(capacity);
+}
+
+ArrayBindSink::ArrayBindSink(size_t batchSize, const Projection& projection)
+    : m_batchSize(batchSize > 0 ? batchSize : 1), m_projection(projection)
+{
+    m_buffer.Resize(m_batchSize);
+}
+
+void ArrayBindSink::WriteEvents(const EventBatch& batch)
+{
+    for (size_t t = 0; t < kCallEventTypeCount; t++) {
+        CallEventType type = static_cast<CallEventType>(t);
+        if (!m_projection.Loads(type)) {
+            continue;
+        }
+        const EventColumns& columns = batch.Columns(type);
+        size_t first = 0;
+        while (first < columns.Size()) {
+            size_t count = std::min(columns.Size() - first, m_batchSize - m_buffer.rows);
+            AppendRows(type, columns, first, count);
+            first += count;
+            if (m_buffer.rows == m_batchSize) {
+                Flush();
+            }
+        }
+    }
+    const ChargeColumns& charges = batch.Charges();
+    for (size_t first = 0; first < charges.Size(); first += m_batchSize) {
+        ExecuteChargeArray(charges, first, std::min(m_batchSize, charges.Size() - first));
+    }
+    const TaxColumns& taxes = batch.Taxes();
+    for (size_t first = 0; first < taxes.Size(); first += m_batchSize) {
+        ExecuteTaxArray(taxes, first, std::min(m_batchSize, taxes.Size() - first));
+    }
+}
+
+void ArrayBindSink::Flush()
+{
+    if (m_buffer.rows > 0) {
+        ExecuteArray(m_buffer);
+        m_buffer.rows = 0;
+    }
+}
+
+void ArrayBindSink::AppendRows(CallEventType type, const EventColumns& columns, size_t first, size_t count)
+{
+    BindBuffer& b = m_buffer;
+    size_t row = b.rows;
+    std::fill_n(b.recordType.begin() + row, count, static_cast<int32_t>(type));
+    std::copy_n(columns.recordOffset.begin() + first, count, b.recordOffset.begin() + row);
+    std::copy_n(columns.localTimeStamp.begin() + first, count, b.localTimeStamp.begin() + row);
+    std::copy_n(columns.utcTimeOffsetCode.begin() + first, count, b.utcTimeOffsetCode.begin() + row);
+    std::copy_n(columns.startTimeUtc.begin() + first, count, b.startTimeUtc.begin() + row);
+    std::copy_n(columns.recEntityCode.begin() + first, count, b.recEntityCode.begin() + row);
+    std::copy_n(columns.exchangeRateCode.begin() + first, count, b.exchangeRateCode.begin() + row);
+    std::copy_n(columns.duration.begin() + first, count, b.duration.begin() + row);
+    std::copy_n(columns.charge.begin() + first, count, b.charge.begin() + row);
+    std::copy_n(columns.chargeLocal.begin() + first, count, b.chargeLocal.begin() + row);
+    std::copy_n(columns.chargeableUnits.begin() + first, count, b.chargeableUnits.begin() + row);
+    std::copy_n(columns.taxValue.begin() + first, count, b.taxValue.begin() + row);
+    std::copy_n(columns.discountValue.begin() + first, count, b.discountValue.begin() + row);
+    std::copy_n(columns.dataVolumeIncoming.begin() + first, count, b.dataVolumeIncoming.begin() + row);
+    std::copy_n(columns.dataVolumeOutgoing.begin() + first, count, b.dataVolumeOutgoing.begin() + row);
+    FieldSet fields = m_projection.ColumnFields();
+    if (fields & FieldBit(EventField::Imsi)) {
+        DecodeNumberColumn(columns.imsi, first, count, NibbleOrder::LowFirst, b.imsi.At(row), b.imsi.Width());
+    }
+    if (fields & FieldBit(EventField::Msisdn)) {
+        DecodeNumberColumn(columns.msisdn, first, count, NibbleOrder::HighFirst, b.msisdn.At(row),
+            b.msisdn.Width());
+    }
+    if (fields & FieldBit(EventField::Imei)) {
+        DecodeNumberColumn(columns.imei, first, count, NibbleOrder::HighFirst, b.imei.At(row), b.imei.Width());
+    }
+    if (fields & FieldBit(EventField::OtherParty)) {
+        DecodeNumberColumn(columns.otherParty, first, count, NibbleOrder::HighFirst,
+            b.otherParty.At(row), b.otherParty.Width());
+    }
+    b.rows += count;
+}
+
+} // namespace tap3
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include "EventSink.h"
+#include "Projection.h"
+
+namespace tap3 {
+
+// Fixed-width zero-terminated strings laid out for array binding.
+class FixedStringArray
+{
+public:
+    explicit FixedStringArray(size_t width) : m_width(width) {}
+
+    size_t Width() const { return m_width; }
+    char* At(size_t row) { return &m_data[row * m_width]; }
+    const char* At(size_t row) const { return &m_data[row * m_width]; }
+    const char* Data() const { return m_data.data(); }
+    void Resize(size_t rows) { m_data.resize(rows * m_width); }
+
+private:
+    size_t m_width;
+    std::vector<char> m_data;
+};
+
+// Bind-ready rows of the call_event table. Column arrays are sized to the
+// sink batch size once and reused for every round trip.
+struct BindBuffer
+{
+    size_t rows = 0;
+    std::vector<int32_t> recordType;
+    std::vector<int64_t> recordOffset;
+    std::vector<int64_t> localTimeStamp;
+    std::vector<int32_t> utcTimeOffsetCode;
+    std::vector<int64_t> startTimeUtc;
+    std::vector<int32_t> recEntityCode;
+    std::vector<int32_t> exchangeRateCode;
+    std::vector<int64_t> duration;
+    std::vector<int64_t> charge;
+    std::vector<int64_t> chargeLocal;
+    std::vector<int64_t> chargeableUnits;
+    std::vector<int64_t> taxValue;
+    std::vector<int64_t> discountValue;
+    std::vector<int64_t> dataVolumeIncoming;
+    std::vector<int64_t> dataVolumeOutgoing;
+    FixedStringArray imsi { 17 };
+    FixedStringArray msisdn { 21 };
+    FixedStringArray imei { 17 };
+    FixedStringArray otherParty { 41 };
+
+    void Resize(size_t capacity);
+};
+
+// Base for database sinks that insert call events with array binds.
+// Rows from incoming batches are converted into a BindBuffer and sent to
+// ExecuteArray whenever batchSize rows have accumulated, so each round trip
+// carries a full batch regardless of how the decoder chunks the file.
+// Charge and tax rows are already bind-ready and are sent straight from the
+// batch columns in slices of at most batchSize rows.
+// Only record types the projection loads are buffered, and only number
+// columns it loads are converted; the other BindBuffer arrays are left as
+// they are and must not be bound.
+class ArrayBindSink : public EventSink
+{
+public:
+    explicit ArrayBindSink(size_t batchSize, const Projection& projection = Projection());
+
+    void WriteEvents(const EventBatch& batch) override;
+
+    size_t BatchSize() const { return m_batchSize; }
+    const Projection& EventProjection() const { return m_projection; }
+
+protected:
+    // Sends buffer.rows rows to the database in one round trip.
+    virtual void ExecuteArray(const BindBuffer& buffer) = 0;
+    virtual void ExecuteChargeArray(const ChargeColumns& charges, size_t first, size_t count) = 0;
+    virtual void ExecuteTaxArray(const TaxColumns& taxes, size_t first, size_t count) = 0;
+
+    // Sends remaining buffered rows; called by implementations before commit.
+    void Flush();
+    // Drops buffered rows; called by implementations on rollback.
+    void Discard() { m_buffer.rows = 0; }
+
+private:
+    void AppendRows(CallEventType type, const EventColumns& columns, size_t first, size_t count);
+
+    size_t m_batchSize;
+    Projection m_projection;
+    BindBuffer m_buffer;
+};
+
+} // namespace tap3
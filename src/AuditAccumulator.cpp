@@ -0,0 +1,79 @@
+#include "AuditAccumulator.h"
+
+#include <algorithm>
+#include "TimeStamp.h"
+
+namespace tap3 {
+
+namespace {
+
+// DateTimeLong to UTC epoch seconds; false if absent or malformed.
+bool ToUtc(const DateTimeLong& value, int64_t& seconds)
+{
+    int32_t offset;
+    if (!ParseLocalTimeStamp(value.localTimeStamp, seconds) || !ParseUtcTimeOffset(value.utcTimeOffset, offset)) {
+        return false;
+    }
+    seconds -= offset;
+    return true;
+}
+
+void CompareValue(std::string& report, const char* name, int64_t declared, int64_t computed)
+{
+    if (declared != computed) {
+        report += std::string(report.empty() ? "" : "; ") + name + " declared " + std::to_string(declared)
+            + ", computed " + std::to_string(computed);
+    }
+}
+
+} // namespace
+
+void AuditAccumulator::Add(const EventBatch& batch)
+{
+    for (size_t t = 0; t < kCallEventTypeCount; t++) {
+        const EventColumns& columns = batch.Columns(static_cast<CallEventType>(t));
+        for (size_t i = 0; i < columns.Size(); i++) {
+            m_totalCharge += columns.charge[i];
+            m_totalTaxValue += columns.taxValue[i];
+            m_totalDiscountValue += columns.discountValue[i];
+        }
+        for (int64_t start : columns.startTimeUtc) {
+            if (start != 0) {
+                m_earliest = std::min(m_earliest, start);
+                m_latest = std::max(m_latest, start);
+            }
+        }
+    }
+}
+
+void AuditAccumulator::Merge(const AuditAccumulator& other)
+{
+    m_totalCharge += other.m_totalCharge;
+    m_totalTaxValue += other.m_totalTaxValue;
+    m_totalDiscountValue += other.m_totalDiscountValue;
+    m_recordCount += other.m_recordCount;
+    m_earliest = std::min(m_earliest, other.m_earliest);
+    m_latest = std::max(m_latest, other.m_latest);
+}
+
+std::string AuditAccumulator::Compare(const AuditControlInfo& info) const
+{
+    std::string report;
+    CompareValue(report, "TotalCharge", info.totalCharge, m_totalCharge);
+    CompareValue(report, "TotalTaxValue", info.totalTaxValue, m_totalTaxValue);
+    CompareValue(report, "TotalDiscountValue", info.totalDiscountValue, m_totalDiscountValue);
+    CompareValue(report, "CallEventDetailsCount", info.callEventDetailsCount, static_cast<int64_t>(m_recordCount));
+    // Earliest/LatestCallTimeStamp are only present when there are events.
+    int64_t declared;
+    if (m_recordCount > 0 && m_earliest <= m_latest) {
+        if (ToUtc(info.earliestCallTimeStamp, declared)) {
+            CompareValue(report, "EarliestCallTimeStamp (UTC)", declared, m_earliest);
+        }
+        if (ToUtc(info.latestCallTimeStamp, declared)) {
+            CompareValue(report, "LatestCallTimeStamp (UTC)", declared, m_latest);
+        }
+    }
+    return report;
+}
+
+} // namespace tap3
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "EventColumns.h"
+#include "Tap3Error.h"
+#include "Tap3Types.h"
+
+namespace tap3 {
+
+// AuditControlInfo totals disagree with the call events of the file.
+class AuditError : public Tap3Error
+{
+public:
+    explicit AuditError(const std::string& message) : Tap3Error(message) {}
+};
+
+// Running AuditControlInfo figures, summed from the column batches as they
+// are produced so the check at the end of the file needs no second pass.
+// Partial accumulators (one per decode chunk) are combined with Merge.
+class AuditAccumulator
+{
+public:
+    void Clear() { *this = AuditAccumulator(); }
+    void Add(const EventBatch& batch);
+    void Merge(const AuditAccumulator& other);
+    void AddRecords(uint64_t count) { m_recordCount += count; }
+    // Continues from totals saved by an earlier attempt (see LoadCheckpoint).
+    void Restore(int64_t totalCharge, int64_t totalTaxValue, int64_t totalDiscountValue, uint64_t recordCount,
+        int64_t earliest, int64_t latest)
+    {
+        m_totalCharge = totalCharge;
+        m_totalTaxValue = totalTaxValue;
+        m_totalDiscountValue = totalDiscountValue;
+        m_recordCount = recordCount;
+        m_earliest = earliest;
+        m_latest = latest;
+    }
+
+    // Describes every difference from the declared totals; empty if none.
+    // earliest/latest are compared in UTC.
+    std::string Compare(const AuditControlInfo& info) const;
+
+    int64_t TotalCharge() const { return m_totalCharge; }
+    int64_t TotalTaxValue() const { return m_totalTaxValue; }
+    int64_t TotalDiscountValue() const { return m_totalDiscountValue; }
+    uint64_t RecordCount() const { return m_recordCount; }
+    int64_t EarliestCallTime() const { return m_earliest; }
+    int64_t LatestCallTime() const { return m_latest; }
+
+private:
+    int64_t m_totalCharge = 0;
+    int64_t m_totalTaxValue = 0;
+    int64_t m_totalDiscountValue = 0;
+    uint64_t m_recordCount = 0;
+    int64_t m_earliest = INT64_MAX;
+    int64_t m_latest = INT64_MIN;
+};
+
+} // namespace tap3
@@ -0,0 +1,155 @@
+#include "BerReader.h"
+
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+const size_t kMaxLengthOctets = 8;
+const int kMaxNestingDepth = 64;
+
+size_t SkipIndefinite(ByteView data, size_t pos, int depth);
+
+// Returns total size of the TLV starting at data[pos].
+size_t TlvSize(ByteView data, size_t pos, int depth)
+{
+    BerHeader header;
+    if (ParseBerHeader(data.data + pos, data.size - pos, header, pos) == BerParseStatus::NeedMore) {
+        throw BerError("Truncated BER header", pos);
+    }
+    if (header.indefinite) {
+        return header.headerLength + SkipIndefinite(data, pos + header.headerLength, depth + 1);
+    }
+    if (header.length > data.size - pos - header.headerLength) {
+        throw BerError("BER value exceeds its container", pos);
+    }
+    return header.headerLength + header.length;
+}
+
+// Returns size of the contents of an indefinite-length value including EOC.
+size_t SkipIndefinite(ByteView data, size_t pos, int depth)
+{
+    if (depth > kMaxNestingDepth) {
+        throw BerError("BER nesting too deep", pos);
+    }
+    size_t start = pos;
+    while (pos + 2 <= data.size) {
+        if (data[pos] == 0 && data[pos + 1] == 0) {
+            return pos + 2 - start;
+        }
+        pos += TlvSize(data, pos, depth);
+    }
+    throw BerError("Missing end-of-contents octets", pos);
+}
+
+} // namespace
+
+BerParseStatus ParseBerHeader(const uint8_t* p, size_t avail, BerHeader& header, size_t baseOffset)
+{
+    if (avail < 2) {
+        return BerParseStatus::NeedMore;
+    }
+    size_t pos = 0;
+    uint8_t first = p[pos++];
+    header.tagClass = static_cast<BerClass>(first >> 6);
+    header.constructed = (first & 0x20) != 0;
+    header.tagNumber = first & 0x1F;
+    if (header.tagNumber == 0x1F) {
+        header.tagNumber = 0;
+        uint8_t b;
+        do {
+            if (pos >= avail) {
+                return BerParseStatus::NeedMore;
+            }
+            if (header.tagNumber > (0xFFFFFFFFu >> 7)) {
+                throw BerError("BER tag number too large", baseOffset);
+            }
+            b = p[pos++];
+            header.tagNumber = (header.tagNumber << 7) | (b & 0x7F);
+        } while (b & 0x80);
+    }
+    if (pos >= avail) {
+        return BerParseStatus::NeedMore;
+    }
+    uint8_t lengthOctet = p[pos++];
+    header.indefinite = false;
+    if (lengthOctet < 0x80) {
+        header.length = lengthOctet;
+    }
+    else if (lengthOctet == 0x80) {
+        if (!header.constructed) {
+            throw BerError("Indefinite length on primitive value", baseOffset);
+        }
+        header.indefinite = true;
+        header.length = 0;
+    }
+    else {
+        size_t count = lengthOctet & 0x7F;
+        if (count > kMaxLengthOctets || count == 0x7F) {
+            throw BerError("Unsupported BER length form", baseOffset);
+        }
+        if (pos + count > avail) {
+            return BerParseStatus::NeedMore;
+        }
+        uint64_t length = 0;
+        for (size_t i = 0; i < count; i++) {
+            length = (length << 8) | p[pos++];
+        }
+        header.length = static_cast<size_t>(length);
+    }
+    header.headerLength = pos;
+    return BerParseStatus::Ok;
+}
+
+size_t FindEndOfContents(ByteView data, size_t contentOffset)
+{
+    return SkipIndefinite(data, contentOffset, 0);
+}
+
+bool BerReader::Next(BerTlv& tlv)
+{
+    if (m_pos >= m_data.size) {
+        return false;
+    }
+    size_t available = m_data.size - m_pos;
+    if (available >= 2 && m_data[m_pos] == 0 && m_data[m_pos + 1] == 0) {
+        // end-of-contents of an enclosing indefinite-length value
+        m_pos = m_data.size;
+        return false;
+    }
+    BerHeader& header = tlv.header;
+    if (ParseBerHeader(m_data.data + m_pos, available, header, m_baseOffset + m_pos) == BerParseStatus::NeedMore) {
+        throw BerError("Truncated BER header", m_baseOffset + m_pos);
+    }
+    tlv.offset = m_pos;
+    size_t contentStart = m_pos + header.headerLength;
+    if (header.indefinite) {
+        size_t contentSize = SkipIndefinite(m_data, contentStart, 0);
+        tlv.value = m_data.Sub(contentStart, contentSize - 2);
+        tlv.totalLength = header.headerLength + contentSize;
+    }
+    else {
+        if (header.length > m_data.size - contentStart) {
+            throw BerError("BER value exceeds its container", m_baseOffset + m_pos);
+        }
+        tlv.value = m_data.Sub(contentStart, header.length);
+        tlv.totalLength = header.headerLength + header.length;
+    }
+    m_pos += tlv.totalLength;
+    return true;
+}
+
+int64_t BerDecodeInteger(ByteView value)
+{
+    if (value.size == 0 || value.size > 8) {
+        throw Tap3Error("Invalid INTEGER length " + std::to_string(value.size));
+    }
+    uint64_t result = (value[0] & 0x80) ? ~uint64_t(0) : 0;
+    for (size_t i = 0; i < value.size; i++) {
+        result = (result << 8) | value[i];
+    }
+    return static_cast<int64_t>(result);
+}
+
+} // namespace tap3
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "ByteView.h"
+
+namespace tap3 {
+
+enum class BerClass : uint8_t
+{
+    Universal = 0,
+    Application = 1,
+    Context = 2,
+    Private = 3
+};
+
+// Identifier and length octets of one TLV. Offsets are relative to the
+// buffer the header was parsed from.
+struct BerHeader
+{
+    BerClass tagClass = BerClass::Universal;
+    bool constructed = false;
+    bool indefinite = false;
+    uint32_t tagNumber = 0;
+    size_t headerLength = 0;
+    size_t length = 0;            // content length, 0 when indefinite
+
+    bool Is(BerClass cls, uint32_t number) const { return tagClass == cls && tagNumber == number; }
+    bool IsApplication(uint32_t number) const { return Is(BerClass::Application, number); }
+};
+
+// Complete TLV with its contents located in the source buffer.
+struct BerTlv
+{
+    BerHeader header;
+    size_t offset = 0;            // offset of the identifier octet
+    size_t totalLength = 0;       // identifier + length + contents (+ EOC)
+    ByteView value;
+
+    uint32_t Tag() const { return header.tagNumber; }
+    bool IsApplication(uint32_t number) const { return header.IsApplication(number); }
+    bool Constructed() const { return header.constructed; }
+};
+
+enum class BerParseStatus
+{
+    Ok,
+    NeedMore
+};
+
+// Parses identifier and length octets at p. Returns NeedMore when avail does
+// not cover the whole header; throws BerError on malformed octets.
+// baseOffset is only used in error messages.
+BerParseStatus ParseBerHeader(const uint8_t* p, size_t avail, BerHeader& header, size_t baseOffset = 0);
+
+// Returns the full size of an indefinite-length TLV (including its
+// end-of-contents octets) whose contents start at data[contentOffset].
+size_t FindEndOfContents(ByteView data, size_t contentOffset);
+
+// Pull-style tokenizer over one level of a BER encoding. Nothing is copied:
+// every returned TLV value is a view into the source buffer. Descending into
+// a constructed value is done by creating a new reader over tlv.value.
+class BerReader
+{
+public:
+    explicit BerReader(ByteView data, size_t baseOffset = 0)
+        : m_data(data), m_pos(0), m_baseOffset(baseOffset) {}
+
+    // Reads the next TLV at this level. Returns false at the end of the buffer
+    // or on end-of-contents octets.
+    bool Next(BerTlv& tlv);
+
+    bool AtEnd() const { return m_pos >= m_data.size; }
+    size_t Position() const { return m_pos; }
+    size_t BaseOffset() const { return m_baseOffset; }
+
+    // Reader over the contents of tlv, keeping absolute offsets for diagnostics.
+    BerReader Enter(const BerTlv& tlv) const
+    {
+        return BerReader(tlv.value, m_baseOffset + tlv.offset + tlv.header.headerLength);
+    }
+
+private:
+    ByteView m_data;
+    size_t m_pos;
+    size_t m_baseOffset;
+};
+
+// Primitive value helpers.
+int64_t BerDecodeInteger(ByteView value);
+
+} // namespace tap3
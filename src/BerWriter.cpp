@@ -0,0 +1,232 @@
+#include "BerWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+OutputFile::OutputFile(const std::string& path, size_t bufferSize)
+    : m_path(path), m_tempPath(path + ".tmp"), m_fd(-1), m_buffer(bufferSize > 0 ? bufferSize : 4096),
+      m_used(0), m_written(0), m_renamed(false)
+{
+    m_fd = open(m_tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        throw Tap3Error("Unable to create " + m_tempPath + ": " + strerror(errno));
+    }
+}
+
+OutputFile::~OutputFile()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+    if (!m_renamed) {
+        unlink(m_tempPath.c_str());
+    }
+}
+
+void OutputFile::Write(const uint8_t* data, size_t size)
+{
+    m_written += size;
+    while (size > 0) {
+        size_t chunk = std::min(size, m_buffer.size() - m_used);
+        memcpy(m_buffer.data() + m_used, data, chunk);
+        m_used += chunk;
+        data += chunk;
+        size -= chunk;
+        if (m_used == m_buffer.size()) {
+            Flush();
+        }
+    }
+}
+
+void OutputFile::Flush()
+{
+    size_t pos = 0;
+    while (pos < m_used) {
+        ssize_t n = write(m_fd, m_buffer.data() + pos, m_used - pos);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw Tap3Error("Unable to write " + m_tempPath + ": " + strerror(errno));
+        }
+        pos += static_cast<size_t>(n);
+    }
+    m_used = 0;
+}
+
+void OutputFile::Commit()
+{
+    Sync();
+    Rename();
+}
+
+void OutputFile::Sync()
+{
+    Flush();
+    if (fdatasync(m_fd) != 0) {
+        throw Tap3Error("Unable to sync " + m_tempPath + ": " + strerror(errno));
+    }
+    close(m_fd);
+    m_fd = -1;
+}
+
+void OutputFile::Rename()
+{
+    if (rename(m_tempPath.c_str(), m_path.c_str()) != 0) {
+        throw Tap3Error("Unable to rename " + m_tempPath + ": " + strerror(errno));
+    }
+    m_renamed = true;
+}
+
+namespace {
+
+size_t LengthOctets(size_t length)
+{
+    if (length < 0x80) {
+        return 1;
+    }
+    size_t octets = 1;
+    while (length > 0) {
+        octets++;
+        length >>= 8;
+    }
+    return octets;
+}
+
+size_t TagOctets(uint32_t tag)
+{
+    if (tag < 31) {
+        return 1;
+    }
+    size_t octets = 1;
+    do {
+        octets++;
+        tag >>= 7;
+    } while (tag > 0);
+    return octets;
+}
+
+// Writes identifier and length octets to out (at most 16 bytes).
+size_t EncodeHeader(BerClass tagClass, bool constructed, uint32_t tag, size_t length, uint8_t* out)
+{
+    size_t pos = 0;
+    uint8_t first = static_cast<uint8_t>(static_cast<uint8_t>(tagClass) << 6) | (constructed ? 0x20 : 0);
+    if (tag < 31) {
+        out[pos++] = first | static_cast<uint8_t>(tag);
+    }
+    else {
+        out[pos++] = first | 0x1f;
+        size_t octets = TagOctets(tag) - 1;
+        for (size_t i = octets; i > 0; i--) {
+            uint8_t bits = static_cast<uint8_t>((tag >> ((i - 1) * 7)) & 0x7f);
+            out[pos++] = i > 1 ? (bits | 0x80) : bits;
+        }
+    }
+    if (length < 0x80) {
+        out[pos++] = static_cast<uint8_t>(length);
+    }
+    else {
+        size_t octets = LengthOctets(length) - 1;
+        out[pos++] = static_cast<uint8_t>(0x80 | octets);
+        for (size_t i = octets; i > 0; i--) {
+            out[pos++] = static_cast<uint8_t>(length >> ((i - 1) * 8));
+        }
+    }
+    return pos;
+}
+
+// Writes the content octets of a minimal INTEGER to out (at most 8 bytes).
+size_t EncodeInteger(int64_t value, uint8_t* out)
+{
+    size_t length = BerWriter::IntegerLength(value);
+    for (size_t i = 0; i < length; i++) {
+        out[i] = static_cast<uint8_t>(value >> ((length - 1 - i) * 8));
+    }
+    return length;
+}
+
+} // namespace
+
+size_t BerWriter::HeaderSize(uint32_t tag, size_t length)
+{
+    return TagOctets(tag) + LengthOctets(length);
+}
+
+size_t BerWriter::IntegerLength(int64_t value)
+{
+    size_t length = 1;
+    while (length < 8) {
+        int64_t high = value >> (length * 8 - 1);
+        if (high == 0 || high == -1) {
+            break;
+        }
+        length++;
+    }
+    return length;
+}
+
+void BerWriter::Header(BerClass tagClass, bool constructed, uint32_t tag, size_t length)
+{
+    uint8_t header[16];
+    m_output.Write(header, EncodeHeader(tagClass, constructed, tag, length, header));
+}
+
+void BerWriter::Primitive(uint32_t tag, ByteView value)
+{
+    Header(BerClass::Application, false, tag, value.size);
+    m_output.Write(value.data, value.size);
+}
+
+void BerWriter::Primitive(uint32_t tag, const std::string& value)
+{
+    Primitive(tag, ByteView(reinterpret_cast<const uint8_t*>(value.data()), value.size()));
+}
+
+void BerWriter::Integer(uint32_t tag, int64_t value)
+{
+    uint8_t octets[8];
+    size_t length = EncodeInteger(value, octets);
+    Header(BerClass::Application, false, tag, length);
+    m_output.Write(octets, length);
+}
+
+void BerBuffer::End()
+{
+    size_t start = m_open.back();
+    uint32_t tag = m_tags.back();
+    m_open.pop_back();
+    m_tags.pop_back();
+    uint8_t header[16];
+    size_t headerLength = EncodeHeader(BerClass::Application, true, tag, m_data.size() - start, header);
+    m_data.insert(m_data.begin() + start, header, header + headerLength);
+}
+
+void BerBuffer::Primitive(uint32_t tag, ByteView value)
+{
+    uint8_t header[16];
+    size_t headerLength = EncodeHeader(BerClass::Application, false, tag, value.size, header);
+    m_data.insert(m_data.end(), header, header + headerLength);
+    m_data.insert(m_data.end(), value.data, value.data + value.size);
+}
+
+void BerBuffer::Primitive(uint32_t tag, const std::string& value)
+{
+    Primitive(tag, ByteView(reinterpret_cast<const uint8_t*>(value.data()), value.size()));
+}
+
+void BerBuffer::Integer(uint32_t tag, int64_t value)
+{
+    uint8_t octets[8];
+    size_t length = EncodeInteger(value, octets);
+    Primitive(tag, ByteView(octets, length));
+}
+
+} // namespace tap3
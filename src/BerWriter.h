@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BerReader.h"
+#include "ByteView.h"
+
+namespace tap3 {
+
+// Write-only file with a large user-space buffer, so BER output made of
+// many small TLVs turns into few write(2) calls. The file is created under
+// path + ".tmp" and renamed to path by Commit(), so readers never see a
+// partial file; it is removed if Commit() is not reached. Sync() and
+// Rename() are the two halves of Commit(), for callers that sync a set of
+// files before renaming any of them.
+class OutputFile
+{
+public:
+    explicit OutputFile(const std::string& path, size_t bufferSize = 1 << 20);
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    void Write(const uint8_t* data, size_t size);
+    // Flushes, syncs and renames the file into place.
+    void Commit();
+    // Flushes, syncs and closes the temporary file.
+    void Sync();
+    // Renames the synced file into place.
+    void Rename();
+
+    const std::string& Path() const { return m_path; }
+    uint64_t Written() const { return m_written; }
+
+private:
+    void Flush();
+
+    std::string m_path;
+    std::string m_tempPath;
+    int m_fd;
+    std::vector<uint8_t> m_buffer;
+    size_t m_used;
+    uint64_t m_written;
+    bool m_renamed;
+};
+
+// Definite-length BER encoder writing straight to an OutputFile. No tree is
+// built: a constructed value is started with its content length, which the
+// caller computes beforehand with the *Size helpers, and its contents are
+// then written in order.
+class BerWriter
+{
+public:
+    explicit BerWriter(OutputFile& output) : m_output(output) {}
+
+    // Identifier and length octets.
+    void Header(BerClass tagClass, bool constructed, uint32_t tag, size_t length);
+    void Constructed(uint32_t tag, size_t length) { Header(BerClass::Application, true, tag, length); }
+    void Primitive(uint32_t tag, ByteView value);
+    void Primitive(uint32_t tag, const std::string& value);
+    void Integer(uint32_t tag, int64_t value);
+    // Already encoded TLVs, e.g. a call event copied from the source file.
+    void Raw(ByteView encoded) { m_output.Write(encoded.data, encoded.size); }
+
+    // Size of identifier + length octets of an APPLICATION tag.
+    static size_t HeaderSize(uint32_t tag, size_t length);
+    static size_t TlvSize(uint32_t tag, size_t length) { return HeaderSize(tag, length) + length; }
+    // Content octets of a minimal two's complement INTEGER.
+    static size_t IntegerLength(int64_t value);
+    static size_t IntegerSize(uint32_t tag, int64_t value) { return TlvSize(tag, IntegerLength(value)); }
+
+private:
+    OutputFile& m_output;
+};
+
+// In-memory BER encoder for small elements (one call event, a header
+// block) whose lengths are not worth computing up front: Begin() opens a
+// constructed value and End() inserts its identifier and length octets
+// once the contents are known. The result is passed to BerWriter::Raw().
+class BerBuffer
+{
+public:
+    void Clear() { m_data.clear(); m_open.clear(); m_tags.clear(); }
+
+    void Begin(uint32_t tag) { m_open.push_back(m_data.size()); m_tags.push_back(tag); }
+    void End();
+    void Primitive(uint32_t tag, ByteView value);
+    void Primitive(uint32_t tag, const std::string& value);
+    void Integer(uint32_t tag, int64_t value);
+    void Raw(ByteView encoded) { m_data.insert(m_data.end(), encoded.data, encoded.data + encoded.size); }
+
+    ByteView View() const { return ByteView(m_data.data(), m_data.size()); }
+    size_t Size() const { return m_data.size(); }
+
+private:
+    std::vector<uint8_t> m_data;
+    std::vector<size_t> m_open;   // content offsets of the open constructed values
+    std::vector<uint32_t> m_tags;    // their tags
+};
+
+} // namespace tap3
@@ -0,0 +1,223 @@
+#include "BulkLoader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <thread>
+
+#include "DirectoryWatcher.h"
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+const int kMaxDirectoryDepth = 32;
+
+} // namespace
+
+BulkLoader::BulkLoader(const BulkSettings& settings, SessionPool::Factory sinkFactory)
+    : m_settings(settings),
+      m_sessions(sinkFactory, settings.sessionCount > 0 ? settings.sessionCount
+          : std::max<size_t>(settings.workerCount, 1)),
+      m_stopping(false)
+{
+}
+
+void BulkLoader::ListJobs()
+{
+    struct stat st;
+    if (stat(m_settings.source.c_str(), &st) != 0) {
+        throw Tap3Error("Unable to stat " + m_settings.source + ": " + strerror(errno));
+    }
+    if (S_ISDIR(st.st_mode)) {
+        ListDirectory(m_settings.source, 0);
+        return;
+    }
+    m_archive.reset(new MappedFile(m_settings.source));
+    size_t inflateSlots = MappedFile::GetInflateLimits().maxConcurrent;
+    if (m_archive->Compressed() && inflateSlots == 1) {
+        // the workers would wait for the slot the archive holds
+        throw Tap3Error(m_settings.source + " is compressed, loading its files needs more than one inflate slot");
+    }
+    ByteView archive = m_archive->View();
+    if (IsZipArchive(archive)) {
+        ListZipMembers(archive, m_members);
+    }
+    else if (IsTarArchive(archive)) {
+        ListTarMembers(archive, m_members);
+    }
+    else {
+        throw Tap3Error(m_settings.source + " is neither a directory nor a tar or zip archive");
+    }
+    for (const ArchiveMember& member : m_members) {
+        m_jobs.push_back(Job{ m_settings.source + ":" + member.name, member.size, &member });
+    }
+}
+
+void BulkLoader::ListDirectory(const std::string& directory, int depth)
+{
+    if (depth > kMaxDirectoryDepth) {
+        throw Tap3Error(directory + " is nested too deep");
+    }
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        throw Tap3Error("Unable to read " + directory + ": " + strerror(errno));
+    }
+    std::vector<std::string> subdirectories;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (!IsCandidateFileName(name)) {
+            continue;
+        }
+        std::string path = directory + "/" + name;
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            subdirectories.push_back(path);
+        }
+        else if (S_ISREG(st.st_mode)) {
+            m_jobs.push_back(Job{ path, static_cast<uint64_t>(st.st_size), nullptr });
+        }
+    }
+    closedir(dir);
+    for (const std::string& subdirectory : subdirectories) {
+        ListDirectory(subdirectory, depth + 1);
+    }
+}
+
+BulkResult BulkLoader::Run()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ListJobs();
+
+    std::vector<size_t> order(m_jobs.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return m_jobs[a].size > m_jobs[b].size;
+    });
+    size_t workerCount = std::max<size_t>(m_settings.workerCount, 1);
+    for (size_t i = 0; i < workerCount; i++) {
+        m_queues.emplace_back(new WorkerQueue);
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        m_queues[i % workerCount]->jobs.push_back(order[i]);
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&BulkLoader::WorkerLoop, this, i);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    m_result.fileCount = m_jobs.size();
+    m_result.skippedCount = m_result.fileCount - m_result.loadedCount - m_result.duplicateFileCount
+        - m_result.failedCount;
+    m_result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return m_result;
+}
+
+bool BulkLoader::NextJob(size_t worker, size_t& job)
+{
+    // the worker's own queue first, then the others in turn
+    for (size_t i = 0; i < m_queues.size() && !m_stopping; i++) {
+        WorkerQueue& queue = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void BulkLoader::WorkerLoop(size_t worker)
+{
+    TapLoader loader(m_settings.loader);
+    size_t job;
+    while (NextJob(worker, job)) {
+        LoadJob(loader, m_jobs[job]);
+    }
+}
+
+void BulkLoader::LoadJob(TapLoader& loader, const Job& job)
+{
+    std::unique_ptr<PooledSession> session;
+    try {
+        session = m_sessions.Checkout();
+    }
+    catch (const std::exception& ex) {
+        // only this file fails; the next one checks out a session again
+        std::cerr << job.name << ": unable to open database session: " << ex.what() << std::endl;
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        m_result.failedCount++;
+        return;
+    }
+    LoadResult result;
+    bool loaded = false;
+    bool duplicate = false;
+    try {
+        if (job.member) {
+            MappedFile file(job.name, job.member->data, job.member->format);
+            if (file.Compressed() && MappedFile::Detect(file.View()) != MappedFile::Format::Plain) {
+                // a .gz or .zst file deflated once more by zip
+                MappedFile inner(job.name, file.View());
+                result = loader.LoadFile(inner, **session);
+            }
+            else {
+                result = loader.LoadFile(file, **session);
+            }
+        }
+        else {
+            result = loader.LoadFile(job.name, **session);
+        }
+        loaded = true;
+        std::cout << job.name << ": loaded " << result.eventCount << " events" << std::endl;
+        if (result.duplicateEventCount > 0) {
+            std::cout << job.name << ": " << result.duplicateEventCount << " duplicate events left out" << std::endl;
+        }
+        if (!result.rapFile.empty()) {
+            std::cout << job.name << ": " << result.severeErrorCount << " records returned in "
+                << result.rapFile << std::endl;
+        }
+    }
+    catch (const DuplicateFileError& ex) {
+        std::cout << job.name << ": skipped, " << ex.what() << std::endl;
+        duplicate = true;
+    }
+    catch (const DatabaseError& ex) {
+        std::cerr << job.name << ": " << ex.what() << std::endl;
+        session->Invalidate();
+    }
+    catch (const Tap3Error& ex) {
+        std::cerr << job.name << ": " << ex.what() << std::endl;
+    }
+    catch (const std::exception& ex) {
+        std::cerr << job.name << ": " << ex.what() << std::endl;
+        session->Invalidate();
+    }
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    if (loaded) {
+        m_result.loadedCount++;
+        m_result.eventCount += result.eventCount;
+        m_result.byteCount += result.timings.bytes;
+    }
+    else if (duplicate) {
+        m_result.duplicateFileCount++;
+    }
+    else {
+        m_result.failedCount++;
+    }
+}
+
+} // namespace tap3
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Archive.h"
+#include "MappedFile.h"
+#include "SessionPool.h"
+#include "TapLoader.h"
+
+namespace tap3 {
+
+struct BulkSettings
+{
+    // A directory tree, or a tar or zip archive. The archive itself may be
+    // gzip or zstd compressed (it is then inflated into memory as a whole
+    // and holds one inflate slot for the whole run), and so may the files in
+    // it.
+    std::string source;
+    size_t workerCount = 4;          // files loaded concurrently
+    size_t sessionCount = 0;         // database sessions shared by the workers, 0 for one per worker
+    LoaderSettings loader;
+};
+
+struct BulkResult
+{
+    uint64_t fileCount = 0;
+    uint64_t loadedCount = 0;
+    uint64_t duplicateFileCount = 0;  // rejected by the duplicate index
+    uint64_t failedCount = 0;
+    uint64_t skippedCount = 0;        // not attempted because the run was stopped
+    uint64_t eventCount = 0;
+    uint64_t byteCount = 0;           // uncompressed bytes of the loaded files
+    double seconds = 0;
+};
+
+// One-off loading of a large set of TAP files, e.g. months of history to
+// reprocess. All files are listed up front and scheduled largest first:
+// sorted by size, they are dealt round-robin to per-worker queues, each
+// worker takes the largest file left in its own queue, and a worker whose
+// queue ran dry steals the largest pending file of another. Big files thus
+// start early and the run does not end waiting for one of them. Workers
+// check sinks out of a shared SessionPool per file. A file that fails is
+// reported and counted; the others are loaded regardless.
+class BulkLoader
+{
+public:
+    BulkLoader(const BulkSettings& settings, SessionPool::Factory sinkFactory);
+
+    BulkResult Run();
+    // Workers finish the file they are loading and take no further ones.
+    void Stop() { m_stopping = true; }
+
+private:
+    struct Job
+    {
+        std::string name;
+        uint64_t size;
+        const ArchiveMember* member;    // null for a file on disk
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> jobs;        // indexes into m_jobs, largest first
+    };
+
+    void ListJobs();
+    void ListDirectory(const std::string& directory, int depth);
+    bool NextJob(size_t worker, size_t& job);
+    void WorkerLoop(size_t worker);
+    void LoadJob(TapLoader& loader, const Job& job);
+
+    BulkSettings m_settings;
+    SessionPool m_sessions;
+    std::unique_ptr<MappedFile> m_archive;
+    std::vector<ArchiveMember> m_members;
+    std::vector<Job> m_jobs;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::atomic<bool> m_stopping;
+    std::mutex m_resultMutex;
+    BulkResult m_result;
+};
+
+} // namespace tap3
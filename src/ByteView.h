@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tap3 {
+
+// Non-owning view of a byte range. Views produced by the decoder point into
+// the memory-mapped TAP file and stay valid as long as the mapping is alive.
+struct ByteView
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    ByteView() = default;
+    ByteView(const uint8_t* d, size_t s) : data(d), size(s) {}
+
+    bool Empty() const { return size == 0; }
+    const uint8_t* begin() const { return data; }
+    const uint8_t* end() const { return data + size; }
+    uint8_t operator[](size_t i) const { return data[i]; }
+
+    ByteView Sub(size_t offset, size_t length) const { return ByteView(data + offset, length); }
+
+    std::string_view AsString() const
+    {
+        return std::string_view(reinterpret_cast<const char*>(data), size);
+    }
+    std::string ToString() const { return std::string(AsString()); }
+};
+
+} // namespace tap3
@@ -0,0 +1,92 @@
+#include "CodeTables.h"
+
+#include <cstdint>
+#include "TimeStamp.h"
+
+namespace tap3 {
+
+namespace {
+
+// value * multiplier / divisor rounded half away from zero, computed in 128
+// bits (a GNU extension, hence __extension__). False if the result does not
+// fit in 64 bits.
+bool MulDivRounded(int64_t value, int64_t multiplier, int64_t divisor, int64_t& result)
+{
+    __extension__ typedef __int128 Wide;
+    Wide product = static_cast<Wide>(value) * multiplier;
+    Wide half = divisor / 2;
+    product += product >= 0 ? half : -half;
+    Wide quotient = product / divisor;
+    if (quotient < INT64_MIN || quotient > INT64_MAX) {
+        return false;
+    }
+    result = static_cast<int64_t>(quotient);
+    return true;
+}
+
+} // namespace
+
+void CodeTables::Clear()
+{
+    m_recEntities.Clear();
+    m_utcOffsets.Clear();
+    m_exchangeRates.Clear();
+    m_taxes.Clear();
+    m_discounts.Clear();
+    m_messageDescriptions.Clear();
+}
+
+void CodeTables::Build(const AccountingInfo& info)
+{
+    for (const CurrencyConversion& conversion : info.currencyConversion) {
+        ExchangeRate rate;
+        rate.rate = conversion.exchangeRate;
+        for (int32_t i = 0; i < conversion.numberOfDecimalPlaces && i < 18; i++) {
+            rate.divisor *= 10;
+        }
+        m_exchangeRates.Set(conversion.exchangeRateCode, rate);
+    }
+    for (const Taxation& taxation : info.taxation) {
+        m_taxes.Set(taxation.taxCode, taxation);
+    }
+    for (const Discounting& discounting : info.discounting) {
+        m_discounts.Set(discounting.discountCode, discounting);
+    }
+}
+
+void CodeTables::Build(const NetworkInfo& info)
+{
+    for (const UtcTimeOffsetInfo& offset : info.utcTimeOffsetInfo) {
+        int32_t seconds;
+        if (ParseUtcTimeOffset(offset.utcTimeOffset, seconds)) {
+            m_utcOffsets.Set(offset.utcTimeOffsetCode, seconds);
+        }
+    }
+    for (const RecEntityInfo& entity : info.recEntityInfo) {
+        m_recEntities.Set(entity.recEntityCode, entity);
+    }
+}
+
+void CodeTables::Build(const std::vector<MessageDescriptionInfo>& info)
+{
+    for (const MessageDescriptionInfo& description : info) {
+        m_messageDescriptions.Set(description.messageDescriptionCode, description);
+    }
+}
+
+int64_t CodeTables::ToUtc(ByteView localTimeStamp, int32_t utcTimeOffsetCode) const
+{
+    const int32_t* offset = m_utcOffsets.Find(utcTimeOffsetCode);
+    int64_t local;
+    if (!offset || !ParseLocalTimeStamp(localTimeStamp, local)) {
+        return 0;
+    }
+    return local - *offset;
+}
+
+bool CodeTables::ToLocalCurrency(int64_t charge, const ExchangeRate& rate, int64_t& local)
+{
+    return MulDivRounded(charge, rate.rate, rate.divisor, local);
+}
+
+} // namespace tap3
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Tap3Types.h"
+
+namespace tap3 {
+
+// Table indexed directly by a TAP code. Codes are small non-negative
+// integers assigned by the sender, so a vector with a presence flag gives
+// O(1) resolution without hashing or searching.
+template <typename T>
+class DenseCodeTable
+{
+public:
+    // Codes above this are ignored instead of being allowed to size the table.
+    static const int32_t kMaxCode = 65535;
+
+    bool Set(int32_t code, const T& value)
+    {
+        if (code < 0 || code > kMaxCode) {
+            return false;
+        }
+        if (static_cast<size_t>(code) >= m_values.size()) {
+            m_values.resize(code + 1);
+            m_present.resize(code + 1, 0);
+        }
+        m_values[code] = value;
+        m_present[code] = 1;
+        return true;
+    }
+
+    const T* Find(int32_t code) const
+    {
+        if (code < 0 || static_cast<size_t>(code) >= m_values.size() || !m_present[code]) {
+            return nullptr;
+        }
+        return &m_values[code];
+    }
+
+    void Clear()
+    {
+        m_values.clear();
+        m_present.clear();
+    }
+
+private:
+    std::vector<T> m_values;
+    std::vector<uint8_t> m_present;
+};
+
+struct ExchangeRate
+{
+    int64_t rate = 0;
+    int64_t divisor = 1;          // 10 ^ NumberOfDecimalPlaces
+};
+
+// Per-file code tables compiled from AccountingInfo, NetworkInfo and
+// MessageDescriptionInfoList. Built before the call events are decoded and
+// read-only afterwards, so decoding threads share them without locking.
+class CodeTables
+{
+public:
+    void Clear();
+    void Build(const AccountingInfo& info);
+    void Build(const NetworkInfo& info);
+    void Build(const std::vector<MessageDescriptionInfo>& info);
+
+    const RecEntityInfo* RecEntity(int32_t code) const { return m_recEntities.Find(code); }
+    const int32_t* UtcOffset(int32_t code) const { return m_utcOffsets.Find(code); }
+    const ExchangeRate* Exchange(int32_t code) const { return m_exchangeRates.Find(code); }
+    const Taxation* Tax(int32_t code) const { return m_taxes.Find(code); }
+    const Discounting* Discount(int32_t code) const { return m_discounts.Find(code); }
+    const MessageDescriptionInfo* MessageDescription(int32_t code) const { return m_messageDescriptions.Find(code); }
+
+    // UTC epoch seconds of a LocalTimeStamp with the given offset code,
+    // 0 if either is invalid.
+    int64_t ToUtc(ByteView localTimeStamp, int32_t utcTimeOffsetCode) const;
+
+    // Charge converted from TAP currency to local currency with the
+    // exchange rate of the code, rounded half away from zero. False if the
+    // result is out of the int64 range.
+    static bool ToLocalCurrency(int64_t charge, const ExchangeRate& rate, int64_t& local);
+
+private:
+    DenseCodeTable<RecEntityInfo> m_recEntities;
+    DenseCodeTable<int32_t> m_utcOffsets;        // seconds east of UTC
+    DenseCodeTable<ExchangeRate> m_exchangeRates;
+    DenseCodeTable<Taxation> m_taxes;
+    DenseCodeTable<Discounting> m_discounts;
+    DenseCodeTable<MessageDescriptionInfo> m_messageDescriptions;
+};
+
+} // namespace tap3
@@ -0,0 +1,114 @@
+#include "DirectoryWatcher.h"
+
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+bool EndsWith(const std::string& s, const char* suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+} // namespace
+
+bool IsCandidateFileName(const std::string& name)
+{
+    return !name.empty() && name[0] != '.' && !EndsWith(name, ".tmp") && !EndsWith(name, ".part");
+}
+
+DirectoryWatcher::DirectoryWatcher(const std::string& directory)
+    : m_directory(directory), m_inotifyFd(-1), m_stopping(false)
+{
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        throw Tap3Error(std::string("inotify_init1 failed: ") + strerror(errno));
+    }
+    if (inotify_add_watch(m_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        int err = errno;
+        close(m_inotifyFd);
+        throw Tap3Error("Unable to watch " + directory + ": " + strerror(err));
+    }
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    close(m_inotifyFd);
+}
+
+void DirectoryWatcher::ScanExisting(const Callback& callback)
+{
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) {
+        throw Tap3Error("Unable to read " + m_directory + ": " + strerror(errno));
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (!IsCandidateFileName(name)) {
+            continue;
+        }
+        std::string path = m_directory + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            callback(path);
+        }
+        if (m_stopping) {
+            break;
+        }
+    }
+    closedir(dir);
+}
+
+void DirectoryWatcher::Run(const Callback& callback)
+{
+    // The watch is already active, so files arriving during the scan are
+    // not lost; they may be reported twice and callers must tolerate that.
+    ScanExisting(callback);
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    while (!m_stopping) {
+        struct pollfd pfd = { m_inotifyFd, POLLIN, 0 };
+        int rc = poll(&pfd, 1, 500);
+        if (rc < 0 && errno != EINTR) {
+            throw Tap3Error(std::string("poll failed: ") + strerror(errno));
+        }
+        if (rc <= 0) {
+            continue;
+        }
+        ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            throw Tap3Error(std::string("inotify read failed: ") + strerror(errno));
+        }
+        for (char* p = buffer; p < buffer + length; ) {
+            struct inotify_event* event = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // kernel dropped events, fall back to a full scan
+                ScanExisting(callback);
+                continue;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+            std::string name = event->name;
+            if (IsCandidateFileName(name)) {
+                callback(m_directory + "/" + name);
+            }
+        }
+    }
+}
+
+} // namespace tap3
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+namespace tap3 {
+
+// Reports files that appear in a directory, using inotify. A file is
+// reported once it is complete: closed after writing or moved in. Hidden
+// files and names ending in .tmp or .part are ignored, so senders can write
+// under a temporary name and rename.
+class DirectoryWatcher
+{
+public:
+    typedef std::function<void(const std::string& path)> Callback;
+
+    explicit DirectoryWatcher(const std::string& directory);
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    // Reports files already present, then new ones as they arrive, until
+    // Stop() is called. The callback may block to apply backpressure.
+    void Run(const Callback& callback);
+    void Stop() { m_stopping = true; }
+
+private:
+    void ScanExisting(const Callback& callback);
+
+    std::string m_directory;
+    int m_inotifyFd;
+    std::atomic<bool> m_stopping;
+};
+
+bool IsCandidateFileName(const std::string& name);
+
+} // namespace tap3
@@ -0,0 +1,371 @@
+#include "DuplicateIndex.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tap3 {
+
+namespace {
+
+const char kMagic[8] = { 'T', 'A', 'P', '3', 'D', 'U', 'P', '1' };
+
+// Owner values of log entries whose key is a file.
+const uint64_t kCommitted = ~0ULL;      // the file and its staged events are loaded
+const uint64_t kDiscarded = ~0ULL - 1;  // the staged events of the file are dropped
+
+const size_t kInitialSlots = 1 << 16;
+const size_t kReplayEntries = 1 << 16;
+
+uint64_t Mix(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// FNV-1a, with the length of every value fed in so adjacent values cannot
+// trade bytes.
+class Hasher
+{
+public:
+    void Add(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            m_hash = (m_hash ^ bytes[i]) * 0x100000001B3ULL;
+        }
+    }
+    void Add(ByteView value)
+    {
+        AddNumber(value.size);
+        Add(value.data, value.size);
+    }
+    void Add(const std::string& value)
+    {
+        AddNumber(value.size());
+        Add(value.data(), value.size());
+    }
+    void AddNumber(uint64_t value) { Add(&value, sizeof(value)); }
+
+    // Never 0 (empty slot) nor one of the log markers.
+    uint64_t Finish() const
+    {
+        uint64_t h = Mix(m_hash);
+        return h == 0 || h >= kDiscarded ? 1 : h;
+    }
+
+private:
+    uint64_t m_hash = 0xCBF29CE484222325ULL;
+};
+
+} // namespace
+
+uint64_t FileFingerprint(const std::string& sender, const std::string& recipient,
+    const std::string& fileSequenceNumber)
+{
+    Hasher hasher;
+    hasher.Add("F", 1);
+    hasher.Add(sender);
+    hasher.Add(recipient);
+    hasher.Add(fileSequenceNumber);
+    return hasher.Finish();
+}
+
+uint64_t EventFingerprint(CallEventType type, const EventColumns& columns, size_t row)
+{
+    Hasher hasher;
+    hasher.Add("E", 1);
+    hasher.AddNumber(static_cast<uint64_t>(type));
+    hasher.Add(columns.imsi.At(row));
+    hasher.AddNumber(columns.localTimeStamp[row]);
+    hasher.AddNumber(static_cast<uint64_t>(columns.duration[row]));
+    hasher.Add(columns.otherParty.At(row));
+    hasher.AddNumber(static_cast<uint64_t>(columns.dataVolumeIncoming[row]));
+    hasher.AddNumber(static_cast<uint64_t>(columns.dataVolumeOutgoing[row]));
+    return hasher.Finish();
+}
+
+DuplicateIndex::DuplicateIndex(const std::string& path)
+    : m_path(path), m_fd(-1), m_logSize(0), m_slots(kInitialSlots, 0), m_size(0)
+{
+    m_fd = open(path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        throw Tap3Error("Unable to open " + path + ": " + strerror(errno));
+    }
+    try {
+        Replay();
+    }
+    catch (...) {
+        close(m_fd);
+        throw;
+    }
+}
+
+DuplicateIndex::~DuplicateIndex()
+{
+    close(m_fd);
+}
+
+void DuplicateIndex::Replay()
+{
+    struct stat st;
+    if (fstat(m_fd, &st) != 0) {
+        throw Tap3Error("Unable to stat " + m_path + ": " + strerror(errno));
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (size == 0) {
+        Write(reinterpret_cast<const uint8_t*>(kMagic), sizeof(kMagic));
+        return;
+    }
+    char magic[sizeof(kMagic)];
+    if (size < sizeof(magic) || pread(m_fd, magic, sizeof(magic), 0) != sizeof(magic)
+        || memcmp(magic, kMagic, sizeof(magic)) != 0) {
+        throw Tap3Error(m_path + " is not a duplicate index");
+    }
+    // an entry torn by a crash is dropped
+    uint64_t entryCount = (size - sizeof(magic)) / sizeof(Entry);
+    uint64_t end = sizeof(magic) + entryCount * sizeof(Entry);
+    if (end != size && ftruncate(m_fd, static_cast<off_t>(end)) != 0) {
+        throw Tap3Error("Unable to truncate " + m_path + ": " + strerror(errno));
+    }
+    m_logSize = end;
+    while (m_slots.size() * 7 / 10 < entryCount) {
+        m_slots.resize(m_slots.size() * 2);
+    }
+
+    std::unordered_map<uint64_t, std::vector<uint64_t>> staged;
+    std::vector<Entry> entries(kReplayEntries);
+    uint64_t offset = sizeof(magic);
+    while (offset < end) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(kReplayEntries, (end - offset) / sizeof(Entry)));
+        size_t bytes = count * sizeof(Entry);
+        if (pread(m_fd, entries.data(), bytes, static_cast<off_t>(offset)) != static_cast<ssize_t>(bytes)) {
+            throw Tap3Error("Unable to read " + m_path + ": " + strerror(errno));
+        }
+        offset += bytes;
+        for (size_t i = 0; i < count; i++) {
+            const Entry& entry = entries[i];
+            if (entry.owner == 0) {
+                Insert(entry.key);
+            }
+            else if (entry.owner == kCommitted) {
+                Insert(entry.key);
+                auto it = staged.find(entry.key);
+                if (it != staged.end()) {
+                    for (uint64_t key : it->second) {
+                        Insert(key);
+                    }
+                    staged.erase(it);
+                }
+            }
+            else if (entry.owner == kDiscarded) {
+                staged.erase(entry.key);
+            }
+            else {
+                staged[entry.owner].push_back(entry.key);
+            }
+        }
+    }
+    // files interrupted after a checkpoint, waiting to be resumed
+    for (auto& file : staged) {
+        FileState& state = m_files[file.first];
+        state.events.swap(file.second);
+        state.checkpointed = state.events.size();
+        state.known.insert(state.events.begin(), state.events.end());
+    }
+}
+
+void DuplicateIndex::Append(const std::vector<Entry>& entries)
+{
+    Write(reinterpret_cast<const uint8_t*>(entries.data()), entries.size() * sizeof(Entry));
+}
+
+// A write that fails part-way is cut off again, so later entries stay
+// aligned.
+void DuplicateIndex::Write(const uint8_t* data, size_t size)
+{
+    size_t remaining = size;
+    while (remaining > 0) {
+        ssize_t n = write(m_fd, data, remaining);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Fail("write");
+        }
+        data += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    if (fdatasync(m_fd) != 0) {
+        Fail("sync");
+    }
+    m_logSize += size;
+}
+
+void DuplicateIndex::Fail(const char* what)
+{
+    std::string message = std::string("Unable to ") + what + " " + m_path + ": " + strerror(errno);
+    if (ftruncate(m_fd, static_cast<off_t>(m_logSize)) != 0) {
+        message += ", and unable to truncate it: " + std::string(strerror(errno));
+    }
+    throw Tap3Error(message);
+}
+
+bool DuplicateIndex::Contains(uint64_t key) const
+{
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = key & mask; m_slots[i] != 0; i = (i + 1) & mask) {
+        if (m_slots[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DuplicateIndex::Insert(uint64_t key)
+{
+    if ((m_size + 1) * 10 > m_slots.size() * 7) {
+        Grow();
+    }
+    size_t mask = m_slots.size() - 1;
+    size_t i = key & mask;
+    for (; m_slots[i] != 0; i = (i + 1) & mask) {
+        if (m_slots[i] == key) {
+            return false;
+        }
+    }
+    m_slots[i] = key;
+    m_size++;
+    return true;
+}
+
+void DuplicateIndex::Grow()
+{
+    std::vector<uint64_t> old(m_slots.size() * 2, 0);
+    old.swap(m_slots);
+    m_size = 0;
+    for (uint64_t key : old) {
+        if (key != 0) {
+            Insert(key);
+        }
+    }
+}
+
+void DuplicateIndex::Forget(FileState& state)
+{
+    state.events.clear();
+    state.known.clear();
+    state.checkpointed = 0;
+}
+
+void DuplicateIndex::BeginFile(uint64_t file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Contains(file)) {
+        throw DuplicateFileError("File already loaded");
+    }
+    FileState& state = m_files[file];
+    if (state.open) {
+        throw DuplicateFileError("File is being loaded from another copy");
+    }
+    state.open = true;
+}
+
+void DuplicateIndex::DiscardCheckpoints(uint64_t file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FileState& state = m_files[file];
+    if (state.checkpointed > 0) {
+        Forget(state);
+        Append(std::vector<Entry>(1, Entry{ file, kDiscarded }));
+    }
+}
+
+void DuplicateIndex::AddEvents(uint64_t file, const std::vector<uint64_t>& events, std::vector<uint8_t>& duplicate)
+{
+    duplicate.resize(events.size());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FileState& state = m_files[file];
+    for (size_t i = 0; i < events.size(); i++) {
+        duplicate[i] = Contains(events[i]) || !state.known.insert(events[i]).second ? 1 : 0;
+        if (!duplicate[i]) {
+            state.events.push_back(events[i]);
+        }
+    }
+}
+
+void DuplicateIndex::Checkpoint(uint64_t file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FileState& state = m_files[file];
+    std::vector<Entry> entries;
+    entries.reserve(state.events.size() - state.checkpointed);
+    for (size_t i = state.checkpointed; i < state.events.size(); i++) {
+        entries.push_back(Entry{ state.events[i], file });
+    }
+    Append(entries);
+    state.checkpointed = state.events.size();
+}
+
+void DuplicateIndex::CommitFile(uint64_t file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FileState& state = m_files[file];
+    std::vector<Entry> entries;
+    entries.reserve(state.events.size() - state.checkpointed + 1);
+    for (size_t i = 0; i < state.events.size(); i++) {
+        if (i >= state.checkpointed) {
+            entries.push_back(Entry{ state.events[i], 0 });
+        }
+        Insert(state.events[i]);
+    }
+    entries.push_back(Entry{ file, kCommitted });
+    Insert(file);
+    m_files.erase(file);
+    // the file is loaded by now: it stays known in memory even if the log
+    // cannot be written
+    Append(entries);
+}
+
+void DuplicateIndex::RollbackFile(uint64_t file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FileState& state = m_files[file];
+    for (size_t i = state.checkpointed; i < state.events.size(); i++) {
+        state.known.erase(state.events[i]);
+    }
+    state.events.resize(state.checkpointed);
+    if (state.checkpointed > 0) {
+        state.open = false;
+    }
+    else {
+        m_files.erase(file);
+    }
+}
+
+void DuplicateIndex::DiscardFile(uint64_t file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FileState& state = m_files[file];
+    bool staged = state.checkpointed > 0;
+    Forget(state);
+    m_files.erase(file);
+    if (staged) {
+        Append(std::vector<Entry>(1, Entry{ file, kDiscarded }));
+    }
+}
+
+size_t DuplicateIndex::Size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+} // namespace tap3
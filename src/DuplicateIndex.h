@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "EventColumns.h"
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+// The TAP file was loaded before (same sender, recipient and file sequence
+// number), or another worker is loading a copy of it right now.
+class DuplicateFileError : public Tap3Error
+{
+public:
+    explicit DuplicateFileError(const std::string& message) : Tap3Error(message) {}
+};
+
+// 64-bit keys of the index. Files are identified by sender, recipient and
+// file sequence number; call events by record type, IMSI, local start time
+// stamp, duration, other party and data volumes, which together tell apart
+// the partial records of one GPRS session.
+uint64_t FileFingerprint(const std::string& sender, const std::string& recipient,
+    const std::string& fileSequenceNumber);
+uint64_t EventFingerprint(CallEventType type, const EventColumns& columns, size_t row);
+
+// Persistent index of loaded files and call events, so resent files and
+// events are rejected with one hash probe instead of a query against the
+// loaded tables. Keys live in an open-addressing table of 64-bit
+// fingerprints (8 bytes per event at full load); the file is an append-only
+// log replayed into the table on open and synced once per committed file or
+// checkpoint. Fingerprints are hashes: two different events collide with a
+// probability of about n^2 / 2^65 over n indexed events.
+//
+// Files go through the same steps as in an EventSink: BeginFile,
+// AddEvents, optionally Checkpoint, then CommitFile, RollbackFile or
+// DiscardFile. Only committed events are known to every file. Events a
+// file has added but not committed, checkpointed or not, are known to that
+// file only, so repeats within the file are found, but another file is
+// never told to drop an event whose owner may still be discarded. Two
+// files being loaded at the same time may therefore both load an event
+// they share. Checkpointed events stay with their file until it is
+// committed or discarded, also across restarts, so a resumed load still
+// sees the events it skipped. The index is shared by all loader threads;
+// the lock is taken once per call, never per event.
+class DuplicateIndex
+{
+public:
+    explicit DuplicateIndex(const std::string& path);
+    ~DuplicateIndex();
+
+    DuplicateIndex(const DuplicateIndex&) = delete;
+    DuplicateIndex& operator=(const DuplicateIndex&) = delete;
+
+    // Throws DuplicateFileError if the file is already loaded or being loaded.
+    void BeginFile(uint64_t file);
+    // Drops events checkpointed by an earlier attempt at the file, for a
+    // load that starts again from the first record.
+    void DiscardCheckpoints(uint64_t file);
+    // Adds the fingerprints to the file. duplicate[i] is set to 1 for every
+    // event that was already known, 0 otherwise.
+    void AddEvents(uint64_t file, const std::vector<uint64_t>& events, std::vector<uint8_t>& duplicate);
+    // Persists the events added since the last checkpoint as staged.
+    void Checkpoint(uint64_t file);
+    // Persists the file and all its events as loaded.
+    void CommitFile(uint64_t file);
+    // Forgets the events added since the last checkpoint.
+    void RollbackFile(uint64_t file);
+    // Forgets all events of the file, checkpointed ones included.
+    void DiscardFile(uint64_t file);
+
+    size_t Size() const;
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint64_t owner;     // 0 for loaded events, the file for staged ones, or a marker
+    };
+
+    struct FileState
+    {
+        std::vector<uint64_t> events;           // not in the table until the file is committed
+        size_t checkpointed = 0;                // leading events persisted as staged
+        std::unordered_set<uint64_t> known;     // all of the events, for repeats within the file
+        bool open = false;
+    };
+
+    bool Contains(uint64_t key) const;
+    bool Insert(uint64_t key);
+    void Grow();
+    void Replay();
+    void Append(const std::vector<Entry>& entries);
+    void Write(const uint8_t* data, size_t size);
+    [[noreturn]] void Fail(const char* what);
+    void Forget(FileState& state);
+
+    std::string m_path;
+    int m_fd;
+    uint64_t m_logSize;                 // bytes of whole entries in the log
+    mutable std::mutex m_mutex;
+    std::vector<uint64_t> m_slots;      // 0 marks an empty slot
+    size_t m_size;
+    std::unordered_map<uint64_t, FileState> m_files;   // open or staged files
+};
+
+} // namespace tap3
@@ -0,0 +1,254 @@
+#include "EventColumns.h"
+
+#include <algorithm>
+
+namespace tap3 {
+
+namespace {
+
+// ChargeType is a two-digit string; -1 if it is not one.
+int16_t ParseChargeType(ByteView value)
+{
+    if (value.size != 2 || value[0] < '0' || value[0] > '9' || value[1] < '0' || value[1] > '9') {
+        return -1;
+    }
+    return static_cast<int16_t>((value[0] - '0') * 10 + (value[1] - '0'));
+}
+
+uint64_t ParseLocalTimeStamp(ByteView value)
+{
+    uint64_t result = 0;
+    for (uint8_t c : value) {
+        if (c < '0' || c > '9') {
+            return 0;
+        }
+        result = result * 10 + (c - '0');
+    }
+    return result;
+}
+
+} // namespace
+
+void EventColumns::Append(const CallEvent& event)
+{
+    recordOffset.push_back(event.recordOffset);
+    localTimeStamp.push_back(ParseLocalTimeStamp(event.startTimeStamp));
+    utcTimeOffsetCode.push_back(event.utcTimeOffsetCode);
+    startTimeUtc.push_back(event.startTimeUtc);
+    recEntityCode.push_back(event.recEntityCode);
+    exchangeRateCode.push_back(event.exchangeRateCode);
+    duration.push_back(event.duration);
+    charge.push_back(event.charge);
+    chargeLocal.push_back(event.chargeLocal);
+    chargeableUnits.push_back(event.chargeableUnits);
+    taxValue.push_back(event.taxValue);
+    discountValue.push_back(event.discountValue);
+    dataVolumeIncoming.push_back(event.dataVolumeIncoming);
+    dataVolumeOutgoing.push_back(event.dataVolumeOutgoing);
+    imsi.Append(event.imsi);
+    msisdn.Append(event.msisdn);
+    imei.Append(event.imei);
+    otherParty.Append(event.otherParty);
+    camelServiceUsed.push_back(event.camelServiceUsed);
+    supplServiceUsedList.push_back(event.supplServiceUsedList);
+    operatorSpecInfoList.push_back(event.operatorSpecInfoList);
+}
+
+void EventColumns::AppendRow(const EventColumns& source, size_t row)
+{
+    recordOffset.push_back(source.recordOffset[row]);
+    localTimeStamp.push_back(source.localTimeStamp[row]);
+    utcTimeOffsetCode.push_back(source.utcTimeOffsetCode[row]);
+    startTimeUtc.push_back(source.startTimeUtc[row]);
+    recEntityCode.push_back(source.recEntityCode[row]);
+    exchangeRateCode.push_back(source.exchangeRateCode[row]);
+    duration.push_back(source.duration[row]);
+    charge.push_back(source.charge[row]);
+    chargeLocal.push_back(source.chargeLocal[row]);
+    chargeableUnits.push_back(source.chargeableUnits[row]);
+    taxValue.push_back(source.taxValue[row]);
+    discountValue.push_back(source.discountValue[row]);
+    dataVolumeIncoming.push_back(source.dataVolumeIncoming[row]);
+    dataVolumeOutgoing.push_back(source.dataVolumeOutgoing[row]);
+    imsi.Append(source.imsi.At(row));
+    msisdn.Append(source.msisdn.At(row));
+    imei.Append(source.imei.At(row));
+    otherParty.Append(source.otherParty.At(row));
+    camelServiceUsed.push_back(source.camelServiceUsed[row]);
+    supplServiceUsedList.push_back(source.supplServiceUsedList[row]);
+    operatorSpecInfoList.push_back(source.operatorSpecInfoList[row]);
+}
+
+void EventColumns::Reserve(size_t rows)
+{
+    recordOffset.reserve(rows);
+    localTimeStamp.reserve(rows);
+    utcTimeOffsetCode.reserve(rows);
+    startTimeUtc.reserve(rows);
+    recEntityCode.reserve(rows);
+    exchangeRateCode.reserve(rows);
+    duration.reserve(rows);
+    charge.reserve(rows);
+    chargeLocal.reserve(rows);
+    chargeableUnits.reserve(rows);
+    taxValue.reserve(rows);
+    discountValue.reserve(rows);
+    dataVolumeIncoming.reserve(rows);
+    dataVolumeOutgoing.reserve(rows);
+    imsi.Reserve(rows, 8);
+    msisdn.Reserve(rows, 8);
+    imei.Reserve(rows, 8);
+    otherParty.Reserve(rows, 8);
+    camelServiceUsed.reserve(rows);
+    supplServiceUsedList.reserve(rows);
+    operatorSpecInfoList.reserve(rows);
+}
+
+void EventColumns::Clear()
+{
+    recordOffset.clear();
+    localTimeStamp.clear();
+    utcTimeOffsetCode.clear();
+    startTimeUtc.clear();
+    recEntityCode.clear();
+    exchangeRateCode.clear();
+    duration.clear();
+    charge.clear();
+    chargeLocal.clear();
+    chargeableUnits.clear();
+    taxValue.clear();
+    discountValue.clear();
+    dataVolumeIncoming.clear();
+    dataVolumeOutgoing.clear();
+    imsi.Clear();
+    msisdn.Clear();
+    imei.Clear();
+    otherParty.Clear();
+    camelServiceUsed.clear();
+    supplServiceUsedList.clear();
+    operatorSpecInfoList.clear();
+}
+
+void ChargeColumns::Clear()
+{
+    recordOffset.clear();
+    chargedItem.clear();
+    chargeType.clear();
+    exchangeRateCode.clear();
+    charge.clear();
+    chargeLocal.clear();
+    chargeableUnits.clear();
+    chargedUnits.clear();
+}
+
+void TaxColumns::Clear()
+{
+    recordOffset.clear();
+    taxCode.clear();
+    taxValue.clear();
+    taxableAmount.clear();
+}
+
+void EventBatch::Append(const CallEvent& event)
+{
+    FieldSet fields = Fields(event.type);
+    Columns(event.type).Append(event);
+    if (fields & FieldBit(EventField::ChargeDetail)) {
+        AppendCharges(event);
+    }
+    if (fields & FieldBit(EventField::TaxInformation)) {
+        for (const ChargeInformation& info : event.charges) {
+            AppendTaxes(event.recordOffset, info.taxes);
+        }
+        if (event.camel) {
+            AppendTaxes(event.recordOffset, event.camel->taxes);
+        }
+    }
+}
+
+void EventBatch::AppendCharges(const CallEvent& event)
+{
+    for (const ChargeInformation& info : event.charges) {
+        uint8_t chargedItem = info.chargedItem.Empty() ? 0 : info.chargedItem[0];
+        for (const ChargeDetail& detail : info.details) {
+            m_charges.recordOffset.push_back(event.recordOffset);
+            m_charges.chargedItem.push_back(chargedItem);
+            m_charges.chargeType.push_back(ParseChargeType(detail.chargeType));
+            m_charges.exchangeRateCode.push_back(info.exchangeRateCode);
+            m_charges.charge.push_back(detail.charge);
+            m_charges.chargeLocal.push_back(detail.chargeLocal);
+            m_charges.chargeableUnits.push_back(detail.chargeableUnits);
+            m_charges.chargedUnits.push_back(detail.chargedUnits);
+        }
+    }
+}
+
+void EventBatch::AppendTaxes(uint64_t recordOffset, const ArenaVector<TaxInformation>& taxes)
+{
+    for (const TaxInformation& tax : taxes) {
+        m_taxes.recordOffset.push_back(recordOffset);
+        m_taxes.taxCode.push_back(tax.taxCode);
+        m_taxes.taxValue.push_back(tax.taxValue);
+        m_taxes.taxableAmount.push_back(tax.taxableAmount);
+    }
+}
+
+void EventBatch::AssignExcept(const EventBatch& source, const std::vector<uint64_t>& dropped)
+{
+    Clear();
+    m_source = source.m_source;
+    m_fields = source.m_fields;
+    auto kept = [&dropped](uint64_t recordOffset) {
+        return !std::binary_search(dropped.begin(), dropped.end(), recordOffset);
+    };
+    for (size_t i = 0; i < kCallEventTypeCount; i++) {
+        const EventColumns& columns = source.m_columns[i];
+        for (size_t row = 0; row < columns.Size(); row++) {
+            if (kept(columns.recordOffset[row])) {
+                m_columns[i].AppendRow(columns, row);
+            }
+        }
+    }
+    const ChargeColumns& charges = source.m_charges;
+    for (size_t row = 0; row < charges.Size(); row++) {
+        if (kept(charges.recordOffset[row])) {
+            m_charges.recordOffset.push_back(charges.recordOffset[row]);
+            m_charges.chargedItem.push_back(charges.chargedItem[row]);
+            m_charges.chargeType.push_back(charges.chargeType[row]);
+            m_charges.exchangeRateCode.push_back(charges.exchangeRateCode[row]);
+            m_charges.charge.push_back(charges.charge[row]);
+            m_charges.chargeLocal.push_back(charges.chargeLocal[row]);
+            m_charges.chargeableUnits.push_back(charges.chargeableUnits[row]);
+            m_charges.chargedUnits.push_back(charges.chargedUnits[row]);
+        }
+    }
+    const TaxColumns& taxes = source.m_taxes;
+    for (size_t row = 0; row < taxes.Size(); row++) {
+        if (kept(taxes.recordOffset[row])) {
+            m_taxes.recordOffset.push_back(taxes.recordOffset[row]);
+            m_taxes.taxCode.push_back(taxes.taxCode[row]);
+            m_taxes.taxValue.push_back(taxes.taxValue[row]);
+            m_taxes.taxableAmount.push_back(taxes.taxableAmount[row]);
+        }
+    }
+}
+
+size_t EventBatch::Size() const
+{
+    size_t size = 0;
+    for (const EventColumns& columns : m_columns) {
+        size += columns.Size();
+    }
+    return size;
+}
+
+void EventBatch::Clear()
+{
+    for (EventColumns& columns : m_columns) {
+        columns.Clear();
+    }
+    m_charges.Clear();
+    m_taxes.Clear();
+}
+
+} // namespace tap3
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Tap3Types.h"
+
+namespace tap3 {
+
+// Variable-length octet strings stored back to back in one buffer.
+class BytesColumn
+{
+public:
+    BytesColumn() : m_offsets(1, 0) {}
+
+    void Append(ByteView value)
+    {
+        m_bytes.insert(m_bytes.end(), value.begin(), value.end());
+        m_offsets.push_back(static_cast<uint32_t>(m_bytes.size()));
+    }
+    ByteView At(size_t row) const
+    {
+        return ByteView(m_bytes.data() + m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+    }
+    size_t Size() const { return m_offsets.size() - 1; }
+    void Reserve(size_t rows, size_t bytesPerRow)
+    {
+        m_offsets.reserve(rows + 1);
+        m_bytes.reserve(rows * bytesPerRow);
+    }
+    void Clear()
+    {
+        m_bytes.clear();
+        m_offsets.resize(1);
+    }
+
+private:
+    std::vector<uint8_t> m_bytes;
+    std::vector<uint32_t> m_offsets;
+};
+
+// Fields materialised for each record type.
+typedef std::array<FieldSet, kCallEventTypeCount> FieldSelection;
+
+inline FieldSelection AllFields()
+{
+    FieldSelection selection;
+    selection.fill(kAllFields);
+    return selection;
+}
+
+// Structure-of-arrays buffer for the call events of one record type.
+// Row i of every column belongs to the same event. Numbers are kept in
+// their raw TBCD/BCD encoding and converted in bulk by the loader. Number
+// columns that are not decoded hold empty values, duration and data
+// volumes zero; the other numeric columns are always filled, as the
+// AuditControlInfo check reads them.
+struct EventColumns
+{
+    std::vector<uint64_t> recordOffset;
+    std::vector<uint64_t> localTimeStamp;     // YYYYMMDDHHMMSS as a number, 0 if absent
+    std::vector<int32_t> utcTimeOffsetCode;
+    std::vector<int64_t> startTimeUtc;        // epoch seconds, 0 if unknown
+    std::vector<int32_t> recEntityCode;
+    std::vector<int32_t> exchangeRateCode;
+    std::vector<int64_t> duration;
+    std::vector<int64_t> charge;
+    std::vector<int64_t> chargeLocal;
+    std::vector<int64_t> chargeableUnits;
+    std::vector<int64_t> taxValue;
+    std::vector<int64_t> discountValue;
+    std::vector<int64_t> dataVolumeIncoming;
+    std::vector<int64_t> dataVolumeOutgoing;
+    BytesColumn imsi;
+    BytesColumn msisdn;
+    BytesColumn imei;
+    BytesColumn otherParty;
+    // sub-structures left encoded by the decoder, see EventBatch::Block
+    std::vector<BlockRef> camelServiceUsed;
+    std::vector<BlockRef> supplServiceUsedList;
+    std::vector<BlockRef> operatorSpecInfoList;
+
+    size_t Size() const { return recordOffset.size(); }
+    void Append(const CallEvent& event);
+    void AppendRow(const EventColumns& source, size_t row);
+    void Reserve(size_t rows);
+    void Clear();
+};
+
+// ChargeDetail rows of the events in a batch, keyed by record offset.
+struct ChargeColumns
+{
+    std::vector<uint64_t> recordOffset;
+    std::vector<uint8_t> chargedItem;
+    std::vector<int16_t> chargeType;
+    std::vector<int32_t> exchangeRateCode;
+    std::vector<int64_t> charge;
+    std::vector<int64_t> chargeLocal;
+    std::vector<int64_t> chargeableUnits;
+    std::vector<int64_t> chargedUnits;
+
+    size_t Size() const { return recordOffset.size(); }
+    void Clear();
+};
+
+// TaxInformation rows of the events in a batch, keyed by record offset.
+struct TaxColumns
+{
+    std::vector<uint64_t> recordOffset;
+    std::vector<int32_t> taxCode;
+    std::vector<int64_t> taxValue;
+    std::vector<int64_t> taxableAmount;
+
+    size_t Size() const { return recordOffset.size(); }
+    void Clear();
+};
+
+// Decoded call events of one chunk of a file, split by record type, with
+// their charge and tax details.
+class EventBatch
+{
+public:
+    EventColumns& Columns(CallEventType type) { return m_columns[static_cast<size_t>(type)]; }
+    const EventColumns& Columns(CallEventType type) const { return m_columns[static_cast<size_t>(type)]; }
+
+    const ChargeColumns& Charges() const { return m_charges; }
+    const TaxColumns& Taxes() const { return m_taxes; }
+
+    // The decoded file, which the BlockRef columns point into. Set by the
+    // decoder; valid while the batch is handed over.
+    void SetSource(ByteView file) { m_source = file; }
+    ByteView Source() const { return m_source; }
+    // Encoded sub-structure of row, empty if the event does not have it.
+    ByteView Block(const EventColumns& columns, size_t row, BlockRef ref) const
+    {
+        return m_source.Sub(columns.recordOffset[row] + ref.offset, ref.length);
+    }
+
+    // Fields selected per event type; by default all. The decoder skips
+    // unselected numbers, durations and data volumes; charge and tax rows
+    // are appended only when selected.
+    void SetFields(const FieldSelection& fields) { m_fields = fields; }
+    const FieldSelection& Selection() const { return m_fields; }
+    FieldSet Fields(CallEventType type) const { return m_fields[static_cast<size_t>(type)]; }
+
+    void Append(const CallEvent& event);
+    // Replaces the contents with the events of source whose record offsets
+    // are not in dropped (sorted), with their charges and taxes.
+    void AssignExcept(const EventBatch& source, const std::vector<uint64_t>& dropped);
+    size_t Size() const;
+    void Clear();
+
+private:
+    void AppendCharges(const CallEvent& event);
+    void AppendTaxes(uint64_t recordOffset, const ArenaVector<TaxInformation>& taxes);
+
+    std::array<EventColumns, kCallEventTypeCount> m_columns;
+    ChargeColumns m_charges;
+    TaxColumns m_taxes;
+    ByteView m_source;
+    FieldSelection m_fields = AllFields();
+};
+
+} // namespace tap3
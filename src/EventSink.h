@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "AuditAccumulator.h"
+#include "EventColumns.h"
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+// Identification of the TAP file being loaded, taken from BatchControlInfo
+// (or Notification).
+struct FileInfo
+{
+    std::string fileName;
+    std::string sender;
+    std::string recipient;
+    std::string fileSequenceNumber;
+    int32_t specificationVersionNumber = 0;
+    int32_t releaseVersionNumber = 0;
+    bool notification = false;
+};
+
+// Totals declared by the sender in AuditControlInfo.
+struct AuditTotals
+{
+    std::string earliestCallTimeStamp;
+    std::string latestCallTimeStamp;
+    int64_t totalCharge = 0;
+    int64_t totalTaxValue = 0;
+    int64_t totalDiscountValue = 0;
+    int64_t callEventDetailsCount = 0;
+};
+
+// Progress of a staged load: every record before byteOffset has been
+// written and committed together with this checkpoint.
+struct LoadCheckpoint
+{
+    uint64_t fileSize = 0;          // of the file the checkpoint was taken on
+    uint64_t contentHash = 0;       // hash of its first and last 64 KB
+    uint64_t byteOffset = 0;        // first record not yet loaded
+    uint64_t eventCount = 0;
+    AuditAccumulator audit;         // running AuditControlInfo sums up to byteOffset
+    std::vector<RecordError> recordErrors;
+};
+
+// Destination of decoded call events. One file is loaded at a time:
+// BeginFile, any number of WriteEvents, optionally WriteAuditTotals, then
+// CommitFile or RollbackFile. Implementations decide how rows are grouped
+// into round trips.
+//
+// Sinks that support staging can also load a file in committed chunks:
+// BeginStagedFile, then WriteEvents with a WriteCheckpoint after each
+// chunk, then FinalizeFile, which publishes all staged rows at once, or
+// DiscardStagedFile, which drops them. RollbackFile only loses the rows
+// written since the last checkpoint, so a later BeginStagedFile for the
+// same file picks up from there.
+class EventSink
+{
+public:
+    virtual ~EventSink() = default;
+
+    virtual void BeginFile(const FileInfo& file) = 0;
+    virtual void WriteEvents(const EventBatch& batch) = 0;
+    virtual void WriteAuditTotals(const AuditTotals& totals) = 0;
+    virtual void CommitFile() = 0;
+    virtual void RollbackFile() = 0;
+
+    virtual bool SupportsStaging() const { return false; }
+    // Returns true and fills checkpoint when an earlier attempt at the file
+    // (same sender, recipient and file sequence number) left one.
+    virtual bool BeginStagedFile(const FileInfo&, LoadCheckpoint&)
+    {
+        throw Tap3Error("Sink does not support staged loading");
+    }
+    // Commits the rows written since the previous checkpoint with checkpoint.
+    virtual void WriteCheckpoint(const LoadCheckpoint&)
+    {
+        throw Tap3Error("Sink does not support staged loading");
+    }
+    virtual void FinalizeFile()
+    {
+        throw Tap3Error("Sink does not support staged loading");
+    }
+    virtual void DiscardStagedFile()
+    {
+        throw Tap3Error("Sink does not support staged loading");
+    }
+};
+
+} // namespace tap3
@@ -0,0 +1,563 @@
+#include "FlatFileSink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+const size_t kCsvBufferSize = 1 << 18;
+const size_t kColumnBufferSize = 1 << 16;
+
+const uint8_t kZeros[64] = {};
+
+const std::vector<std::string> kChargeColumns = { "record_offset", "charged_item", "charge_type",
+    "exchange_rate_code", "charge", "charge_local", "chargeable_units", "charged_units" };
+const std::vector<std::string> kTaxColumns = { "record_offset", "tax_code", "tax_value", "taxable_amount" };
+const std::vector<std::string> kFileColumns = { "file_name", "sender", "recipient", "file_sequence_number",
+    "specification_version", "release_version", "notification", "earliest_call_time_stamp",
+    "latest_call_time_stamp", "total_charge", "total_tax_value", "total_discount_value",
+    "call_event_details_count", "event_count" };
+// CSV rows start with the TAP file; binary files have it in their path.
+const std::vector<std::string> kCsvFileColumns = { "sender", "file_sequence_number" };
+
+// A numeric BindBuffer column: 64 or 32-bit values.
+struct NumberColumn
+{
+    const void* data;
+    size_t width;
+
+    int64_t At(size_t row) const
+    {
+        return width == sizeof(int64_t) ? static_cast<const int64_t*>(data)[row]
+            : static_cast<const int32_t*>(data)[row];
+    }
+};
+
+NumberColumn NumberColumnOf(const BindBuffer& b, EventField field)
+{
+    switch (field) {
+    case EventField::LocalTimeStamp: return { b.localTimeStamp.data(), sizeof(int64_t) };
+    case EventField::UtcTimeOffsetCode: return { b.utcTimeOffsetCode.data(), sizeof(int32_t) };
+    case EventField::StartTimeUtc: return { b.startTimeUtc.data(), sizeof(int64_t) };
+    case EventField::RecEntityCode: return { b.recEntityCode.data(), sizeof(int32_t) };
+    case EventField::ExchangeRateCode: return { b.exchangeRateCode.data(), sizeof(int32_t) };
+    case EventField::Duration: return { b.duration.data(), sizeof(int64_t) };
+    case EventField::Charge: return { b.charge.data(), sizeof(int64_t) };
+    case EventField::ChargeLocal: return { b.chargeLocal.data(), sizeof(int64_t) };
+    case EventField::ChargeableUnits: return { b.chargeableUnits.data(), sizeof(int64_t) };
+    case EventField::TaxValue: return { b.taxValue.data(), sizeof(int64_t) };
+    case EventField::DiscountValue: return { b.discountValue.data(), sizeof(int64_t) };
+    case EventField::DataVolumeIncoming: return { b.dataVolumeIncoming.data(), sizeof(int64_t) };
+    case EventField::DataVolumeOutgoing: return { b.dataVolumeOutgoing.data(), sizeof(int64_t) };
+    default: return { nullptr, 0 };
+    }
+}
+
+const FixedStringArray& TextColumnOf(const BindBuffer& b, EventField field)
+{
+    switch (field) {
+    case EventField::Imsi: return b.imsi;
+    case EventField::Msisdn: return b.msisdn;
+    case EventField::Imei: return b.imei;
+    default: return b.otherParty;
+    }
+}
+
+void AppendNumber(std::string& row, int64_t value)
+{
+    char digits[24];
+    row.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+// Quoted when it holds a separator, a quote or a line break.
+void AppendText(std::string& row, std::string_view value)
+{
+    if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+        row += value;
+        return;
+    }
+    row += '"';
+    for (char c : value) {
+        if (c == '"') {
+            row += '"';
+        }
+        row += c;
+    }
+    row += '"';
+}
+
+template <typename T>
+void WriteValues(OutputFile& file, const T* values, size_t count)
+{
+    file.Write(reinterpret_cast<const uint8_t*>(values), count * sizeof(T));
+}
+
+void WriteZeros(OutputFile& file, size_t size)
+{
+    while (size > 0) {
+        size_t chunk = std::min(size, sizeof(kZeros));
+        file.Write(kZeros, chunk);
+        size -= chunk;
+    }
+}
+
+// Each value zero-padded to the full width, whatever the slot held after
+// its terminator.
+void WriteStrings(OutputFile& file, const FixedStringArray& strings, size_t first, size_t end)
+{
+    for (size_t row = first; row < end; row++) {
+        const char* value = strings.At(row);
+        size_t length = strnlen(value, strings.Width());
+        file.Write(reinterpret_cast<const uint8_t*>(value), length);
+        WriteZeros(file, strings.Width() - length);
+    }
+}
+
+void Write(OutputFile& file, const std::string& row)
+{
+    file.Write(reinterpret_cast<const uint8_t*>(row.data()), row.size());
+}
+
+// Letters, digits, '-' and '_' pass; anything else from the TAP file is
+// replaced so it cannot leave the output directory.
+std::string PathSafe(const std::string& value)
+{
+    std::string safe = value.empty() ? "_" : value;
+    for (char& c : safe) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-')) {
+            c = '_';
+        }
+    }
+    return safe;
+}
+
+// The parent of every directory created is added to created, if given,
+// for syncing the new entries.
+void MakeDirectories(const std::string& path, std::set<std::string>* created = nullptr)
+{
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        std::string directory = path.substr(0, slash);
+        if (mkdir(directory.c_str(), 0755) == 0) {
+            if (created) {
+                size_t parent = directory.rfind('/');
+                created->insert(parent == std::string::npos ? "." : parent == 0 ? "/" : directory.substr(0, parent));
+            }
+        }
+        else if (errno != EEXIST) {
+            throw Tap3Error("Unable to create " + directory + ": " + strerror(errno));
+        }
+        if (slash == std::string::npos) {
+            return;
+        }
+    }
+}
+
+// Makes the renames into a directory durable.
+void SyncDirectory(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || fsync(fd) != 0) {
+        int err = errno;
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw Tap3Error("Unable to sync " + path + ": " + strerror(err));
+    }
+    close(fd);
+}
+
+uint32_t CallDate(uint64_t localTimeStamp)
+{
+    return static_cast<uint32_t>(localTimeStamp / 1000000);
+}
+
+// A single CSV file with a header line, or one file per column.
+void Open(std::vector<std::unique_ptr<OutputFile>>& files, const std::string& stem,
+    const std::vector<std::string>& columns, FlatFileFormat format)
+{
+    if (format == FlatFileFormat::Binary) {
+        for (const std::string& column : columns) {
+            files.emplace_back(new OutputFile(stem + "." + column + ".bin", kColumnBufferSize));
+        }
+        return;
+    }
+    files.emplace_back(new OutputFile(stem + ".csv", kCsvBufferSize));
+    std::string header;
+    for (const std::string& column : columns) {
+        header += (header.empty() ? "" : ",") + column;
+    }
+    Write(*files.back(), header + "\n");
+}
+
+std::vector<std::string> Concat(const std::vector<std::string>& a, const std::vector<std::string>& b)
+{
+    std::vector<std::string> columns(a);
+    columns.insert(columns.end(), b.begin(), b.end());
+    return columns;
+}
+
+} // namespace
+
+FlatFileSink::FlatFileSink(const std::string& directory, FlatFileFormat format, size_t batchSize,
+    const Projection& projection)
+    : ArrayBindSink(batchSize, projection), m_directory(directory), m_format(format), m_hasAuditTotals(false),
+      m_eventCount(0), m_lastPartition(nullptr), m_lastKey(0)
+{
+    m_eventColumns.push_back("record_offset");
+    for (const ProjectedColumn& column : projection.Columns()) {
+        m_eventColumns.push_back(column.name);
+    }
+    MakeDirectories(m_directory);
+}
+
+void FlatFileSink::BeginFile(const FileInfo& file)
+{
+    Reset();
+    m_file = file;
+    m_sender = PathSafe(file.sender);
+    m_stem = PathSafe(file.recipient) + "_" + PathSafe(file.fileSequenceNumber);
+    m_csvPrefix.clear();
+    AppendText(m_csvPrefix, file.sender);
+    m_csvPrefix += ',';
+    AppendText(m_csvPrefix, file.fileSequenceNumber);
+    m_csvPrefix += ',';
+}
+
+void FlatFileSink::WriteEvents(const EventBatch& batch)
+{
+    m_eventPartitions.clear();
+    if (batch.Charges().Size() > 0 || batch.Taxes().Size() > 0) {
+        for (size_t t = 0; t < kCallEventTypeCount; t++) {
+            CallEventType type = static_cast<CallEventType>(t);
+            if (!EventProjection().Loads(type)) {
+                continue;
+            }
+            const EventColumns& columns = batch.Columns(type);
+            for (size_t row = 0; row < columns.Size(); row++) {
+                PartitionKey key = static_cast<PartitionKey>(t) << 32 | CallDate(columns.localTimeStamp[row]);
+                m_eventPartitions.emplace_back(columns.recordOffset[row], &PartitionOf(key));
+            }
+        }
+        std::sort(m_eventPartitions.begin(), m_eventPartitions.end());
+    }
+    ArrayBindSink::WriteEvents(batch);
+}
+
+void FlatFileSink::WriteAuditTotals(const AuditTotals& totals)
+{
+    m_auditTotals = totals;
+    m_hasAuditTotals = true;
+}
+
+// All files are synced before the first rename, and their directories
+// before the tap_file row, so a crash never leaves the row without its
+// data. Files renamed before a failure are removed again.
+void FlatFileSink::CommitFile()
+{
+    Flush();
+    std::vector<OutputFile*> files;
+    for (auto& entry : m_partitions) {
+        for (TableFiles* table : { &entry.second.events, &entry.second.charges, &entry.second.taxes }) {
+            for (std::unique_ptr<OutputFile>& file : *table) {
+                file->Sync();
+                files.push_back(file.get());
+            }
+        }
+    }
+    size_t renamed = 0;
+    try {
+        for (; renamed < files.size(); renamed++) {
+            files[renamed]->Rename();
+        }
+        for (const std::string& directory : m_directories) {
+            SyncDirectory(directory);
+        }
+        WriteFileRow();
+    }
+    catch (...) {
+        for (size_t i = 0; i < renamed; i++) {
+            unlink(files[i]->Path().c_str());
+        }
+        throw;
+    }
+    Reset();
+}
+
+void FlatFileSink::RollbackFile()
+{
+    Discard();
+    Reset();
+}
+
+void FlatFileSink::Reset()
+{
+    // files not committed are removed with their OutputFile
+    m_partitions.clear();
+    m_lastPartition = nullptr;
+    m_eventPartitions.clear();
+    m_directories.clear();
+    m_hasAuditTotals = false;
+    m_eventCount = 0;
+}
+
+FlatFileSink::Partition& FlatFileSink::PartitionOf(PartitionKey key)
+{
+    if (m_lastPartition && m_lastKey == key) {
+        return *m_lastPartition;
+    }
+    auto it = m_partitions.find(key);
+    if (it == m_partitions.end()) {
+        char date[16];
+        snprintf(date, sizeof(date), "%08u", static_cast<uint32_t>(key));
+        std::string directory = m_directory + "/" + date + "/" + m_sender + "/"
+            + CallEventTypeName(static_cast<CallEventType>(key >> 32));
+        MakeDirectories(directory, &m_directories);
+        m_directories.insert(directory);
+        it = m_partitions.emplace(key, Partition()).first;
+        it->second.path = directory + "/" + m_stem;
+    }
+    m_lastKey = key;
+    m_lastPartition = &it->second;
+    return it->second;
+}
+
+FlatFileSink::Partition* FlatFileSink::EventPartition(uint64_t recordOffset)
+{
+    auto it = std::lower_bound(m_eventPartitions.begin(), m_eventPartitions.end(),
+        std::make_pair(recordOffset, static_cast<Partition*>(nullptr)));
+    return it != m_eventPartitions.end() && it->first == recordOffset ? it->second : nullptr;
+}
+
+void FlatFileSink::ExecuteArray(const BindBuffer& b)
+{
+    size_t first = 0;
+    while (first < b.rows) {
+        PartitionKey key = static_cast<PartitionKey>(b.recordType[first]) << 32 | CallDate(b.localTimeStamp[first]);
+        size_t end = first + 1;
+        while (end < b.rows && b.recordType[end] == b.recordType[first]
+            && CallDate(b.localTimeStamp[end]) == static_cast<uint32_t>(key)) {
+            end++;
+        }
+        WriteEventRows(PartitionOf(key), b, first, end);
+        first = end;
+    }
+    m_eventCount += b.rows;
+}
+
+// Rows of charges and taxes whose call event is not in the batch (left out
+// as a duplicate) are dropped with it.
+void FlatFileSink::ExecuteChargeArray(const ChargeColumns& c, size_t first, size_t count)
+{
+    size_t end = first + count;
+    Partition* partition = first < end ? EventPartition(c.recordOffset[first]) : nullptr;
+    while (first < end) {
+        size_t next = first + 1;
+        Partition* nextPartition = nullptr;
+        while (next < end && (nextPartition = EventPartition(c.recordOffset[next])) == partition) {
+            next++;
+        }
+        if (partition) {
+            WriteChargeRows(*partition, c, first, next);
+        }
+        first = next;
+        partition = nextPartition;
+    }
+}
+
+void FlatFileSink::ExecuteTaxArray(const TaxColumns& t, size_t first, size_t count)
+{
+    size_t end = first + count;
+    Partition* partition = first < end ? EventPartition(t.recordOffset[first]) : nullptr;
+    while (first < end) {
+        size_t next = first + 1;
+        Partition* nextPartition = nullptr;
+        while (next < end && (nextPartition = EventPartition(t.recordOffset[next])) == partition) {
+            next++;
+        }
+        if (partition) {
+            WriteTaxRows(*partition, t, first, next);
+        }
+        first = next;
+        partition = nextPartition;
+    }
+}
+
+void FlatFileSink::WriteEventRows(Partition& partition, const BindBuffer& b, size_t first, size_t end)
+{
+    const Projection& projection = EventProjection();
+    FieldSet fields = projection.Fields(static_cast<CallEventType>(b.recordType[first]));
+    if (partition.events.empty()) {
+        Open(partition.events, partition.path, m_format == FlatFileFormat::Binary ? m_eventColumns
+            : Concat(Concat(kCsvFileColumns, { "record_type" }), m_eventColumns), m_format);
+    }
+    if (m_format == FlatFileFormat::Binary) {
+        WriteValues(*partition.events[0], &b.recordOffset[first], end - first);
+        for (size_t i = 0; i < projection.Columns().size(); i++) {
+            const ProjectedColumn& column = projection.Columns()[i];
+            OutputFile& file = *partition.events[i + 1];
+            if (column.text) {
+                const FixedStringArray& strings = TextColumnOf(b, column.field);
+                if (fields & FieldBit(column.field)) {
+                    WriteStrings(file, strings, first, end);
+                }
+                else {
+                    WriteZeros(file, (end - first) * strings.Width());
+                }
+                continue;
+            }
+            NumberColumn values = NumberColumnOf(b, column.field);
+            if (fields & FieldBit(column.field)) {
+                file.Write(static_cast<const uint8_t*>(values.data) + first * values.width,
+                    (end - first) * values.width);
+            }
+            else {
+                WriteZeros(file, (end - first) * values.width);
+            }
+        }
+        return;
+    }
+    OutputFile& file = *partition.events[0];
+    for (size_t row = first; row < end; row++) {
+        m_row.assign(m_csvPrefix);
+        AppendNumber(m_row, b.recordType[row]);
+        m_row += ',';
+        AppendNumber(m_row, b.recordOffset[row]);
+        for (const ProjectedColumn& column : projection.Columns()) {
+            m_row += ',';
+            if (!(fields & FieldBit(column.field))) {
+                continue;
+            }
+            if (column.text) {
+                AppendText(m_row, TextColumnOf(b, column.field).At(row));
+            }
+            else {
+                AppendNumber(m_row, NumberColumnOf(b, column.field).At(row));
+            }
+        }
+        m_row += '\n';
+        Write(file, m_row);
+    }
+}
+
+void FlatFileSink::WriteChargeRows(Partition& partition, const ChargeColumns& c, size_t first, size_t end)
+{
+    if (partition.charges.empty()) {
+        Open(partition.charges, partition.path + ".charge_detail", m_format == FlatFileFormat::Binary
+            ? kChargeColumns : Concat(kCsvFileColumns, kChargeColumns), m_format);
+    }
+    size_t count = end - first;
+    if (m_format == FlatFileFormat::Binary) {
+        WriteValues(*partition.charges[0], &c.recordOffset[first], count);
+        WriteValues(*partition.charges[1], &c.chargedItem[first], count);
+        WriteValues(*partition.charges[2], &c.chargeType[first], count);
+        WriteValues(*partition.charges[3], &c.exchangeRateCode[first], count);
+        WriteValues(*partition.charges[4], &c.charge[first], count);
+        WriteValues(*partition.charges[5], &c.chargeLocal[first], count);
+        WriteValues(*partition.charges[6], &c.chargeableUnits[first], count);
+        WriteValues(*partition.charges[7], &c.chargedUnits[first], count);
+        return;
+    }
+    for (size_t i = first; i < end; i++) {
+        m_row.assign(m_csvPrefix);
+        AppendNumber(m_row, static_cast<int64_t>(c.recordOffset[i]));
+        m_row += ',';
+        if (c.chargedItem[i]) {
+            m_row += static_cast<char>(c.chargedItem[i]);
+        }
+        for (int64_t value : { static_cast<int64_t>(c.chargeType[i]), static_cast<int64_t>(c.exchangeRateCode[i]),
+                 c.charge[i], c.chargeLocal[i], c.chargeableUnits[i], c.chargedUnits[i] }) {
+            m_row += ',';
+            AppendNumber(m_row, value);
+        }
+        m_row += '\n';
+        Write(*partition.charges[0], m_row);
+    }
+}
+
+void FlatFileSink::WriteTaxRows(Partition& partition, const TaxColumns& t, size_t first, size_t end)
+{
+    if (partition.taxes.empty()) {
+        Open(partition.taxes, partition.path + ".tax_information", m_format == FlatFileFormat::Binary
+            ? kTaxColumns : Concat(kCsvFileColumns, kTaxColumns), m_format);
+    }
+    size_t count = end - first;
+    if (m_format == FlatFileFormat::Binary) {
+        WriteValues(*partition.taxes[0], &t.recordOffset[first], count);
+        WriteValues(*partition.taxes[1], &t.taxCode[first], count);
+        WriteValues(*partition.taxes[2], &t.taxValue[first], count);
+        WriteValues(*partition.taxes[3], &t.taxableAmount[first], count);
+        return;
+    }
+    for (size_t i = first; i < end; i++) {
+        m_row.assign(m_csvPrefix);
+        AppendNumber(m_row, static_cast<int64_t>(t.recordOffset[i]));
+        for (int64_t value : { static_cast<int64_t>(t.taxCode[i]), t.taxValue[i], t.taxableAmount[i] }) {
+            m_row += ',';
+            AppendNumber(m_row, value);
+        }
+        m_row += '\n';
+        Write(*partition.taxes[0], m_row);
+    }
+}
+
+// Written as CSV in both formats: one small row per TAP file.
+void FlatFileSink::WriteFileRow()
+{
+    std::string directory = m_directory + "/tap_file/" + m_sender;
+    std::set<std::string> directories;
+    MakeDirectories(directory, &directories);
+    directories.insert(directory);
+    TableFiles files;
+    Open(files, directory + "/" + m_stem, kFileColumns, FlatFileFormat::Csv);
+    m_row.clear();
+    for (const std::string* text : { &m_file.fileName, &m_file.sender, &m_file.recipient,
+             &m_file.fileSequenceNumber }) {
+        AppendText(m_row, *text);
+        m_row += ',';
+    }
+    AppendNumber(m_row, m_file.specificationVersionNumber);
+    m_row += ',';
+    AppendNumber(m_row, m_file.releaseVersionNumber);
+    m_row += ',';
+    AppendNumber(m_row, m_file.notification ? 1 : 0);
+    m_row += ',';
+    if (m_hasAuditTotals) {
+        AppendText(m_row, m_auditTotals.earliestCallTimeStamp);
+        m_row += ',';
+        AppendText(m_row, m_auditTotals.latestCallTimeStamp);
+        for (int64_t value : { m_auditTotals.totalCharge, m_auditTotals.totalTaxValue,
+                 m_auditTotals.totalDiscountValue, m_auditTotals.callEventDetailsCount }) {
+            m_row += ',';
+            AppendNumber(m_row, value);
+        }
+    }
+    else {
+        m_row += ",,,,,";
+    }
+    m_row += ',';
+    AppendNumber(m_row, static_cast<int64_t>(m_eventCount));
+    m_row += '\n';
+    Write(*files[0], m_row);
+    files[0]->Commit();
+    try {
+        for (const std::string& synced : directories) {
+            SyncDirectory(synced);
+        }
+    }
+    catch (...) {
+        unlink(files[0]->Path().c_str());
+        throw;
+    }
+}
+
+} // namespace tap3
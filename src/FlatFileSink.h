@@ -0,0 +1,108 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "ArrayBindSink.h"
+#include "BerWriter.h"
+
+namespace tap3 {
+
+enum class FlatFileFormat
+{
+    Csv,
+    Binary
+};
+
+// Writes call events into prepared files for direct-path bulk loads
+// (SQL*Loader DIRECT=TRUE, COPY) instead of inserting them. Rows are
+// partitioned by local call date, partner (the sender) and record type:
+//
+//   <dir>/<YYYYMMDD>/<sender>/<type>/<recipient>_<fsn>.csv
+//   <dir>/<YYYYMMDD>/<sender>/<type>/<recipient>_<fsn>.charge_detail.csv
+//   <dir>/<YYYYMMDD>/<sender>/<type>/<recipient>_<fsn>.tax_information.csv
+//   <dir>/tap_file/<sender>/<recipient>_<fsn>.csv
+//
+// so every partition directory holds one file per TAP file that had events
+// there, and a day or partner is loaded by pointing the loader at its
+// directory. Charge and tax rows go to the partition of their call event.
+// CSV files start with a header line; event rows hold sender,
+// file_sequence_number, record_type, record_offset and the projected
+// columns, with empty (NULL) values for columns the record type does not
+// project. Binary output writes one file per column instead
+// (<stem>.<column>.bin) of native fixed-width values: 64/32/16-bit
+// integers and zero-padded strings as in BindBuffer, zero where CSV would
+// be NULL; sender, file sequence number and record type are given by the
+// path.
+// All files of a TAP file are buffered and fdatasync'ed by CommitFile, then
+// renamed into place and their directories synced; the tap_file row with
+// the audit totals and event count is written last and marks the TAP file
+// complete. A failed commit and RollbackFile remove everything written for
+// the file. Staging is not supported, the
+// whole TAP file is the unit of output.
+class FlatFileSink : public ArrayBindSink
+{
+public:
+    FlatFileSink(const std::string& directory, FlatFileFormat format, size_t batchSize,
+        const Projection& projection = Projection());
+
+    void BeginFile(const FileInfo& file) override;
+    void WriteEvents(const EventBatch& batch) override;
+    void WriteAuditTotals(const AuditTotals& totals) override;
+    void CommitFile() override;
+    void RollbackFile() override;
+
+protected:
+    void ExecuteArray(const BindBuffer& buffer) override;
+    void ExecuteChargeArray(const ChargeColumns& charges, size_t first, size_t count) override;
+    void ExecuteTaxArray(const TaxColumns& taxes, size_t first, size_t count) override;
+
+private:
+    // The files of one table in one partition: a single CSV file or one
+    // file per column. Opened on the first row.
+    typedef std::vector<std::unique_ptr<OutputFile>> TableFiles;
+
+    struct Partition
+    {
+        std::string path;       // directory and file name stem
+        TableFiles events;
+        TableFiles charges;
+        TableFiles taxes;
+    };
+
+    // Record type in the high, local call date (YYYYMMDD) in the low half.
+    typedef uint64_t PartitionKey;
+
+    Partition& PartitionOf(PartitionKey key);
+    void WriteEventRows(Partition& partition, const BindBuffer& b, size_t first, size_t end);
+    void WriteChargeRows(Partition& partition, const ChargeColumns& c, size_t first, size_t end);
+    void WriteTaxRows(Partition& partition, const TaxColumns& t, size_t first, size_t end);
+    Partition* EventPartition(uint64_t recordOffset);
+    void WriteFileRow();
+    void Reset();
+
+    std::string m_directory;
+    FlatFileFormat m_format;
+    std::vector<std::string> m_eventColumns;
+    FileInfo m_file;
+    std::string m_sender;               // m_file.sender made safe for a path
+    std::string m_stem;                 // <recipient>_<fsn>
+    std::string m_csvPrefix;            // sender and file sequence number of CSV rows
+    bool m_hasAuditTotals;
+    AuditTotals m_auditTotals;
+    uint64_t m_eventCount;
+    std::map<PartitionKey, Partition> m_partitions;
+    Partition* m_lastPartition;
+    PartitionKey m_lastKey;
+    // partitions of the events of the batch being written, by record
+    // offset, for placing its charge and tax rows
+    std::vector<std::pair<uint64_t, Partition*>> m_eventPartitions;
+    // partition directories and the parents of those created for the file,
+    // synced on commit
+    std::set<std::string> m_directories;
+    std::string m_row;
+};
+
+} // namespace tap3
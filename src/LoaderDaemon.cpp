@@ -0,0 +1,158 @@
+#include "LoaderDaemon.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "DirectoryWatcher.h"
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+LoaderDaemon::LoaderDaemon(const DaemonSettings& settings, SessionPool::Factory sinkFactory)
+    : m_settings(settings), m_sessions(sinkFactory, settings.sessionCount), m_queue(settings.queueCapacity),
+      m_stopping(false), m_watcher(nullptr)
+{
+}
+
+void LoaderDaemon::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        m_stopping = true;
+    }
+    m_stopped.notify_all();
+    if (DirectoryWatcher* watcher = m_watcher) {
+        watcher->Stop();
+    }
+    m_queue.Close();
+}
+
+void LoaderDaemon::Run()
+{
+    DirectoryWatcher watcher(m_settings.inputDirectory);
+    m_watcher = &watcher;
+    if (m_stopping) {
+        watcher.Stop();
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < m_settings.workerCount; i++) {
+        workers.emplace_back(&LoaderDaemon::WorkerLoop, this);
+    }
+    try {
+        watcher.Run([this](const std::string& path) { Enqueue(path); });
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "Directory watcher failed: " << ex.what() << std::endl;
+    }
+    m_queue.Close();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    m_watcher = nullptr;
+}
+
+void LoaderDaemon::Enqueue(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        if (!m_pending.insert(path).second) {
+            return;
+        }
+    }
+    if (!m_queue.Push(path)) {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_pending.erase(path);
+    }
+}
+
+void LoaderDaemon::WorkerLoop()
+{
+    TapLoader loader(m_settings.loader);
+    std::string path;
+    while (m_queue.Pop(path)) {
+        // on a stop the file stays in the inbound directory for the next start
+        std::chrono::milliseconds delay = m_settings.retryDelay;
+        while (!LoadQueuedFile(loader, path) && WaitForRetry(delay)) {
+            delay = std::min(delay * 2, m_settings.retryMaxDelay);
+        }
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_pending.erase(path);
+    }
+}
+
+bool LoaderDaemon::LoadQueuedFile(TapLoader& loader, const std::string& path)
+{
+    std::unique_ptr<PooledSession> session;
+    try {
+        session = m_sessions.Checkout();
+    }
+    catch (const std::exception& ex) {
+        std::cerr << path << ": unable to open database session: " << ex.what() << std::endl;
+        return false;
+    }
+    bool done = true;
+    try {
+        LoadResult result = loader.LoadFile(path, **session);
+        std::cout << path << ": loaded " << result.eventCount << " events" << std::endl;
+        if (result.duplicateEventCount > 0) {
+            std::cout << path << ": " << result.duplicateEventCount << " duplicate events left out"
+                << std::endl;
+        }
+        if (!result.rapFile.empty()) {
+            std::cout << path << ": " << result.severeErrorCount << " records returned in "
+                << result.rapFile << std::endl;
+        }
+        MoveFile(path, m_settings.doneDirectory);
+    }
+    catch (const DatabaseError& ex) {
+        // not the file's fault: drop the session, keep the file for a retry
+        std::cerr << path << ": " << ex.what() << std::endl;
+        session->Invalidate();
+        done = false;
+    }
+    catch (const Tap3Error& ex) {
+        std::cerr << path << ": " << ex.what() << std::endl;
+        MoveFile(path, m_settings.errorDirectory);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << path << ": " << ex.what() << std::endl;
+        session->Invalidate();
+        MoveFile(path, m_settings.errorDirectory);
+    }
+    // the loader recorded the file in the metrics, loaded or not
+    if (m_settings.loader.metrics && !m_settings.metricsFile.empty()) {
+        try {
+            m_settings.loader.metrics->WriteTextFile(m_settings.metricsFile);
+        }
+        catch (const std::exception& ex) {
+            std::cerr << ex.what() << std::endl;
+        }
+    }
+    return done;
+}
+
+bool LoaderDaemon::WaitForRetry(std::chrono::milliseconds delay)
+{
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    return !m_stopped.wait_for(lock, delay, [this] { return m_stopping.load(); });
+}
+
+void LoaderDaemon::MoveFile(const std::string& path, const std::string& directory)
+{
+    if (directory.empty()) {
+        return;
+    }
+    size_t slash = path.rfind('/');
+    std::string target = directory + "/" + (slash == std::string::npos ? path : path.substr(slash + 1));
+    if (rename(path.c_str(), target.c_str()) != 0) {
+        std::cerr << "Unable to move " << path << " to " << directory << ": " << strerror(errno) << std::endl;
+    }
+}
+
+} // namespace tap3
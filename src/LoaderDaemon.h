@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include "BoundedQueue.h"
+#include "SessionPool.h"
+#include "TapLoader.h"
+
+namespace tap3 {
+
+class DirectoryWatcher;
+
+struct DaemonSettings
+{
+    std::string inputDirectory;
+    std::string doneDirectory;       // loaded files are moved here
+    std::string errorDirectory;      // files that failed to load are moved here
+    size_t workerCount = 4;
+    size_t queueCapacity = 64;
+    size_t sessionCount = 4;         // database sessions shared by the workers
+    std::string metricsFile;         // Prometheus textfile rewritten after each file (needs loader.metrics)
+    std::chrono::milliseconds retryDelay{ 1000 };       // first wait after a database failure
+    std::chrono::milliseconds retryMaxDelay{ 60000 };
+    LoaderSettings loader;
+};
+
+// Long-running loader: a DirectoryWatcher feeds file names into a bounded
+// queue served by a fixed pool of workers. Workers check a session out of
+// a shared SessionPool for each file, so database sessions stay warm
+// between files, and at most workerCount files are loaded concurrently
+// however many arrive at once. A file that fails on the database side (no
+// session, or a DatabaseError) is not the file's fault: the worker keeps
+// it and tries again after a backoff, doubling up to retryMaxDelay.
+class LoaderDaemon
+{
+public:
+    LoaderDaemon(const DaemonSettings& settings, SessionPool::Factory sinkFactory);
+
+    // Runs until Stop() is called (e.g. from a signal handler thread).
+    void Run();
+    void Stop();
+
+private:
+    void Enqueue(const std::string& path);
+    void WorkerLoop();
+    // False if the file should be tried again later.
+    bool LoadQueuedFile(TapLoader& loader, const std::string& path);
+    // False if the daemon was stopped during the wait.
+    bool WaitForRetry(std::chrono::milliseconds delay);
+    void MoveFile(const std::string& path, const std::string& directory);
+
+    DaemonSettings m_settings;
+    SessionPool m_sessions;
+    BoundedQueue<std::string> m_queue;
+    std::atomic<bool> m_stopping;
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopped;
+    std::atomic<DirectoryWatcher*> m_watcher;
+    std::mutex m_pendingMutex;
+    std::set<std::string> m_pending;   // queued or being loaded
+};
+
+} // namespace tap3
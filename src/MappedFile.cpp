@@ -0,0 +1,441 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+// zstd input needs the library at build time (and -lzstd); without it
+// .zst files are rejected with an error.
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define TAP3_ZSTD 1
+#endif
+
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+const uint8_t kGzipMagic[] = { 0x1F, 0x8B };
+const uint8_t kZstdMagic[] = { 0x28, 0xB5, 0x2F, 0xFD };
+
+const size_t kReadBufferSize = 1 << 20;        // compressed bytes per read
+const size_t kMinInflateStep = 1 << 20;        // free output space per decompressor call
+
+std::mutex inflateMutex;
+std::condition_variable inflateReleased;
+MappedFile::InflateLimits inflateLimits;
+size_t inflatedFiles = 0;                   // files holding a slot
+thread_local size_t threadInflatedFiles = 0;
+
+// Waits for one of the maxConcurrent slots. A thread that already holds
+// inflated data (a compressed file inside a zip member) takes the next one
+// without waiting, so it cannot block on itself.
+void AcquireInflateSlot()
+{
+    if (threadInflatedFiles++ > 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(inflateMutex);
+    inflateReleased.wait(lock, [] {
+        return inflateLimits.maxConcurrent == 0 || inflatedFiles < inflateLimits.maxConcurrent;
+    });
+    inflatedFiles++;
+}
+
+void ReleaseInflateSlot()
+{
+    if (--threadInflatedFiles > 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(inflateMutex);
+        inflatedFiles--;
+    }
+    inflateReleased.notify_one();
+}
+
+// Anonymous memory the decompressor writes into. Grown by remapping, so
+// already inflated bytes are never copied. Inflating more than limit bytes
+// throws.
+class InflateBuffer
+{
+public:
+    InflateBuffer(const std::string& path, size_t capacity, uint64_t limit)
+        : m_path(path), m_data(nullptr), m_size(0), m_capacity(0),
+          m_limit(static_cast<size_t>(std::min<uint64_t>(limit, SIZE_MAX - kMinInflateStep)))
+    {
+        Reserve(std::max(std::min(capacity, m_limit + 1), kMinInflateStep));
+    }
+
+    ~InflateBuffer()
+    {
+        if (m_data) {
+            munmap(m_data, m_capacity);
+        }
+    }
+
+    // Free space after the inflated data: kMinInflateStep bytes, or up to
+    // one byte past the limit.
+    uint8_t* Space()
+    {
+        if (m_size > m_limit) {
+            throw Tap3Error(m_path + " inflates to more than " + std::to_string(m_limit) + " bytes");
+        }
+        if (m_capacity - m_size < kMinInflateStep && m_capacity <= m_limit) {
+            Reserve(std::min(std::max(m_capacity * 2, m_size + kMinInflateStep), m_limit + 1));
+        }
+        return m_data + m_size;
+    }
+    size_t Available() const { return std::min(m_capacity, m_limit + 1) - m_size; }
+    void Commit(size_t bytes) { m_size += bytes; }
+
+    // Hands the mapping over, trimmed to the inflated size.
+    void Release(const uint8_t*& data, size_t& size, size_t& mappedSize)
+    {
+        if (m_size > m_limit) {
+            throw Tap3Error(m_path + " inflates to more than " + std::to_string(m_limit) + " bytes");
+        }
+        long page = sysconf(_SC_PAGESIZE);
+        size_t used = std::max<size_t>((m_size + page - 1) / page * page, page);
+        if (used < m_capacity) {
+            munmap(m_data + used, m_capacity - used);
+            m_capacity = used;
+        }
+        data = m_data;
+        size = m_size;
+        mappedSize = m_capacity;
+        m_data = nullptr;
+    }
+
+private:
+    void Reserve(size_t capacity)
+    {
+        void* addr = m_data
+            ? mremap(m_data, m_capacity, capacity, MREMAP_MAYMOVE)
+            : mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            throw Tap3Error("Unable to allocate " + std::to_string(capacity) + " bytes to inflate " + m_path
+                + ": " + strerror(errno));
+        }
+        m_data = static_cast<uint8_t*>(addr);
+        m_capacity = capacity;
+    }
+
+    const std::string& m_path;
+    uint8_t* m_data;
+    size_t m_size;
+    size_t m_capacity;
+    size_t m_limit;
+};
+
+// Compressed bytes, read from a file through a fixed buffer or taken from
+// memory, in pieces of at most kReadBufferSize.
+class CompressedInput
+{
+public:
+    CompressedInput(int fd, const std::string& path) : m_fd(fd), m_path(path), m_buffer(kReadBufferSize) {}
+    CompressedInput(ByteView data, const std::string& path) : m_fd(-1), m_path(path), m_data(data) {}
+
+    // Empty at the end of the input.
+    ByteView Next()
+    {
+        if (m_fd < 0) {
+            ByteView piece = m_data.Sub(0, std::min(m_data.size, kReadBufferSize));
+            m_data = m_data.Sub(piece.size, m_data.size - piece.size);
+            return piece;
+        }
+        for (;;) {
+            ssize_t n = read(m_fd, m_buffer.data(), m_buffer.size());
+            if (n >= 0) {
+                return ByteView(m_buffer.data(), static_cast<size_t>(n));
+            }
+            if (errno != EINTR) {
+                throw Tap3Error("Unable to read " + m_path + ": " + strerror(errno));
+            }
+        }
+    }
+
+private:
+    int m_fd;
+    const std::string& m_path;
+    std::vector<uint8_t> m_buffer;
+    ByteView m_data;
+};
+
+// Concatenated gzip members are inflated one after another, as gunzip does.
+// Raw deflate data (zip members) is a single stream without framing.
+void InflateGzip(CompressedInput& input, const std::string& path, bool raw, InflateBuffer& out)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, raw ? -15 : 15 + 16) != Z_OK) {
+        throw Tap3Error("Unable to initialise zlib for " + path);
+    }
+    struct StreamEnd
+    {
+        z_stream& stream;
+        ~StreamEnd() { inflateEnd(&stream); }
+    } streamEnd{ stream };
+
+    int status = Z_OK;
+    for (;;) {
+        if (stream.avail_in == 0) {
+            ByteView piece = input.Next();
+            if (piece.size == 0) {
+                break;
+            }
+            stream.next_in = const_cast<Bytef*>(piece.data);
+            stream.avail_in = static_cast<uInt>(piece.size);
+        }
+        if (status == Z_STREAM_END) {
+            if (raw) {
+                break;
+            }
+            inflateReset(&stream);
+        }
+        stream.next_out = out.Space();
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(out.Available(), UINT_MAX));
+        uInt before = stream.avail_out;
+        status = inflate(&stream, Z_NO_FLUSH);
+        out.Commit(before - stream.avail_out);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            throw Tap3Error("Corrupt gzip data in " + path + (stream.msg ? std::string(": ") + stream.msg : ""));
+        }
+    }
+    if (status != Z_STREAM_END) {
+        throw Tap3Error("Truncated gzip data in " + path);
+    }
+}
+
+#ifdef TAP3_ZSTD
+
+void InflateZstd(CompressedInput& input, const std::string& path, InflateBuffer& out)
+{
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (!stream) {
+        throw Tap3Error("Unable to initialise zstd for " + path);
+    }
+    struct StreamEnd
+    {
+        ZSTD_DStream* stream;
+        ~StreamEnd() { ZSTD_freeDStream(stream); }
+    } streamEnd{ stream };
+    ZSTD_initDStream(stream);
+
+    size_t remaining = 0;       // 0 once a frame is complete
+    for (ByteView piece = input.Next(); piece.size > 0; piece = input.Next()) {
+        ZSTD_inBuffer in = { piece.data, piece.size, 0 };
+        while (in.pos < in.size) {
+            ZSTD_outBuffer output = { out.Space(), out.Available(), 0 };
+            remaining = ZSTD_decompressStream(stream, &output, &in);
+            if (ZSTD_isError(remaining)) {
+                throw Tap3Error("Corrupt zstd data in " + path + ": " + ZSTD_getErrorName(remaining));
+            }
+            out.Commit(output.pos);
+        }
+    }
+    // the decoder may still hold output after the last input byte
+    while (remaining != 0) {
+        ZSTD_inBuffer in = { nullptr, 0, 0 };
+        ZSTD_outBuffer output = { out.Space(), out.Available(), 0 };
+        size_t result = ZSTD_decompressStream(stream, &output, &in);
+        if (ZSTD_isError(result)) {
+            throw Tap3Error("Corrupt zstd data in " + path + ": " + ZSTD_getErrorName(result));
+        }
+        out.Commit(output.pos);
+        if (output.pos == 0) {
+            break;
+        }
+        remaining = result;
+    }
+    if (remaining != 0) {
+        throw Tap3Error("Truncated zstd data in " + path);
+    }
+}
+
+#endif
+
+// Expected inflated size, to map enough memory up front in most cases.
+// head is the start of the compressed data, tail its last 4 bytes. Sizes
+// the header states exactly, or as a lower bound, are checked against the
+// limit before anything is inflated.
+size_t InflatedSizeHint(ByteView head, ByteView tail, size_t size, MappedFile::Format format,
+    const std::string& path, uint64_t limit)
+{
+    uint64_t stated = 0;
+    if (format == MappedFile::Format::Gzip && size >= 18 && tail.size == 4) {
+        // ISIZE trailer: the size modulo 2^32 of the last member
+        const uint8_t* isize = tail.data;
+        stated = isize[0] | isize[1] << 8 | isize[2] << 16 | static_cast<uint64_t>(isize[3]) << 24;
+    }
+#ifdef TAP3_ZSTD
+    if (format == MappedFile::Format::Zstd) {
+        unsigned long long content = ZSTD_getFrameContentSize(head.data, head.size);
+        if (content != ZSTD_CONTENTSIZE_UNKNOWN && content != ZSTD_CONTENTSIZE_ERROR) {
+            stated = content;
+        }
+    }
+#else
+    (void)head;
+#endif
+    if (stated > limit) {
+        throw Tap3Error(path + " inflates to " + std::to_string(stated) + " bytes, more than the limit of "
+            + std::to_string(limit));
+    }
+    if (stated >= size) {
+        return static_cast<size_t>(stated);
+    }
+    // TAP files compress about 5 to 10 times
+    return static_cast<size_t>(std::min<uint64_t>(static_cast<uint64_t>(size) * 8, limit));
+}
+
+// Inflates input into anonymous memory and hands the mapping over, with an
+// inflate slot the MappedFile releases when it unmaps the data.
+void Inflate(CompressedInput& input, const std::string& path, size_t sizeHint, uint64_t limit,
+    MappedFile::Format format, const uint8_t*& data, size_t& size, size_t& mappedSize)
+{
+    AcquireInflateSlot();
+    try {
+        InflateBuffer out(path, sizeHint, limit);
+        if (format == MappedFile::Format::Zstd) {
+#ifdef TAP3_ZSTD
+            InflateZstd(input, path, out);
+#else
+            (void)input;
+            throw Tap3Error(path + " is zstd compressed, but the loader was built without zstd");
+#endif
+        }
+        else {
+            InflateGzip(input, path, format == MappedFile::Format::Deflate, out);
+        }
+        out.Release(data, size, mappedSize);
+    }
+    catch (...) {
+        ReleaseInflateSlot();
+        throw;
+    }
+}
+
+} // namespace
+
+void MappedFile::SetInflateLimits(const InflateLimits& limits)
+{
+    {
+        std::lock_guard<std::mutex> lock(inflateMutex);
+        inflateLimits = limits;
+    }
+    inflateReleased.notify_all();
+}
+
+MappedFile::InflateLimits MappedFile::GetInflateLimits()
+{
+    std::lock_guard<std::mutex> lock(inflateMutex);
+    return inflateLimits;
+}
+
+MappedFile::Format MappedFile::Detect(ByteView head)
+{
+    if (head.size >= sizeof(kGzipMagic) && memcmp(head.data, kGzipMagic, sizeof(kGzipMagic)) == 0) {
+        return Format::Gzip;
+    }
+    if (head.size >= sizeof(kZstdMagic) && memcmp(head.data, kZstdMagic, sizeof(kZstdMagic)) == 0) {
+        return Format::Zstd;
+    }
+    return Format::Plain;
+}
+
+MappedFile::MappedFile(const std::string& path)
+    : m_path(path), m_data(nullptr), m_size(0), m_mappedSize(0), m_compressed(false)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw Tap3Error("Unable to open " + path + ": " + strerror(errno));
+    }
+    try {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            throw Tap3Error("Unable to stat " + path + ": " + strerror(errno));
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        uint8_t head[18];
+        uint8_t tail[4];
+        ssize_t headSize = size > 0 ? pread(fd, head, sizeof(head), 0) : 0;
+        Format format = Detect(ByteView(head, headSize > 0 ? static_cast<size_t>(headSize) : 0));
+        if (format == Format::Plain) {
+            Map(fd, size);
+        }
+        else {
+            ssize_t tailSize = size >= sizeof(tail) ? pread(fd, tail, sizeof(tail), static_cast<off_t>(size - 4)) : 0;
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            CompressedInput input(fd, m_path);
+            uint64_t limit = GetInflateLimits().maxInflatedSize;
+            size_t hint = InflatedSizeHint(ByteView(head, static_cast<size_t>(headSize)),
+                ByteView(tail, tailSize > 0 ? static_cast<size_t>(tailSize) : 0), size, format, m_path, limit);
+            Inflate(input, m_path, hint, limit, format, m_data, m_size, m_mappedSize);
+            m_compressed = true;
+        }
+    }
+    catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+MappedFile::MappedFile(const std::string& name, ByteView data, Format format)
+    : m_path(name), m_data(nullptr), m_size(0), m_mappedSize(0), m_compressed(false)
+{
+    if (format == Format::Plain) {
+        format = Detect(data);
+    }
+    if (format == Format::Plain) {
+        // a view of memory owned by the caller
+        m_data = data.data;
+        m_size = data.size;
+        return;
+    }
+    CompressedInput input(data, m_path);
+    ByteView tail = data.size >= 4 ? data.Sub(data.size - 4, 4) : ByteView();
+    uint64_t limit = GetInflateLimits().maxInflatedSize;
+    size_t hint = InflatedSizeHint(data.Sub(0, std::min<size_t>(data.size, 18)), tail, data.size, format,
+        m_path, limit);
+    Inflate(input, m_path, hint, limit, format, m_data, m_size, m_mappedSize);
+    m_compressed = true;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data && m_mappedSize > 0) {
+        munmap(const_cast<uint8_t*>(m_data), m_mappedSize);
+    }
+    if (m_compressed) {
+        ReleaseInflateSlot();
+    }
+}
+
+void MappedFile::Map(int fd, size_t size)
+{
+    m_size = size;
+    m_mappedSize = size;
+    if (m_size > 0) {
+        void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            throw Tap3Error("Unable to map " + m_path + ": " + strerror(errno));
+        }
+        madvise(addr, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const uint8_t*>(addr);
+    }
+}
+
+} // namespace tap3
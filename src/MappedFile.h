@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "ByteView.h"
+
+namespace tap3 {
+
+// Read-only memory mapping of a whole file. The mapping is hinted for
+// sequential access so the kernel reads ahead and drops consumed pages.
+// gzip and zstd files, recognised by their magic number, are streamed
+// through a fixed read buffer into the decompressor and inflated into
+// anonymous memory instead, so no decompressed copy touches the disk.
+// Unlike mapped file pages, the inflated pages are dirty and cannot be
+// dropped: the whole uncompressed file stays resident until the MappedFile
+// is destroyed. This is bounded by InflateLimits. Either way View() is the
+// uncompressed file.
+class MappedFile
+{
+public:
+    enum class Format : uint8_t
+    {
+        Plain,
+        Gzip,
+        Zstd,
+        Deflate         // raw deflate stream, as in zip members
+    };
+
+    // Process-wide bounds on inflated files.
+    struct InflateLimits
+    {
+        // larger files are rejected with Tap3Error, before inflating when
+        // the gzip trailer or zstd frame header states the size
+        uint64_t maxInflatedSize = uint64_t(2) << 30;
+        // files holding inflated data at once, 0 for no limit; further
+        // compressed files wait in the constructor. A thread holding one
+        // takes more without waiting, and must destroy its MappedFiles itself.
+        size_t maxConcurrent = 4;
+    };
+
+    static void SetInflateLimits(const InflateLimits& limits);
+    static InflateLimits GetInflateLimits();
+
+    explicit MappedFile(const std::string& path);
+    // A file held in memory, e.g. an archive member. Plain data (format
+    // Plain and no gzip or zstd magic) is viewed in place and must outlive
+    // this object; compressed data is inflated.
+    MappedFile(const std::string& name, ByteView data, Format format = Format::Plain);
+    ~MappedFile();
+
+    // Compression recognised by the magic number at the start of head.
+    static Format Detect(ByteView head);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::string& Path() const { return m_path; }
+    ByteView View() const { return ByteView(m_data, m_size); }
+    size_t Size() const { return m_size; }
+    bool Compressed() const { return m_compressed; }
+
+private:
+    void Map(int fd, size_t size);
+
+    std::string m_path;
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_mappedSize;            // 0 for a view of the caller's memory
+    bool m_compressed;
+};
+
+} // namespace tap3
@@ -0,0 +1,148 @@
+#include "Metrics.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+const double kBucketBounds[Histogram::kBucketCount] = {
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 10, 60, 300
+};
+
+// Label values come from the files (sender); quotes, backslashes and
+// newlines are escaped as the text format requires.
+std::string Escape(const std::string& value)
+{
+    std::string escaped;
+    for (char c : value) {
+        switch (c) {
+        case '\\': escaped += "\\\\"; break;
+        case '"': escaped += "\\\""; break;
+        case '\n': escaped += "\\n"; break;
+        default: escaped += c; break;
+        }
+    }
+    return escaped;
+}
+
+} // namespace
+
+const char* LoadStageName(LoadStage stage)
+{
+    switch (stage) {
+    case LoadStage::Read: return "read";
+    case LoadStage::Validation: return "validation";
+    case LoadStage::Decode: return "decode";
+    case LoadStage::Bind: return "bind";
+    case LoadStage::Commit: return "commit";
+    default: return "unknown";
+    }
+}
+
+void Histogram::Observe(double seconds)
+{
+    for (size_t i = 0; i < kBucketCount; i++) {
+        if (seconds <= kBucketBounds[i]) {
+            m_buckets[i]++;
+            break;
+        }
+    }
+    m_count++;
+    m_sum += seconds;
+}
+
+void Histogram::Write(std::ostream& out, const std::string& name, const std::string& labels) const
+{
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        cumulative += m_buckets[i];
+        out << name << "_bucket{" << labels << ",le=\"" << kBucketBounds[i] << "\"} " << cumulative << "\n";
+    }
+    out << name << "_bucket{" << labels << ",le=\"+Inf\"} " << m_count << "\n";
+    out << name << "_sum{" << labels << "} " << m_sum << "\n";
+    out << name << "_count{" << labels << "} " << m_count << "\n";
+}
+
+void Metrics::RecordFile(const std::string& sender, const FileTimings& timings, bool loaded)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SenderMetrics& metrics = m_senders[sender.empty() ? "unknown" : sender];
+    for (size_t i = 0; i < kLoadStageCount; i++) {
+        metrics.stages[i].Observe(timings.seconds[i]);
+    }
+    for (size_t i = 0; i < kCallEventTypeCount; i++) {
+        metrics.events[i] += timings.events[i];
+    }
+    (loaded ? metrics.loadedFiles : metrics.failedFiles)++;
+    metrics.bytes += timings.bytes;
+}
+
+void Metrics::WriteText(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out << "# HELP tap3_stage_duration_seconds Time spent per file in each loading stage.\n"
+        << "# TYPE tap3_stage_duration_seconds histogram\n";
+    for (const auto& sender : m_senders) {
+        for (size_t i = 0; i < kLoadStageCount; i++) {
+            sender.second.stages[i].Write(out, "tap3_stage_duration_seconds",
+                "sender=\"" + Escape(sender.first) + "\",stage=\"" + LoadStageName(static_cast<LoadStage>(i)) + "\"");
+        }
+    }
+    out << "# HELP tap3_events_total Call events loaded.\n"
+        << "# TYPE tap3_events_total counter\n";
+    for (const auto& sender : m_senders) {
+        for (size_t i = 0; i < kCallEventTypeCount; i++) {
+            if (sender.second.events[i] > 0) {
+                out << "tap3_events_total{sender=\"" << Escape(sender.first) << "\",record_type=\""
+                    << CallEventTypeName(static_cast<CallEventType>(i)) << "\"} " << sender.second.events[i] << "\n";
+            }
+        }
+    }
+    out << "# HELP tap3_files_total Files processed.\n"
+        << "# TYPE tap3_files_total counter\n";
+    for (const auto& sender : m_senders) {
+        out << "tap3_files_total{sender=\"" << Escape(sender.first) << "\",result=\"loaded\"} "
+            << sender.second.loadedFiles << "\n"
+            << "tap3_files_total{sender=\"" << Escape(sender.first) << "\",result=\"failed\"} "
+            << sender.second.failedFiles << "\n";
+    }
+    out << "# HELP tap3_bytes_total Bytes of TAP files processed.\n"
+        << "# TYPE tap3_bytes_total counter\n";
+    for (const auto& sender : m_senders) {
+        out << "tap3_bytes_total{sender=\"" << Escape(sender.first) << "\"} " << sender.second.bytes << "\n";
+    }
+}
+
+std::string Metrics::Text() const
+{
+    std::ostringstream out;
+    WriteText(out);
+    return out.str();
+}
+
+void Metrics::WriteTextFile(const std::string& path) const
+{
+    // several workers may export at once; each uses its own temporary file
+    std::ostringstream suffix;
+    suffix << ".tmp." << std::this_thread::get_id();
+    std::string temp = path + suffix.str();
+    {
+        std::ofstream out(temp);
+        WriteText(out);
+        if (!out) {
+            throw Tap3Error("Unable to write " + temp);
+        }
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        throw Tap3Error("Unable to rename " + temp + " to " + path);
+    }
+}
+
+} // namespace tap3
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "Tap3Types.h"
+
+namespace tap3 {
+
+// Stages of loading one file. With a mapped file the page-ins happen in
+// whichever stage first touches the pages, so Read covers open and map
+// only; compressed files are inflated entirely in Read, including any wait
+// for an inflate slot, and stay resident until the file is done.
+enum class LoadStage : uint8_t
+{
+    Read,
+    Validation,
+    Decode,         // excluding time spent in the sink
+    Bind,           // sink calls while decoding: conversion and array binds
+    Commit,
+    Count
+};
+
+const size_t kLoadStageCount = static_cast<size_t>(LoadStage::Count);
+
+const char* LoadStageName(LoadStage stage);
+
+// Figures of one file, gathered by the loading thread without locking and
+// published to Metrics once the file is done.
+struct FileTimings
+{
+    double seconds[kLoadStageCount] = {};
+    uint64_t events[kCallEventTypeCount] = {};
+    uint64_t bytes = 0;
+};
+
+// Latency histogram with fixed buckets from 1 ms to 5 min.
+class Histogram
+{
+public:
+    static const size_t kBucketCount = 14;
+
+    void Observe(double seconds);
+    void Write(std::ostream& out, const std::string& name, const std::string& labels) const;
+
+private:
+    uint64_t m_buckets[kBucketCount] = {};   // per bucket, made cumulative by Write
+    uint64_t m_count = 0;
+    double m_sum = 0;
+};
+
+// Loader metrics per sender PLMN, exported in the Prometheus text format:
+//   tap3_stage_duration_seconds{sender,stage}   histogram per file
+//   tap3_events_total{sender,record_type}       counter
+//   tap3_files_total{sender,result}             counter
+//   tap3_bytes_total{sender}                    counter
+// The lock is taken once per file, never per batch or event.
+class Metrics
+{
+public:
+    void RecordFile(const std::string& sender, const FileTimings& timings, bool loaded);
+
+    void WriteText(std::ostream& out) const;
+    std::string Text() const;
+    // For the node_exporter textfile collector: written to a temporary file
+    // and renamed, so the collector never reads a partial file.
+    void WriteTextFile(const std::string& path) const;
+
+private:
+    struct SenderMetrics
+    {
+        Histogram stages[kLoadStageCount];
+        uint64_t events[kCallEventTypeCount] = {};
+        uint64_t loadedFiles = 0;
+        uint64_t failedFiles = 0;
+        uint64_t bytes = 0;
+    };
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, SenderMetrics> m_senders;
+};
+
+} // namespace tap3
@@ -0,0 +1,112 @@
+#include "MetricsServer.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+const int kPollIntervalMs = 500;
+const int kRequestTimeoutMs = 2000;
+
+void SendAll(int fd, const std::string& data)
+{
+    size_t pos = 0;
+    while (pos < data.size()) {
+        ssize_t n = send(fd, data.data() + pos, data.size() - pos, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        pos += static_cast<size_t>(n);
+    }
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(const Metrics& metrics, uint16_t port, const std::string& address)
+    : m_metrics(metrics), m_listenFd(-1), m_stopping(false)
+{
+    m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) {
+        throw Tap3Error(std::string("Unable to create metrics socket: ") + strerror(errno));
+    }
+    int reuse = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1
+        || bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || listen(m_listenFd, 8) != 0) {
+        int err = errno;
+        close(m_listenFd);
+        throw Tap3Error("Unable to listen on " + address + ":" + std::to_string(port) + ": " + strerror(err));
+    }
+    m_thread = std::thread(&MetricsServer::Serve, this);
+}
+
+MetricsServer::~MetricsServer()
+{
+    m_stopping = true;
+    m_thread.join();
+    close(m_listenFd);
+}
+
+void MetricsServer::Serve()
+{
+    while (!m_stopping) {
+        struct pollfd pfd = { m_listenFd, POLLIN, 0 };
+        if (poll(&pfd, 1, kPollIntervalMs) <= 0) {
+            continue;
+        }
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd >= 0) {
+            HandleConnection(fd);
+            close(fd);
+        }
+    }
+}
+
+void MetricsServer::HandleConnection(int fd)
+{
+    // only the request line matters; headers are read and ignored
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, kRequestTimeoutMs) <= 0) {
+            return;
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return;
+        }
+        request.append(buf, static_cast<size_t>(n));
+    }
+    std::string target;
+    if (request.compare(0, 4, "GET ") == 0) {
+        target = request.substr(4, request.find_first_of(" ?\r", 4) - 4);
+    }
+    if (target == "/metrics") {
+        std::string body = m_metrics.Text();
+        SendAll(fd, "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+            + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+    }
+    else {
+        SendAll(fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+}
+
+} // namespace tap3
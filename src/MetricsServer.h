@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "Metrics.h"
+
+namespace tap3 {
+
+// Minimal HTTP endpoint serving GET /metrics from a background thread. One
+// request is handled at a time, which is plenty for a scraper; the loader
+// threads are never blocked by it beyond the Metrics lock.
+class MetricsServer
+{
+public:
+    MetricsServer(const Metrics& metrics, uint16_t port, const std::string& address = "127.0.0.1");
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+private:
+    void Serve();
+    void HandleConnection(int fd);
+
+    const Metrics& m_metrics;
+    int m_listenFd;
+    std::atomic<bool> m_stopping;
+    std::thread m_thread;
+};
+
+} // namespace tap3
@@ -0,0 +1,139 @@
+#include "ParallelCallEventDecoder.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+namespace tap3 {
+
+struct ParallelCallEventDecoder::Chunk
+{
+    size_t first = 0;
+    size_t count = 0;
+    EventBatch batch;
+    Arena arena;            // rewound at the start of every chunk
+    AuditAccumulator audit;
+    std::vector<RecordError> errors;
+    std::exception_ptr error;
+    bool done = false;
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+ParallelCallEventDecoder::ParallelCallEventDecoder(size_t threadCount, size_t chunkSize)
+    : m_pool(threadCount), m_chunkSize(chunkSize > 0 ? chunkSize : 1)
+{
+    for (size_t i = 0; i < m_pool.Size() * 2; i++) {
+        m_chunks.emplace_back(new Chunk);
+    }
+}
+
+ParallelCallEventDecoder::~ParallelCallEventDecoder()
+{
+}
+
+void ParallelCallEventDecoder::SetFields(const FieldSelection& fields)
+{
+    for (auto& chunk : m_chunks) {
+        chunk->batch.SetFields(fields);
+    }
+}
+
+void ParallelCallEventDecoder::ReleaseArenas()
+{
+    for (auto& chunk : m_chunks) {
+        chunk->arena.Release();
+    }
+}
+
+void ParallelCallEventDecoder::DecodeChunk(ByteView file, TapDecoder::CallEventDecoder decode,
+    const CodeTables& tables, Chunk& chunk)
+{
+    try {
+        chunk.batch.Clear();
+        chunk.batch.SetSource(file);
+        chunk.arena.Reset();
+        chunk.audit.Clear();
+        chunk.errors.clear();
+        CallEvent event(chunk.arena);
+        for (size_t i = 0; i < chunk.count; i++) {
+            const RecordSpan& span = m_records[chunk.first + i];
+            BerReader reader(file.Sub(span.offset, span.length), span.offset);
+            BerTlv tlv;
+            reader.Next(tlv);
+            if (decode(reader, tlv, event, tables, chunk.batch.Selection())) {
+                TapDecoder::CollectRecordError(event, chunk.errors);
+                chunk.batch.Append(event);
+            }
+        }
+        chunk.audit.Add(chunk.batch);
+        chunk.audit.AddRecords(chunk.count);
+    }
+    catch (...) {
+        chunk.error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(chunk.mutex);
+    chunk.done = true;
+    chunk.condition.notify_one();
+}
+
+void ParallelCallEventDecoder::Decode(ByteView file, ByteView list, size_t listOffset, TapRelease release,
+    const CodeTables& tables, AuditAccumulator& audit,
+    std::vector<RecordError>& recordErrors, uint64_t& position, TapHandler& handler)
+{
+    m_records.clear();
+    ScanRecordBoundaries(list, listOffset, m_records);
+
+    TapDecoder::CallEventDecoder decode = TapDecoder::CallEventDecoderFor(release);
+    size_t chunkCount = (m_records.size() + m_chunkSize - 1) / m_chunkSize;
+    size_t window = m_chunks.size();
+    size_t submitted = 0;
+    auto submit = [&](size_t index) {
+        Chunk& chunk = *m_chunks[index % window];
+        chunk.first = index * m_chunkSize;
+        chunk.count = std::min(m_chunkSize, m_records.size() - chunk.first);
+        chunk.error = nullptr;
+        chunk.done = false;
+        m_pool.Submit([this, file, decode, &tables, &chunk] { DecodeChunk(file, decode, tables, chunk); });
+    };
+    while (submitted < chunkCount && submitted < window) {
+        submit(submitted++);
+    }
+
+    // Every submitted chunk is waited for, even after a failure, because
+    // workers reference the chunk slots and the mapped file.
+    std::exception_ptr error;
+    for (size_t index = 0; index < submitted; index++) {
+        Chunk& chunk = *m_chunks[index % window];
+        {
+            std::unique_lock<std::mutex> lock(chunk.mutex);
+            chunk.condition.wait(lock, [&chunk] { return chunk.done; });
+        }
+        if (!error && chunk.error) {
+            error = chunk.error;
+        }
+        if (error) {
+            continue;
+        }
+        audit.Merge(chunk.audit);
+        recordErrors.insert(recordErrors.end(), chunk.errors.begin(), chunk.errors.end());
+        const RecordSpan& last = m_records[chunk.first + chunk.count - 1];
+        position = last.offset + last.length;
+        try {
+            handler.OnEventBatch(chunk.batch);
+        }
+        catch (...) {
+            error = std::current_exception();
+            continue;
+        }
+        if (submitted < chunkCount) {
+            submit(submitted++);
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace tap3
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "RecordScanner.h"
+#include "TapDecoder.h"
+#include "ThreadPool.h"
+
+namespace tap3 {
+
+// Decodes a CallEventDetailList on a worker pool. Record boundaries are
+// found first by ScanRecordBoundaries, then fixed-size chunks of records are
+// decoded concurrently into per-chunk column batches. Finished batches are
+// handed to the TapHandler on the calling thread strictly in record order,
+// so handlers need no locking.
+// At most a bounded window of chunks is in flight at any time.
+class ParallelCallEventDecoder
+{
+public:
+    ParallelCallEventDecoder(size_t threadCount, size_t chunkSize = 4096);
+    ~ParallelCallEventDecoder();
+
+    // file is the whole mapped file; list is the contents of
+    // CallEventDetailList located at listOffset inside it, decoded as
+    // release. Chunk totals and record errors are collected on the workers and
+    // merged in record order into audit and recordErrors; position is
+    // moved past the last record of each chunk before its batch is handed
+    // over.
+    void Decode(ByteView file, ByteView list, size_t listOffset, TapRelease release,
+        const CodeTables& tables, AuditAccumulator& audit, std::vector<RecordError>& recordErrors, uint64_t& position,
+        TapHandler& handler);
+
+    void SetFields(const FieldSelection& fields);
+    void ReleaseArenas();
+
+private:
+    struct Chunk;
+
+    void DecodeChunk(ByteView file, TapDecoder::CallEventDecoder decode, const CodeTables& tables,
+        Chunk& chunk);
+
+    ThreadPool m_pool;
+    size_t m_chunkSize;
+    std::vector<RecordSpan> m_records;
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+};
+
+} // namespace tap3
@@ -0,0 +1,168 @@
+#include "PreValidator.h"
+
+#include "BerReader.h"
+#include "Tap3Tags.h"
+#include "TapDecoder.h"
+#include "TimeStamp.h"
+
+namespace tap3 {
+
+namespace {
+
+const size_t kPlmnCodeLength = 5;
+const size_t kFileSequenceNumberLength = 5;
+const int32_t kMaxTapDecimalPlaces = 6;
+// Header groups nest a few levels; a file nested deeper than this is
+// hostile, and must not run the recursion below out of stack.
+const size_t kMaxNestingDepth = 64;
+
+// Walks every TLV below reader; BerReader throws on lengths that overrun
+// their container.
+void ScanStructure(BerReader& reader, size_t depth = 0)
+{
+    BerTlv tlv;
+    while (reader.Next(tlv)) {
+        if (tlv.Constructed()) {
+            if (depth == kMaxNestingDepth) {
+                throw BerError("BER nesting deeper than " + std::to_string(kMaxNestingDepth) + " levels",
+                    reader.BaseOffset() + tlv.offset);
+            }
+            BerReader inner = reader.Enter(tlv);
+            ScanStructure(inner, depth + 1);
+        }
+    }
+}
+
+void ScanRecords(const BerReader& parent, const BerTlv& list)
+{
+    BerReader records = parent.Enter(list);
+    BerTlv record;
+    while (records.Next(record)) {
+    }
+}
+
+void CheckPlmnCode(const char* item, ByteView value)
+{
+    if (value.size == 0) {
+        throw FatalFileError(item, "missing");
+    }
+    if (value.size != kPlmnCodeLength) {
+        throw FatalFileError(item, "invalid PLMN code '" + value.ToString() + "'");
+    }
+}
+
+void CheckFileSequenceNumber(ByteView value)
+{
+    if (value.size == 0) {
+        throw FatalFileError("FileSequenceNumber", "missing");
+    }
+    bool digits = value.size == kFileSequenceNumberLength;
+    for (size_t i = 0; digits && i < value.size; i++) {
+        digits = value[i] >= '0' && value[i] <= '9';
+    }
+    if (!digits) {
+        throw FatalFileError("FileSequenceNumber", "invalid value '" + value.ToString() + "'");
+    }
+}
+
+void CheckFileAvailableTimeStamp(const DateTimeLong& value)
+{
+    if (value.localTimeStamp.size == 0) {
+        throw FatalFileError("FileAvailableTimeStamp", "missing");
+    }
+    int64_t seconds;
+    int32_t offset;
+    if (!ParseLocalTimeStamp(value.localTimeStamp, seconds) || !ParseUtcTimeOffset(value.utcTimeOffset, offset)) {
+        throw FatalFileError("FileAvailableTimeStamp", "invalid value '" + value.localTimeStamp.ToString()
+            + value.utcTimeOffset.ToString() + "'");
+    }
+}
+
+void CheckTapRelease(int32_t specificationVersionNumber, int32_t releaseVersionNumber)
+{
+    if (specificationVersionNumber == 0) {
+        throw FatalFileError("SpecificationVersionNumber", "missing");
+    }
+    if (releaseVersionNumber == 0) {
+        throw FatalFileError("ReleaseVersionNumber", "missing");
+    }
+    if (!IsSupportedTapRelease(specificationVersionNumber, releaseVersionNumber)) {
+        throw FatalFileError("ReleaseVersionNumber", "unsupported release "
+            + std::to_string(specificationVersionNumber) + "." + std::to_string(releaseVersionNumber));
+    }
+}
+
+void ValidateTransferBatch(const BerReader& parent, const BerTlv& tlv)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv block;
+    bool batchControlInfo = false;
+    while (reader.Next(block)) {
+        if (block.IsApplication(tag::CallEventDetailList)) {
+            ScanRecords(reader, block);
+            continue;
+        }
+        if (block.Constructed()) {
+            BerReader inner = reader.Enter(block);
+            ScanStructure(inner);
+        }
+        if (block.IsApplication(tag::BatchControlInfo)) {
+            BatchControlInfo info;
+            TapDecoder::DecodeBatchControlInfo(reader, block, info);
+            CheckPlmnCode("Sender", info.sender);
+            CheckPlmnCode("Recipient", info.recipient);
+            CheckFileSequenceNumber(info.fileSequenceNumber);
+            CheckFileAvailableTimeStamp(info.fileAvailableTimeStamp);
+            CheckTapRelease(info.specificationVersionNumber, info.releaseVersionNumber);
+            batchControlInfo = true;
+        }
+        else if (block.IsApplication(tag::AccountingInfo)) {
+            AccountingInfo info;
+            TapDecoder::DecodeAccountingInfo(reader, block, info);
+            if (info.tapDecimalPlaces < 0) {
+                throw FatalFileError("TapDecimalPlaces", "missing");
+            }
+            if (info.tapDecimalPlaces > kMaxTapDecimalPlaces) {
+                throw FatalFileError("TapDecimalPlaces", "out of range: " + std::to_string(info.tapDecimalPlaces));
+            }
+        }
+    }
+    if (!batchControlInfo) {
+        throw FatalFileError("BatchControlInfo", "missing");
+    }
+}
+
+void ValidateNotification(const BerReader& parent, const BerTlv& tlv)
+{
+    BerReader inner = parent.Enter(tlv);
+    ScanStructure(inner);
+    Notification info;
+    TapDecoder::DecodeNotification(parent, tlv, info);
+    CheckPlmnCode("Sender", info.sender);
+    CheckPlmnCode("Recipient", info.recipient);
+    CheckFileSequenceNumber(info.fileSequenceNumber);
+    CheckFileAvailableTimeStamp(info.fileAvailableTimeStamp);
+}
+
+} // namespace
+
+void PreValidate(ByteView file)
+{
+    BerReader reader(file);
+    BerTlv tlv;
+    if (!reader.Next(tlv)) {
+        throw Tap3Error("Empty TAP file");
+    }
+    if (tlv.IsApplication(tag::TransferBatch) && tlv.Constructed()) {
+        ValidateTransferBatch(reader, tlv);
+    }
+    else if (tlv.IsApplication(tag::Notification) && tlv.Constructed()) {
+        ValidateNotification(reader, tlv);
+    }
+    else {
+        throw Tap3Error("File is neither TransferBatch nor Notification (tag "
+            + std::to_string(tlv.Tag()) + ")");
+    }
+}
+
+} // namespace tap3
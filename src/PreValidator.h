@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include "ByteView.h"
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+// A TD.57 fatal error: the whole file has to be rejected, no call event of
+// it may be charged.
+class FatalFileError : public Tap3Error
+{
+public:
+    FatalFileError(const std::string& item, const std::string& message)
+        : Tap3Error(item + ": " + message), m_item(item) {}
+
+    // Name of the offending TD.57 element.
+    const std::string& Item() const { return m_item; }
+
+private:
+    std::string m_item;
+};
+
+// Cheap check of everything that makes a file fatal, run before a full
+// decode and before a database transaction is opened: sender, recipient,
+// FileSequenceNumber and FileAvailableTimeStamp of BatchControlInfo (or
+// Notification), TapDecimalPlaces of AccountingInfo and the BER structure.
+// Header blocks are scanned to their leaves; call events only at record
+// level, so the cost is a few bytes per record. Throws FatalFileError or
+// BerError.
+void PreValidate(ByteView file);
+
+} // namespace tap3
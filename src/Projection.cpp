@@ -0,0 +1,218 @@
+#include "Projection.h"
+
+#include <fstream>
+#include <sstream>
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+struct FieldName
+{
+    const char* name;
+    EventField field;
+};
+
+// TAP3 element names, plus the loader's derived values.
+const FieldName kFieldNames[] = {
+    { "CallEventStartTimeStamp", EventField::LocalTimeStamp },
+    { "ServiceStartTimestamp", EventField::LocalTimeStamp },
+    { "LocalTimeStamp", EventField::LocalTimeStamp },
+    { "UtcTimeOffsetCode", EventField::UtcTimeOffsetCode },
+    { "StartTimeUtc", EventField::StartTimeUtc },
+    { "RecEntityCode", EventField::RecEntityCode },
+    { "ExchangeRateCode", EventField::ExchangeRateCode },
+    { "TotalCallEventDuration", EventField::Duration },
+    { "Charge", EventField::Charge },
+    { "ChargeLocal", EventField::ChargeLocal },
+    { "ChargeableUnits", EventField::ChargeableUnits },
+    { "TaxValue", EventField::TaxValue },
+    { "Discount", EventField::DiscountValue },
+    { "DataVolumeIncoming", EventField::DataVolumeIncoming },
+    { "DataVolumeOutgoing", EventField::DataVolumeOutgoing },
+    { "Imsi", EventField::Imsi },
+    { "Msisdn", EventField::Msisdn },
+    { "Imei", EventField::Imei },
+    { "CalledNumber", EventField::OtherParty },
+    { "CallingNumber", EventField::OtherParty },
+    { "ChargeDetail", EventField::ChargeDetail },
+    { "TaxInformation", EventField::TaxInformation },
+};
+
+// Column names of the default call_event table, in EventField order.
+const char* kDefaultColumns[] = {
+    "local_time_stamp", "utc_time_offset_code", "start_time_utc", "rec_entity_code", "exchange_rate_code",
+    "duration", "charge", "charge_local", "chargeable_units", "tax_value", "discount_value",
+    "data_volume_incoming", "data_volume_outgoing", "imsi", "msisdn", "imei", "other_party"
+};
+
+const char* kTypeNames[] = {
+    "MobileOriginatedCall", "MobileTerminatedCall", "SupplServiceEvent", "ServiceCentreUsage", "GprsCall",
+    "ContentTransaction", "LocationService", "MessagingEvent", "MobileSession"
+};
+
+bool IsRowSet(EventField field)
+{
+    return field == EventField::ChargeDetail || field == EventField::TaxInformation;
+}
+
+bool IsText(EventField field)
+{
+    return field >= EventField::Imsi && field <= EventField::OtherParty;
+}
+
+bool ParseType(const std::string& name, CallEventType& type)
+{
+    for (size_t i = 0; i < kCallEventTypeCount; i++) {
+        if (name == kTypeNames[i] || name == CallEventTypeName(static_cast<CallEventType>(i))) {
+            type = static_cast<CallEventType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseField(const std::string& name, EventField& field)
+{
+    for (const FieldName& entry : kFieldNames) {
+        if (name == entry.name) {
+            field = entry.field;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ValidIdentifier(const std::string& name)
+{
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+        return false;
+    }
+    for (char c : name) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+Projection::Projection()
+    : m_table("call_event"), m_fields(AllFields()), m_columnFields(0)
+{
+    for (size_t i = 0; i < kEventFieldCount; i++) {
+        EventField field = static_cast<EventField>(i);
+        if (!IsRowSet(field)) {
+            m_columns.push_back(ProjectedColumn{ field, kDefaultColumns[i], IsText(field) });
+            m_columnFields |= FieldBit(field);
+        }
+    }
+    for (bool& loaded : m_loaded) {
+        loaded = true;
+    }
+}
+
+Projection Projection::Load(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        throw Tap3Error("Unable to open projection " + path);
+    }
+    return Parse(in, path);
+}
+
+Projection Projection::Parse(std::istream& in, const std::string& source)
+{
+    Projection projection;
+    projection.m_columns.clear();
+    projection.m_fields.fill(0);
+    projection.m_columnFields = 0;
+    for (bool& loaded : projection.m_loaded) {
+        loaded = false;
+    }
+
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(in, line); lineNumber++) {
+        auto fail = [&source, lineNumber](const std::string& message) {
+            throw Tap3Error(source + ":" + std::to_string(lineNumber) + ": " + message);
+        };
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) {
+            line.erase(hash);
+        }
+        std::istringstream words(line);
+        std::string first;
+        if (!(words >> first)) {
+            continue;
+        }
+        if (first == "table") {
+            std::string table;
+            if (!(words >> table) || !ValidIdentifier(table)) {
+                fail("table needs a name");
+            }
+            projection.m_table = table;
+            continue;
+        }
+        CallEventType type;
+        if (!ParseType(first, type)) {
+            fail("unknown record type " + first);
+        }
+        size_t typeIndex = static_cast<size_t>(type);
+        if (projection.m_loaded[typeIndex]) {
+            fail("record type " + first + " listed twice");
+        }
+        projection.m_loaded[typeIndex] = true;
+        std::string word;
+        while (words >> word) {
+            size_t equals = word.find('=');
+            std::string name = word.substr(0, equals);
+            EventField field;
+            if (!ParseField(name, field)) {
+                fail("unknown field " + name);
+            }
+            projection.m_fields[typeIndex] |= FieldBit(field);
+            if (IsRowSet(field)) {
+                if (equals != std::string::npos) {
+                    fail(name + " is loaded into its own table and cannot be renamed");
+                }
+                continue;
+            }
+            std::string column = equals == std::string::npos ? kDefaultColumns[static_cast<size_t>(field)]
+                : word.substr(equals + 1);
+            if (!ValidIdentifier(column) || column == "file_id" || column == "record_type"
+                || column == "record_offset") {
+                fail("invalid column name " + column);
+            }
+            bool found = false;
+            for (const ProjectedColumn& existing : projection.m_columns) {
+                if (existing.name == column) {
+                    if (existing.field != field) {
+                        fail("column " + column + " already holds another field");
+                    }
+                    found = true;
+                }
+                else if (existing.field == field) {
+                    fail(name + " already goes to column " + existing.name);
+                }
+            }
+            if (!found) {
+                projection.m_columns.push_back(ProjectedColumn{ field, column, IsText(field) });
+                projection.m_columnFields |= FieldBit(field);
+            }
+        }
+    }
+    return projection;
+}
+
+FieldSelection Projection::Selection(FieldSet extra) const
+{
+    FieldSelection selection;
+    for (size_t i = 0; i < kCallEventTypeCount; i++) {
+        selection[i] = m_loaded[i] ? (m_fields[i] | extra) : 0;
+    }
+    return selection;
+}
+
+} // namespace tap3
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+#include "EventColumns.h"
+
+namespace tap3 {
+
+struct ProjectedColumn
+{
+    EventField field;
+    std::string name;
+    bool text;                  // number columns (IMSI, MSISDN, ...) are loaded as text
+};
+
+// Which call event fields are loaded, per record type, and the columns of
+// the event table they go to. The default projection is the full call_event
+// layout. A projection file narrows it down:
+//
+//   # comment
+//   table roaming_usage
+//   GPRS ChargeableUnits Charge CallEventStartTimeStamp=start_time Imsi
+//   MOC Imsi CalledNumber=b_number Charge TotalCallEventDuration ChargeDetail
+//
+// Each record type line names the type (MOC or MobileOriginatedCall, GPRS
+// or GprsCall, ...) followed by TAP3 fields, each optionally renamed with
+// =column. Record types without a line are not loaded. The same column may
+// be used by several record types for the same field; rows of types that do
+// not project a column get NULL there. ChargeDetail and TaxInformation load
+// the charge_detail and tax_information rows of the type.
+class Projection
+{
+public:
+    Projection();
+
+    static Projection Load(const std::string& path);
+    // source names the input in error messages.
+    static Projection Parse(std::istream& in, const std::string& source);
+
+    const std::string& Table() const { return m_table; }
+    // Event table columns after file_id, record_type and record_offset.
+    const std::vector<ProjectedColumn>& Columns() const { return m_columns; }
+    FieldSet Fields(CallEventType type) const { return m_fields[static_cast<size_t>(type)]; }
+    // Fields of any type that are loaded into a column.
+    FieldSet ColumnFields() const { return m_columnFields; }
+    bool Loads(CallEventType type) const { return m_loaded[static_cast<size_t>(type)]; }
+
+    // Decoder selection: the projected fields plus extra for every loaded
+    // type (e.g. the ones the duplicate index reads); nothing for types that
+    // are not loaded.
+    FieldSelection Selection(FieldSet extra = 0) const;
+
+private:
+    std::string m_table;
+    std::vector<ProjectedColumn> m_columns;
+    FieldSelection m_fields;
+    FieldSet m_columnFields;
+    bool m_loaded[kCallEventTypeCount];
+};
+
+} // namespace tap3
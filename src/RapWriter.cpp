@@ -0,0 +1,302 @@
+#include "RapWriter.h"
+
+#include <ctime>
+
+#include "BerReader.h"
+#include "BerWriter.h"
+#include "Tap3Tags.h"
+#include "TimeStamp.h"
+
+namespace tap3 {
+
+namespace {
+
+const int32_t kRapSpecificationVersion = 1;
+const int32_t kRapReleaseVersion = 5;
+const size_t kMaxPathDepth = 16;
+
+// TD.57 error code for a code reference that is not defined in its header
+// group, per referencing item, for a missing or malformed event start
+// LocalTimeStamp, and for a charge too large to convert to local currency.
+struct CodeReference
+{
+    uint32_t codeError;
+    uint32_t itemTag;
+    int32_t errorCode;
+};
+
+const CodeReference kCodeReferences[] = {
+    { kUnknownUtcTimeOffsetCode, tag::UtcTimeOffsetCode, 101 },
+    { kUnknownRecEntityCode, tag::RecEntityCode, 101 },
+    { kUnknownExchangeRateCode, tag::ExchangeRateCode, 101 },
+    { kUnknownTaxCode, tag::TaxCode, 101 },
+    { kUnknownDiscountCode, tag::DiscountCode, 101 },
+    { kMissingLocalTimeStamp, tag::LocalTimeStamp, 30 },
+    { kBadLocalTimeStamp, tag::LocalTimeStamp, 10 },
+    { kLocalChargeOverflow, tag::Charge, 20 },
+};
+
+struct PathStep
+{
+    uint32_t tag;
+    uint32_t occurrence;
+};
+
+// One ErrorDetail: error code plus the path from the CallEventDetail
+// (level 1) down to the erroneous item.
+struct ErrorItem
+{
+    int32_t errorCode;
+    size_t depth;
+    PathStep path[kMaxPathDepth];
+};
+
+bool IsValid(const CodeTables& tables, uint32_t itemTag, ByteView value)
+{
+    int64_t seconds;
+    if (itemTag == tag::LocalTimeStamp) {
+        return ParseLocalTimeStamp(value, seconds);
+    }
+    int32_t code = static_cast<int32_t>(BerDecodeInteger(value));
+    switch (itemTag) {
+    case tag::UtcTimeOffsetCode: return tables.UtcOffset(code) != nullptr;
+    case tag::RecEntityCode: return tables.RecEntity(code) != nullptr;
+    case tag::ExchangeRateCode: return tables.Exchange(code) != nullptr;
+    case tag::TaxCode: return tables.Tax(code) != nullptr;
+    case tag::DiscountCode: return tables.Discount(code) != nullptr;
+    default: return true;
+    }
+}
+
+void FindUndefinedCodes(const BerReader& parent, const BerTlv& tlv, uint32_t codeErrors,
+    const CodeTables& tables, ErrorItem& current, std::vector<ErrorItem>& items)
+{
+    if (current.depth == kMaxPathDepth) {
+        return;
+    }
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    // occurrences are counted per tag among the siblings
+    std::vector<PathStep> seen;
+    while (reader.Next(child)) {
+        uint32_t occurrence = 1;
+        bool counted = false;
+        for (PathStep& step : seen) {
+            if (step.tag == child.Tag()) {
+                occurrence = ++step.occurrence;
+                counted = true;
+                break;
+            }
+        }
+        if (!counted) {
+            seen.push_back(PathStep{ child.Tag(), 1 });
+        }
+        current.path[current.depth++] = PathStep{ child.Tag(), occurrence };
+        if (child.Constructed()) {
+            FindUndefinedCodes(reader, child, codeErrors, tables, current, items);
+        }
+        else if (child.header.tagClass == BerClass::Application) {
+            for (const CodeReference& ref : kCodeReferences) {
+                if ((codeErrors & ref.codeError) && child.Tag() == ref.itemTag
+                    && !IsValid(tables, ref.itemTag, child.value)) {
+                    current.errorCode = ref.errorCode;
+                    items.push_back(current);
+                }
+            }
+        }
+        current.depth--;
+    }
+}
+
+// Error details of one record. Errors whose item cannot be located (e.g. a
+// missing LocalTimeStamp) are reported at record level.
+void CollectErrorItems(ByteView tapFile, const RecordError& error, const CodeTables& tables,
+    std::vector<ErrorItem>& items)
+{
+    items.clear();
+    BerReader reader(tapFile.Sub(error.recordOffset, error.recordLength), error.recordOffset);
+    BerTlv record;
+    reader.Next(record);
+    ErrorItem current;
+    current.errorCode = 0;
+    current.depth = 0;
+    current.path[current.depth++] = PathStep{ record.Tag(), 1 };
+    FindUndefinedCodes(reader, record, error.codeErrors, tables, current, items);
+    for (const CodeReference& ref : kCodeReferences) {
+        if (!(error.codeErrors & ref.codeError)) {
+            continue;
+        }
+        bool located = false;
+        for (const ErrorItem& item : items) {
+            located = located || item.path[item.depth - 1].tag == ref.itemTag;
+        }
+        if (!located) {
+            ErrorItem item;
+            item.errorCode = ref.errorCode;
+            item.depth = 1;
+            item.path[0] = PathStep{ record.Tag(), 1 };
+            items.push_back(item);
+        }
+    }
+}
+
+size_t ErrorContextLength(const PathStep& step, size_t level)
+{
+    return BerWriter::IntegerSize(tag::PathItemId, step.tag)
+        + BerWriter::IntegerSize(tag::ItemOccurrence, step.occurrence)
+        + BerWriter::IntegerSize(tag::ItemLevel, static_cast<int64_t>(level));
+}
+
+size_t ErrorContextListLength(const ErrorItem& item)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < item.depth; i++) {
+        length += BerWriter::TlvSize(tag::ErrorContext, ErrorContextLength(item.path[i], i + 1));
+    }
+    return length;
+}
+
+size_t ErrorDetailLength(const ErrorItem& item)
+{
+    return BerWriter::TlvSize(tag::ErrorContextList, ErrorContextListLength(item))
+        + BerWriter::IntegerSize(tag::ErrorCode, item.errorCode);
+}
+
+size_t ErrorDetailListLength(const std::vector<ErrorItem>& items)
+{
+    size_t length = 0;
+    for (const ErrorItem& item : items) {
+        length += BerWriter::TlvSize(tag::ErrorDetail, ErrorDetailLength(item));
+    }
+    return length;
+}
+
+size_t SevereReturnLength(const RapBatchInfo& info, const RecordError& error,
+    const std::vector<ErrorItem>& items)
+{
+    return BerWriter::TlvSize(tag::FileSequenceNumber, info.fileSequenceNumber.size())
+        + error.recordLength
+        + BerWriter::TlvSize(tag::ErrorDetailList, ErrorDetailListLength(items));
+}
+
+void WriteSevereReturn(BerWriter& writer, ByteView tapFile, const RapBatchInfo& info,
+    const RecordError& error, const std::vector<ErrorItem>& items)
+{
+    writer.Constructed(tag::SevereReturn, SevereReturnLength(info, error, items));
+    writer.Primitive(tag::FileSequenceNumber, info.fileSequenceNumber);
+    writer.Raw(tapFile.Sub(error.recordOffset, error.recordLength));
+    writer.Constructed(tag::ErrorDetailList, ErrorDetailListLength(items));
+    for (const ErrorItem& item : items) {
+        writer.Constructed(tag::ErrorDetail, ErrorDetailLength(item));
+        writer.Constructed(tag::ErrorContextList, ErrorContextListLength(item));
+        for (size_t i = 0; i < item.depth; i++) {
+            const PathStep& step = item.path[i];
+            writer.Constructed(tag::ErrorContext, ErrorContextLength(step, i + 1));
+            writer.Integer(tag::PathItemId, step.tag);
+            writer.Integer(tag::ItemOccurrence, step.occurrence);
+            writer.Integer(tag::ItemLevel, static_cast<int64_t>(i + 1));
+        }
+        writer.Integer(tag::ErrorCode, item.errorCode);
+    }
+}
+
+// Current time as DateTimeLong contents in UTC.
+std::string NowLocalTimeStamp()
+{
+    time_t now = time(nullptr);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    char buf[16];
+    strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", &tm);
+    return buf;
+}
+
+const char kUtcOffset[] = "+0000";
+
+size_t DateTimeLongLength(const std::string& localTimeStamp)
+{
+    return BerWriter::TlvSize(tag::LocalTimeStamp, localTimeStamp.size())
+        + BerWriter::TlvSize(tag::UtcTimeOffset, sizeof(kUtcOffset) - 1);
+}
+
+void WriteDateTimeLong(BerWriter& writer, uint32_t dateTimeTag, const std::string& localTimeStamp)
+{
+    writer.Constructed(dateTimeTag, DateTimeLongLength(localTimeStamp));
+    writer.Primitive(tag::LocalTimeStamp, localTimeStamp);
+    writer.Primitive(tag::UtcTimeOffset, kUtcOffset);
+}
+
+size_t RapBatchControlInfoLength(const RapBatchInfo& info, const std::string& now)
+{
+    return BerWriter::TlvSize(tag::Sender, info.sender.size())
+        + BerWriter::TlvSize(tag::Recipient, info.recipient.size())
+        + BerWriter::TlvSize(tag::RapFileSequenceNumber, info.rapFileSequenceNumber.size())
+        + BerWriter::TlvSize(tag::RapFileCreationTimeStamp, DateTimeLongLength(now))
+        + BerWriter::TlvSize(tag::RapFileAvailableTimeStamp, DateTimeLongLength(now))
+        + BerWriter::IntegerSize(tag::TapDecimalPlaces, info.tapDecimalPlaces)
+        + BerWriter::IntegerSize(tag::SpecificationVersionNumber, info.specificationVersionNumber)
+        + BerWriter::IntegerSize(tag::ReleaseVersionNumber, info.releaseVersionNumber)
+        + BerWriter::IntegerSize(tag::RapSpecificationVersionNumber, kRapSpecificationVersion)
+        + BerWriter::IntegerSize(tag::RapReleaseVersionNumber, kRapReleaseVersion);
+}
+
+void WriteRapBatchControlInfo(BerWriter& writer, const RapBatchInfo& info, const std::string& now)
+{
+    writer.Constructed(tag::RapBatchControlInfo, RapBatchControlInfoLength(info, now));
+    writer.Primitive(tag::Sender, info.sender);
+    writer.Primitive(tag::Recipient, info.recipient);
+    writer.Primitive(tag::RapFileSequenceNumber, info.rapFileSequenceNumber);
+    WriteDateTimeLong(writer, tag::RapFileCreationTimeStamp, now);
+    WriteDateTimeLong(writer, tag::RapFileAvailableTimeStamp, now);
+    writer.Integer(tag::TapDecimalPlaces, info.tapDecimalPlaces);
+    writer.Integer(tag::SpecificationVersionNumber, info.specificationVersionNumber);
+    writer.Integer(tag::ReleaseVersionNumber, info.releaseVersionNumber);
+    writer.Integer(tag::RapSpecificationVersionNumber, kRapSpecificationVersion);
+    writer.Integer(tag::RapReleaseVersionNumber, kRapReleaseVersion);
+}
+
+} // namespace
+
+std::string RapFileName(const RapBatchInfo& info)
+{
+    return "RC" + info.sender + info.recipient + info.rapFileSequenceNumber;
+}
+
+void WriteRapFile(const std::string& path, ByteView tapFile, const RapBatchInfo& info,
+    const std::vector<RecordError>& errors, const CodeTables& tables)
+{
+    // The lengths of ReturnBatch and ReturnDetailList precede all returns,
+    // so the returns are sized first; records are small and already in the
+    // page cache, so walking them twice is cheaper than buffering output.
+    std::vector<ErrorItem> items;
+    size_t detailListLength = 0;
+    int64_t totalSevereReturnValue = 0;
+    for (const RecordError& error : errors) {
+        CollectErrorItems(tapFile, error, tables, items);
+        detailListLength += BerWriter::TlvSize(tag::SevereReturn, SevereReturnLength(info, error, items));
+        totalSevereReturnValue += error.charge;
+    }
+    std::string now = NowLocalTimeStamp();
+    int64_t returnCount = static_cast<int64_t>(errors.size());
+    size_t auditLength = BerWriter::IntegerSize(tag::TotalSevereReturnValue, totalSevereReturnValue)
+        + BerWriter::IntegerSize(tag::ReturnDetailsCount, returnCount);
+    size_t batchLength = BerWriter::TlvSize(tag::RapBatchControlInfo, RapBatchControlInfoLength(info, now))
+        + BerWriter::TlvSize(tag::ReturnDetailList, detailListLength)
+        + BerWriter::TlvSize(tag::RapAuditControlInfo, auditLength);
+
+    OutputFile output(path);
+    BerWriter writer(output);
+    writer.Constructed(tag::ReturnBatch, batchLength);
+    WriteRapBatchControlInfo(writer, info, now);
+    writer.Constructed(tag::ReturnDetailList, detailListLength);
+    for (const RecordError& error : errors) {
+        CollectErrorItems(tapFile, error, tables, items);
+        WriteSevereReturn(writer, tapFile, info, error, items);
+    }
+    writer.Constructed(tag::RapAuditControlInfo, auditLength);
+    writer.Integer(tag::TotalSevereReturnValue, totalSevereReturnValue);
+    writer.Integer(tag::ReturnDetailsCount, returnCount);
+    output.Commit();
+}
+
+} // namespace tap3
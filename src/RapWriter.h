@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ByteView.h"
+#include "CodeTables.h"
+#include "Tap3Types.h"
+
+namespace tap3 {
+
+// RapBatchControlInfo contents. Sender and recipient are those of the RAP
+// file, i.e. swapped relative to the returned TAP file.
+struct RapBatchInfo
+{
+    std::string sender;
+    std::string recipient;
+    std::string rapFileSequenceNumber;
+    std::string fileSequenceNumber;   // of the returned TAP file
+    int32_t tapDecimalPlaces = 0;
+    int32_t specificationVersionNumber = 3;
+    int32_t releaseVersionNumber = 12;
+};
+
+// Writes a TD.32 ReturnBatch with one SevereReturn per entry of errors, in
+// a single pass: every SevereReturn carries the original CallEventDetail
+// copied from tapFile, so only the small error descriptors collected during
+// decode are kept in memory. The ErrorContext path of each error is found
+// by re-walking the record and checking its code references against tables
+// (the tables the file was decoded with).
+void WriteRapFile(const std::string& path, ByteView tapFile, const RapBatchInfo& info,
+    const std::vector<RecordError>& errors, const CodeTables& tables);
+
+// TD.32 file name: "RC" + sender + recipient + RAP file sequence number.
+std::string RapFileName(const RapBatchInfo& info);
+
+} // namespace tap3
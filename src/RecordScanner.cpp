@@ -0,0 +1,35 @@
+#include "RecordScanner.h"
+
+#include "BerReader.h"
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+void ScanRecordBoundaries(ByteView list, size_t baseOffset, std::vector<RecordSpan>& records)
+{
+    size_t pos = 0;
+    while (pos < list.size) {
+        size_t available = list.size - pos;
+        if (available >= 2 && list[pos] == 0 && list[pos + 1] == 0) {
+            break;
+        }
+        BerHeader header;
+        if (ParseBerHeader(list.data + pos, available, header, baseOffset + pos) == BerParseStatus::NeedMore) {
+            throw BerError("Truncated call event header", baseOffset + pos);
+        }
+        size_t size;
+        if (header.indefinite) {
+            size = header.headerLength + FindEndOfContents(list, pos + header.headerLength);
+        }
+        else {
+            if (header.length > available - header.headerLength) {
+                throw BerError("Call event exceeds CallEventDetailList", baseOffset + pos);
+            }
+            size = header.headerLength + header.length;
+        }
+        records.push_back(RecordSpan{ baseOffset + pos, size });
+        pos += size;
+    }
+}
+
+} // namespace tap3
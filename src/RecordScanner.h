@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ByteView.h"
+
+namespace tap3 {
+
+// Location of one CallEventDetail inside the file.
+struct RecordSpan
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Tag/length-only pass over the contents of CallEventDetailList. Only
+// identifier and length octets are read, so the scan touches a few bytes per
+// record. baseOffset is the file offset of list.data.
+void ScanRecordBoundaries(ByteView list, size_t baseOffset, std::vector<RecordSpan>& records);
+
+} // namespace tap3
@@ -0,0 +1,61 @@
+#include "SessionPool.h"
+
+namespace tap3 {
+
+PooledSession::PooledSession(SessionPool& pool, std::unique_ptr<EventSink> sink)
+    : m_pool(pool), m_sink(std::move(sink)), m_valid(true)
+{
+}
+
+PooledSession::~PooledSession()
+{
+    m_pool.Return(std::move(m_sink), m_valid);
+}
+
+SessionPool::SessionPool(Factory factory, size_t maxSessions)
+    : m_factory(factory), m_maxSessions(maxSessions > 0 ? maxSessions : 1), m_openSessions(0)
+{
+}
+
+std::unique_ptr<PooledSession> SessionPool::Checkout()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_available.wait(lock, [this] { return !m_idle.empty() || m_openSessions < m_maxSessions; });
+    if (!m_idle.empty()) {
+        std::unique_ptr<EventSink> sink = std::move(m_idle.back());
+        m_idle.pop_back();
+        return std::unique_ptr<PooledSession>(new PooledSession(*this, std::move(sink)));
+    }
+    // reserve the slot, then connect without holding the lock
+    m_openSessions++;
+    lock.unlock();
+    std::unique_ptr<EventSink> sink;
+    try {
+        sink = m_factory();
+    }
+    catch (...) {
+        lock.lock();
+        m_openSessions--;
+        m_available.notify_one();
+        throw;
+    }
+    return std::unique_ptr<PooledSession>(new PooledSession(*this, std::move(sink)));
+}
+
+void SessionPool::Return(std::unique_ptr<EventSink> sink, bool valid)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (valid) {
+            m_idle.push_back(std::move(sink));
+        }
+        else {
+            m_openSessions--;
+        }
+    }
+    // an invalid session is closed here, outside the lock
+    sink.reset();
+    m_available.notify_one();
+}
+
+} // namespace tap3
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "EventSink.h"
+
+namespace tap3 {
+
+class SessionPool;
+
+// Sink checked out of a SessionPool for the duration of one file. Returns
+// the session to the pool on destruction unless it was invalidated.
+class PooledSession
+{
+public:
+    PooledSession(SessionPool& pool, std::unique_ptr<EventSink> sink);
+    ~PooledSession();
+
+    PooledSession(const PooledSession&) = delete;
+    PooledSession& operator=(const PooledSession&) = delete;
+
+    EventSink& operator*() const { return *m_sink; }
+    EventSink* operator->() const { return m_sink.get(); }
+
+    // Marks the session broken (e.g. after a failed rollback) so the pool
+    // closes it instead of handing it out again.
+    void Invalidate() { m_valid = false; }
+
+private:
+    SessionPool& m_pool;
+    std::unique_ptr<EventSink> m_sink;
+    bool m_valid;
+};
+
+// Pool of warm database sessions shared by the loader workers. Sessions
+// are created on demand up to maxSessions and kept open between files,
+// together with their prepared statements, so logon and statement
+// preparation are paid once per session instead of once per file.
+class SessionPool
+{
+public:
+    typedef std::function<std::unique_ptr<EventSink>()> Factory;
+
+    SessionPool(Factory factory, size_t maxSessions);
+
+    // Blocks while all sessions are checked out.
+    std::unique_ptr<PooledSession> Checkout();
+
+    size_t MaxSessions() const { return m_maxSessions; }
+
+private:
+    friend class PooledSession;
+    void Return(std::unique_ptr<EventSink> sink, bool valid);
+
+    Factory m_factory;
+    size_t m_maxSessions;
+    size_t m_openSessions;
+    std::vector<std::unique_ptr<EventSink>> m_idle;
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+};
+
+} // namespace tap3
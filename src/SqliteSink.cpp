@@ -0,0 +1,552 @@
+#include "SqliteSink.h"
+
+#include <algorithm>
+#include <sqlite3.h>
+#include "Tap3Error.h"
+
+namespace tap3 {
+
+namespace {
+
+// Columns after file_id; the *_stage tables repeat them with file_id
+// holding the load_checkpoint stage_id. The event table's columns come
+// from the projection.
+std::string EventColumnList(const Projection& projection)
+{
+    std::string columns = "record_type, record_offset";
+    for (const ProjectedColumn& column : projection.Columns()) {
+        columns += ", " + column.name;
+    }
+    return columns;
+}
+
+std::string EventColumnTypes(const Projection& projection)
+{
+    std::string types = " file_id INTEGER, record_type INTEGER, record_offset INTEGER";
+    for (const ProjectedColumn& column : projection.Columns()) {
+        types += ", " + column.name + (column.text ? " TEXT" : " INTEGER");
+    }
+    return types;
+}
+
+int EventColumnCount(const Projection& projection)
+{
+    return 3 + static_cast<int>(projection.Columns().size());
+}
+
+const char* kChargeColumns =
+    "record_offset, charged_item, charge_type, exchange_rate_code, charge, charge_local, chargeable_units,"
+    " charged_units";
+const char* kChargeColumnTypes =
+    " file_id INTEGER, record_offset INTEGER, charged_item TEXT, charge_type INTEGER,"
+    " exchange_rate_code INTEGER, charge INTEGER, charge_local INTEGER, chargeable_units INTEGER,"
+    " charged_units INTEGER";
+const int kChargeColumnCount = 9;
+
+const char* kTaxColumns = "record_offset, tax_code, tax_value, taxable_amount";
+const char* kTaxColumnTypes =
+    " file_id INTEGER, record_offset INTEGER, tax_code INTEGER, tax_value INTEGER, taxable_amount INTEGER";
+const int kTaxColumnCount = 5;
+
+const char* kStagedTables[] = { "charge_detail_stage", "tax_information_stage", "record_error_stage" };
+
+std::string Schema(const Projection& projection)
+{
+    std::string schema =
+        "CREATE TABLE IF NOT EXISTS tap_file ("
+        " file_id INTEGER PRIMARY KEY,"
+        " file_name TEXT, sender TEXT, recipient TEXT, file_sequence_number TEXT,"
+        " specification_version INTEGER, release_version INTEGER, notification INTEGER,"
+        " loaded_at TEXT DEFAULT CURRENT_TIMESTAMP);"
+        "CREATE TABLE IF NOT EXISTS audit_total ("
+        " file_id INTEGER PRIMARY KEY, earliest_call_time_stamp TEXT, latest_call_time_stamp TEXT,"
+        " total_charge INTEGER, total_tax_value INTEGER, total_discount_value INTEGER,"
+        " call_event_details_count INTEGER);"
+        // one row per partly loaded file, updated with every committed chunk
+        "CREATE TABLE IF NOT EXISTS load_checkpoint ("
+        " stage_id INTEGER PRIMARY KEY,"
+        " file_name TEXT, sender TEXT, recipient TEXT, file_sequence_number TEXT, file_size INTEGER,"
+        " content_hash INTEGER, byte_offset INTEGER, event_count INTEGER, record_count INTEGER, total_charge INTEGER,"
+        " total_tax_value INTEGER, total_discount_value INTEGER, earliest_call INTEGER, latest_call INTEGER,"
+        " updated_at TEXT DEFAULT CURRENT_TIMESTAMP,"
+        " UNIQUE (sender, recipient, file_sequence_number));"
+        "CREATE TABLE IF NOT EXISTS record_error_stage ("
+        " file_id INTEGER, record_offset INTEGER, charge INTEGER, record_length INTEGER, code_errors INTEGER);";
+    std::string eventColumnTypes = EventColumnTypes(projection);
+    const std::string tables[][2] = { { projection.Table(), eventColumnTypes },
+        { "charge_detail", kChargeColumnTypes }, { "tax_information", kTaxColumnTypes } };
+    for (const auto& table : tables) {
+        schema += "CREATE TABLE IF NOT EXISTS " + table[0] + " (" + table[1] + ");";
+        schema += "CREATE TABLE IF NOT EXISTS " + table[0] + "_stage (" + table[1] + ");";
+        schema += "CREATE INDEX IF NOT EXISTS " + table[0] + "_stage_file ON " + table[0] + "_stage (file_id);";
+    }
+    return schema;
+}
+
+std::string InsertPrefix(const std::string& table, const std::string& columns)
+{
+    return "INSERT INTO " + table + " (file_id, " + columns + ") VALUES ";
+}
+
+// Copies the staged rows of stage ?2 into table under file_id ?1.
+std::string PublishSql(const std::string& table, const std::string& columns)
+{
+    return "INSERT INTO " + table + " (file_id, " + columns + ") SELECT ?1, " + columns
+        + " FROM " + table + "_stage WHERE file_id = ?2";
+}
+
+void BindText(sqlite3_stmt* stmt, int index, const char* value)
+{
+    if (*value) {
+        sqlite3_bind_text(stmt, index, value, -1, SQLITE_STATIC);
+    }
+    else {
+        sqlite3_bind_null(stmt, index);
+    }
+}
+
+void BindField(sqlite3_stmt* stmt, int index, const BindBuffer& b, size_t i, EventField field)
+{
+    switch (field) {
+    case EventField::LocalTimeStamp: sqlite3_bind_int64(stmt, index, b.localTimeStamp[i]); break;
+    case EventField::UtcTimeOffsetCode: sqlite3_bind_int(stmt, index, b.utcTimeOffsetCode[i]); break;
+    case EventField::StartTimeUtc: sqlite3_bind_int64(stmt, index, b.startTimeUtc[i]); break;
+    case EventField::RecEntityCode: sqlite3_bind_int(stmt, index, b.recEntityCode[i]); break;
+    case EventField::ExchangeRateCode: sqlite3_bind_int(stmt, index, b.exchangeRateCode[i]); break;
+    case EventField::Duration: sqlite3_bind_int64(stmt, index, b.duration[i]); break;
+    case EventField::Charge: sqlite3_bind_int64(stmt, index, b.charge[i]); break;
+    case EventField::ChargeLocal: sqlite3_bind_int64(stmt, index, b.chargeLocal[i]); break;
+    case EventField::ChargeableUnits: sqlite3_bind_int64(stmt, index, b.chargeableUnits[i]); break;
+    case EventField::TaxValue: sqlite3_bind_int64(stmt, index, b.taxValue[i]); break;
+    case EventField::DiscountValue: sqlite3_bind_int64(stmt, index, b.discountValue[i]); break;
+    case EventField::DataVolumeIncoming: sqlite3_bind_int64(stmt, index, b.dataVolumeIncoming[i]); break;
+    case EventField::DataVolumeOutgoing: sqlite3_bind_int64(stmt, index, b.dataVolumeOutgoing[i]); break;
+    case EventField::Imsi: BindText(stmt, index, b.imsi.At(i)); break;
+    case EventField::Msisdn: BindText(stmt, index, b.msisdn.At(i)); break;
+    case EventField::Imei: BindText(stmt, index, b.imei.At(i)); break;
+    case EventField::OtherParty: BindText(stmt, index, b.otherParty.At(i)); break;
+    default: sqlite3_bind_null(stmt, index); break;
+    }
+}
+
+} // namespace
+
+SqliteSink::SqliteSink(const std::string& path, size_t batchSize, const Projection& projection)
+    : ArrayBindSink(batchSize, projection), m_db(nullptr),
+      m_eventInsert{ InsertPrefix(projection.Table(), EventColumnList(projection)), EventColumnCount(projection),
+          1, {} },
+      m_chargeInsert{ InsertPrefix("charge_detail", kChargeColumns), kChargeColumnCount, 1, {} },
+      m_taxInsert{ InsertPrefix("tax_information", kTaxColumns), kTaxColumnCount, 1, {} },
+      m_eventStageInsert{ InsertPrefix(projection.Table() + "_stage", EventColumnList(projection)),
+          EventColumnCount(projection), 1, {} },
+      m_chargeStageInsert{ InsertPrefix("charge_detail_stage", kChargeColumns), kChargeColumnCount, 1, {} },
+      m_taxStageInsert{ InsertPrefix("tax_information_stage", kTaxColumns), kTaxColumnCount, 1, {} },
+      m_begin(nullptr), m_commit(nullptr), m_rollback(nullptr), m_fileInsert(nullptr), m_auditInsert(nullptr),
+      m_checkpointSelect(nullptr), m_checkpointInsert(nullptr), m_checkpointUpdate(nullptr),
+      m_errorSelect(nullptr), m_errorInsert(nullptr), m_publish(), m_clearStage(),
+      m_fileId(0), m_inTransaction(false), m_staged(false), m_stagedErrorCount(0), m_hasAuditTotals(false)
+{
+    if (sqlite3_open(path.c_str(), &m_db) != SQLITE_OK) {
+        std::string message = m_db ? sqlite3_errmsg(m_db) : "out of memory";
+        sqlite3_close(m_db);
+        throw DatabaseError("Unable to open SQLite database " + path + ": " + message);
+    }
+    // several daemon workers may share one database file
+    sqlite3_busy_timeout(m_db, 60000);
+    Execute("PRAGMA journal_mode=WAL");
+    Execute("PRAGMA synchronous=NORMAL");
+    Execute(Schema(projection).c_str());
+    int maxVariables = sqlite3_limit(m_db, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+    for (TableInsert* table : { &m_eventInsert, &m_chargeInsert, &m_taxInsert }) {
+        table->maxRows = std::max(1, maxVariables / table->columnCount);
+        InsertStatement(*table, std::min(table->maxRows, BatchSize()));
+    }
+    for (TableInsert* table : { &m_eventStageInsert, &m_chargeStageInsert, &m_taxStageInsert }) {
+        table->maxRows = std::max(1, maxVariables / table->columnCount);
+    }
+    // Every transaction writes. Taking the write lock up front lets
+    // busy_timeout wait for other sessions; a deferred BEGIN that reads
+    // first (the staged path reads load_checkpoint) fails with
+    // SQLITE_BUSY_SNAPSHOT on its first write instead, without retry.
+    m_begin = Prepare("BEGIN IMMEDIATE");
+    m_commit = Prepare("COMMIT");
+    m_rollback = Prepare("ROLLBACK");
+    m_fileInsert = Prepare("INSERT INTO tap_file (file_name, sender, recipient, file_sequence_number,"
+        " specification_version, release_version, notification) VALUES (?,?,?,?,?,?,?)");
+    m_auditInsert = Prepare("INSERT INTO audit_total (file_id, earliest_call_time_stamp, latest_call_time_stamp,"
+        " total_charge, total_tax_value, total_discount_value, call_event_details_count) VALUES (?,?,?,?,?,?,?)");
+    m_checkpointSelect = Prepare("SELECT stage_id, file_size, byte_offset, event_count, record_count, total_charge,"
+        " total_tax_value, total_discount_value, earliest_call, latest_call, content_hash FROM load_checkpoint"
+        " WHERE sender = ? AND recipient = ? AND file_sequence_number = ?");
+    m_checkpointInsert = Prepare("INSERT INTO load_checkpoint (file_name, sender, recipient, file_sequence_number,"
+        " file_size, content_hash, byte_offset, event_count, record_count) VALUES (?,?,?,?,0,0,0,0,0)");
+    m_checkpointUpdate = Prepare("UPDATE load_checkpoint SET file_size = ?, byte_offset = ?, event_count = ?,"
+        " record_count = ?, total_charge = ?, total_tax_value = ?, total_discount_value = ?, earliest_call = ?,"
+        " latest_call = ?, content_hash = ?, updated_at = CURRENT_TIMESTAMP WHERE stage_id = ?");
+    m_errorSelect = Prepare("SELECT record_offset, charge, record_length, code_errors FROM record_error_stage"
+        " WHERE file_id = ? ORDER BY record_offset");
+    m_errorInsert = Prepare("INSERT INTO record_error_stage (file_id, record_offset, charge, record_length,"
+        " code_errors) VALUES (?,?,?,?,?)");
+    m_publish[0] = Prepare(PublishSql(projection.Table(), EventColumnList(projection)));
+    m_publish[1] = Prepare(PublishSql("charge_detail", kChargeColumns));
+    m_publish[2] = Prepare(PublishSql("tax_information", kTaxColumns));
+    m_clearStage[0] = Prepare("DELETE FROM " + projection.Table() + "_stage WHERE file_id = ?");
+    for (size_t i = 0; i < 3; i++) {
+        m_clearStage[i + 1] = Prepare(std::string("DELETE FROM ") + kStagedTables[i] + " WHERE file_id = ?");
+    }
+    m_clearStage[4] = Prepare("DELETE FROM load_checkpoint WHERE stage_id = ?");
+}
+
+SqliteSink::~SqliteSink()
+{
+    for (TableInsert* table : { &m_eventInsert, &m_chargeInsert, &m_taxInsert,
+        &m_eventStageInsert, &m_chargeStageInsert, &m_taxStageInsert }) {
+        for (auto& entry : table->statements) {
+            sqlite3_finalize(entry.second);
+        }
+    }
+    if (m_inTransaction) {
+        sqlite3_exec(m_db, "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+    for (sqlite3_stmt* stmt : { m_begin, m_commit, m_rollback, m_fileInsert, m_auditInsert, m_checkpointSelect,
+        m_checkpointInsert, m_checkpointUpdate, m_errorSelect, m_errorInsert }) {
+        sqlite3_finalize(stmt);
+    }
+    for (sqlite3_stmt* stmt : m_publish) {
+        sqlite3_finalize(stmt);
+    }
+    for (sqlite3_stmt* stmt : m_clearStage) {
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(m_db);
+}
+
+void SqliteSink::Check(int rc, const char* what)
+{
+    if (rc != SQLITE_OK && rc != SQLITE_DONE && rc != SQLITE_ROW) {
+        throw DatabaseError(std::string(what) + ": " + sqlite3_errmsg(m_db));
+    }
+}
+
+void SqliteSink::Execute(const char* sql)
+{
+    Check(sqlite3_exec(m_db, sql, nullptr, nullptr, nullptr), sql);
+}
+
+sqlite3_stmt* SqliteSink::Prepare(const std::string& sql)
+{
+    sqlite3_stmt* stmt = nullptr;
+    Check(sqlite3_prepare_v2(m_db, sql.c_str(), -1, &stmt, nullptr), "prepare");
+    return stmt;
+}
+
+size_t SqliteSink::StatementRows(const TableInsert& table, size_t remaining) const
+{
+    size_t full = std::min(table.maxRows, BatchSize());
+    if (remaining >= full) {
+        return full;
+    }
+    size_t rows = 1;
+    while (rows * 2 <= remaining) {
+        rows *= 2;
+    }
+    return rows;
+}
+
+sqlite3_stmt* SqliteSink::InsertStatement(TableInsert& table, size_t rows)
+{
+    auto it = table.statements.find(rows);
+    if (it != table.statements.end()) {
+        return it->second;
+    }
+    std::string row = "(?";
+    for (int i = 1; i < table.columnCount; i++) {
+        row += ",?";
+    }
+    row += ")";
+    std::string sql(table.prefix);
+    for (size_t i = 0; i < rows; i++) {
+        if (i) {
+            sql += ",";
+        }
+        sql += row;
+    }
+    sqlite3_stmt* stmt = Prepare(sql);
+    table.statements[rows] = stmt;
+    return stmt;
+}
+
+void SqliteSink::Execute(sqlite3_stmt* stmt, const char* what)
+{
+    Step(stmt, what);
+    sqlite3_clear_bindings(stmt);
+}
+
+void SqliteSink::Step(sqlite3_stmt* stmt, const char* what)
+{
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    Check(rc, what);
+}
+
+void SqliteSink::BeginFile(const FileInfo& file)
+{
+    Execute(m_begin, "BEGIN IMMEDIATE");
+    m_inTransaction = true;
+    m_fileId = InsertFile(file);
+}
+
+int64_t SqliteSink::InsertFile(const FileInfo& file)
+{
+    sqlite3_bind_text(m_fileInsert, 1, file.fileName.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(m_fileInsert, 2, file.sender.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(m_fileInsert, 3, file.recipient.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(m_fileInsert, 4, file.fileSequenceNumber.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(m_fileInsert, 5, file.specificationVersionNumber);
+    sqlite3_bind_int(m_fileInsert, 6, file.releaseVersionNumber);
+    sqlite3_bind_int(m_fileInsert, 7, file.notification ? 1 : 0);
+    Execute(m_fileInsert, "insert tap_file");
+    return sqlite3_last_insert_rowid(m_db);
+}
+
+void SqliteSink::WriteAuditTotals(const AuditTotals& totals)
+{
+    if (m_staged) {
+        // the file_id is only known once the file is finalized
+        m_auditTotals = totals;
+        m_hasAuditTotals = true;
+        return;
+    }
+    InsertAuditTotals(m_fileId, totals);
+}
+
+void SqliteSink::InsertAuditTotals(int64_t fileId, const AuditTotals& totals)
+{
+    sqlite3_bind_int64(m_auditInsert, 1, fileId);
+    sqlite3_bind_text(m_auditInsert, 2, totals.earliestCallTimeStamp.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(m_auditInsert, 3, totals.latestCallTimeStamp.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(m_auditInsert, 4, totals.totalCharge);
+    sqlite3_bind_int64(m_auditInsert, 5, totals.totalTaxValue);
+    sqlite3_bind_int64(m_auditInsert, 6, totals.totalDiscountValue);
+    sqlite3_bind_int64(m_auditInsert, 7, totals.callEventDetailsCount);
+    Execute(m_auditInsert, "insert audit_total");
+}
+
+void SqliteSink::ExecuteArray(const BindBuffer& b)
+{
+    size_t row = 0;
+    while (row < b.rows) {
+        TableInsert& table = m_staged ? m_eventStageInsert : m_eventInsert;
+        size_t rows = StatementRows(table, b.rows - row);
+        sqlite3_stmt* stmt = InsertStatement(table, rows);
+        int index = 1;
+        const Projection& projection = EventProjection();
+        for (size_t i = row; i < row + rows; i++) {
+            sqlite3_bind_int64(stmt, index++, m_fileId);
+            sqlite3_bind_int(stmt, index++, b.recordType[i]);
+            sqlite3_bind_int64(stmt, index++, b.recordOffset[i]);
+            FieldSet fields = projection.Fields(static_cast<CallEventType>(b.recordType[i]));
+            for (const ProjectedColumn& column : projection.Columns()) {
+                if (fields & FieldBit(column.field)) {
+                    BindField(stmt, index++, b, i, column.field);
+                }
+                else {
+                    sqlite3_bind_null(stmt, index++);
+                }
+            }
+        }
+        Step(stmt, "insert call events");
+        row += rows;
+    }
+}
+
+void SqliteSink::ExecuteChargeArray(const ChargeColumns& c, size_t first, size_t count)
+{
+    size_t end = first + count;
+    while (first < end) {
+        TableInsert& table = m_staged ? m_chargeStageInsert : m_chargeInsert;
+        size_t rows = StatementRows(table, end - first);
+        sqlite3_stmt* stmt = InsertStatement(table, rows);
+        int index = 1;
+        for (size_t i = first; i < first + rows; i++) {
+            sqlite3_bind_int64(stmt, index++, m_fileId);
+            sqlite3_bind_int64(stmt, index++, c.recordOffset[i]);
+            sqlite3_bind_text(stmt, index++, reinterpret_cast<const char*>(&c.chargedItem[i]),
+                c.chargedItem[i] ? 1 : 0, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, index++, c.chargeType[i]);
+            sqlite3_bind_int(stmt, index++, c.exchangeRateCode[i]);
+            sqlite3_bind_int64(stmt, index++, c.charge[i]);
+            sqlite3_bind_int64(stmt, index++, c.chargeLocal[i]);
+            sqlite3_bind_int64(stmt, index++, c.chargeableUnits[i]);
+            sqlite3_bind_int64(stmt, index++, c.chargedUnits[i]);
+        }
+        Step(stmt, "insert charge_detail");
+        first += rows;
+    }
+}
+
+void SqliteSink::ExecuteTaxArray(const TaxColumns& t, size_t first, size_t count)
+{
+    size_t end = first + count;
+    while (first < end) {
+        TableInsert& table = m_staged ? m_taxStageInsert : m_taxInsert;
+        size_t rows = StatementRows(table, end - first);
+        sqlite3_stmt* stmt = InsertStatement(table, rows);
+        int index = 1;
+        for (size_t i = first; i < first + rows; i++) {
+            sqlite3_bind_int64(stmt, index++, m_fileId);
+            sqlite3_bind_int64(stmt, index++, t.recordOffset[i]);
+            sqlite3_bind_int(stmt, index++, t.taxCode[i]);
+            sqlite3_bind_int64(stmt, index++, t.taxValue[i]);
+            sqlite3_bind_int64(stmt, index++, t.taxableAmount[i]);
+        }
+        Step(stmt, "insert tax_information");
+        first += rows;
+    }
+}
+
+void SqliteSink::CommitFile()
+{
+    Flush();
+    Execute(m_commit, "COMMIT");
+    m_inTransaction = false;
+}
+
+void SqliteSink::RollbackFile()
+{
+    Discard();
+    m_staged = false;
+    if (m_inTransaction) {
+        m_inTransaction = false;
+        Execute(m_rollback, "ROLLBACK");
+    }
+}
+
+bool SqliteSink::BeginStagedFile(const FileInfo& file, LoadCheckpoint& checkpoint)
+{
+    Execute(m_begin, "BEGIN IMMEDIATE");
+    m_inTransaction = true;
+    m_staged = true;
+    m_stagedFile = file;
+    m_hasAuditTotals = false;
+    checkpoint = LoadCheckpoint();
+    sqlite3_bind_text(m_checkpointSelect, 1, file.sender.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(m_checkpointSelect, 2, file.recipient.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(m_checkpointSelect, 3, file.fileSequenceNumber.c_str(), -1, SQLITE_TRANSIENT);
+    int rc = sqlite3_step(m_checkpointSelect);
+    bool found = rc == SQLITE_ROW;
+    if (found) {
+        m_fileId = sqlite3_column_int64(m_checkpointSelect, 0);
+        checkpoint.fileSize = sqlite3_column_int64(m_checkpointSelect, 1);
+        checkpoint.byteOffset = sqlite3_column_int64(m_checkpointSelect, 2);
+        checkpoint.eventCount = sqlite3_column_int64(m_checkpointSelect, 3);
+        checkpoint.audit.Restore(sqlite3_column_int64(m_checkpointSelect, 5),
+            sqlite3_column_int64(m_checkpointSelect, 6), sqlite3_column_int64(m_checkpointSelect, 7),
+            sqlite3_column_int64(m_checkpointSelect, 4), sqlite3_column_int64(m_checkpointSelect, 8),
+            sqlite3_column_int64(m_checkpointSelect, 9));
+        checkpoint.contentHash = static_cast<uint64_t>(sqlite3_column_int64(m_checkpointSelect, 10));
+    }
+    sqlite3_reset(m_checkpointSelect);
+    sqlite3_clear_bindings(m_checkpointSelect);
+    Check(rc, "select load_checkpoint");
+    if (!found) {
+        sqlite3_bind_text(m_checkpointInsert, 1, file.fileName.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(m_checkpointInsert, 2, file.sender.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(m_checkpointInsert, 3, file.recipient.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(m_checkpointInsert, 4, file.fileSequenceNumber.c_str(), -1, SQLITE_TRANSIENT);
+        Execute(m_checkpointInsert, "insert load_checkpoint");
+        m_fileId = sqlite3_last_insert_rowid(m_db);
+        m_stagedErrorCount = 0;
+        return false;
+    }
+    sqlite3_bind_int64(m_errorSelect, 1, m_fileId);
+    while ((rc = sqlite3_step(m_errorSelect)) == SQLITE_ROW) {
+        checkpoint.recordErrors.push_back(RecordError{
+            static_cast<uint64_t>(sqlite3_column_int64(m_errorSelect, 0)),
+            sqlite3_column_int64(m_errorSelect, 1),
+            static_cast<uint32_t>(sqlite3_column_int64(m_errorSelect, 2)),
+            static_cast<uint32_t>(sqlite3_column_int64(m_errorSelect, 3)) });
+    }
+    sqlite3_reset(m_errorSelect);
+    sqlite3_clear_bindings(m_errorSelect);
+    Check(rc, "select record_error_stage");
+    m_stagedErrorCount = checkpoint.recordErrors.size();
+    return true;
+}
+
+void SqliteSink::WriteCheckpoint(const LoadCheckpoint& checkpoint)
+{
+    Flush();
+    for (size_t i = m_stagedErrorCount; i < checkpoint.recordErrors.size(); i++) {
+        const RecordError& error = checkpoint.recordErrors[i];
+        sqlite3_bind_int64(m_errorInsert, 1, m_fileId);
+        sqlite3_bind_int64(m_errorInsert, 2, static_cast<int64_t>(error.recordOffset));
+        sqlite3_bind_int64(m_errorInsert, 3, error.charge);
+        sqlite3_bind_int64(m_errorInsert, 4, error.recordLength);
+        sqlite3_bind_int64(m_errorInsert, 5, error.codeErrors);
+        Execute(m_errorInsert, "insert record_error_stage");
+    }
+    const AuditAccumulator& audit = checkpoint.audit;
+    sqlite3_bind_int64(m_checkpointUpdate, 1, static_cast<int64_t>(checkpoint.fileSize));
+    sqlite3_bind_int64(m_checkpointUpdate, 2, static_cast<int64_t>(checkpoint.byteOffset));
+    sqlite3_bind_int64(m_checkpointUpdate, 3, static_cast<int64_t>(checkpoint.eventCount));
+    sqlite3_bind_int64(m_checkpointUpdate, 4, static_cast<int64_t>(audit.RecordCount()));
+    sqlite3_bind_int64(m_checkpointUpdate, 5, audit.TotalCharge());
+    sqlite3_bind_int64(m_checkpointUpdate, 6, audit.TotalTaxValue());
+    sqlite3_bind_int64(m_checkpointUpdate, 7, audit.TotalDiscountValue());
+    sqlite3_bind_int64(m_checkpointUpdate, 8, audit.EarliestCallTime());
+    sqlite3_bind_int64(m_checkpointUpdate, 9, audit.LatestCallTime());
+    sqlite3_bind_int64(m_checkpointUpdate, 10, static_cast<int64_t>(checkpoint.contentHash));
+    sqlite3_bind_int64(m_checkpointUpdate, 11, m_fileId);
+    Execute(m_checkpointUpdate, "update load_checkpoint");
+    Execute(m_commit, "COMMIT");
+    m_inTransaction = false;
+    m_stagedErrorCount = checkpoint.recordErrors.size();
+    Execute(m_begin, "BEGIN IMMEDIATE");
+    m_inTransaction = true;
+}
+
+void SqliteSink::FinalizeFile()
+{
+    Flush();
+    int64_t stageId = m_fileId;
+    int64_t fileId = InsertFile(m_stagedFile);
+    for (sqlite3_stmt* stmt : m_publish) {
+        sqlite3_bind_int64(stmt, 1, fileId);
+        sqlite3_bind_int64(stmt, 2, stageId);
+        Execute(stmt, "publish staged rows");
+    }
+    if (m_hasAuditTotals) {
+        InsertAuditTotals(fileId, m_auditTotals);
+    }
+    ClearStage(stageId);
+    Execute(m_commit, "COMMIT");
+    m_inTransaction = false;
+    m_staged = false;
+    m_fileId = fileId;
+}
+
+void SqliteSink::DiscardStagedFile()
+{
+    Discard();
+    if (m_inTransaction) {
+        m_inTransaction = false;
+        Execute(m_rollback, "ROLLBACK");
+    }
+    Execute(m_begin, "BEGIN IMMEDIATE");
+    m_inTransaction = true;
+    ClearStage(m_fileId);
+    Execute(m_commit, "COMMIT");
+    m_inTransaction = false;
+    m_staged = false;
+}
+
+void SqliteSink::ClearStage(int64_t stageId)
+{
+    for (sqlite3_stmt* stmt : m_clearStage) {
+        sqlite3_bind_int64(stmt, 1, stageId);
+        Execute(stmt, "clear staged rows");
+    }
+}
+
+} // namespace tap3
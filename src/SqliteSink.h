@@ -0,0 +1,98 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include "ArrayBindSink.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace tap3 {
+
+// Embedded stand-in for the production database. SQLite has no array DML,
+// so each round trip is one multi-row INSERT with all rows of the batch
+// bound as parameters. Statements are cached for the full batch size and
+// for powers of two below it; a remainder is sent in chunks of those
+// sizes, so a long-lived session holds a bounded number of statements. Every file is loaded in a single transaction. All statements are
+// prepared when the session opens and kept for its lifetime, which makes a
+// pooled session cheap to reuse for the next file.
+// Staged files are written to the *_stage tables, one transaction per
+// chunk, with their progress in load_checkpoint; FinalizeFile copies them
+// into the loaded tables and clears the stage in a single transaction.
+// Call events go to the projection's table (call_event with all fields by
+// default), which is created with the projected columns if missing.
+class SqliteSink : public ArrayBindSink
+{
+public:
+    SqliteSink(const std::string& path, size_t batchSize, const Projection& projection = Projection());
+    ~SqliteSink() override;
+
+    void BeginFile(const FileInfo& file) override;
+    void CommitFile() override;
+    void RollbackFile() override;
+    void WriteAuditTotals(const AuditTotals& totals) override;
+
+    bool SupportsStaging() const override { return true; }
+    bool BeginStagedFile(const FileInfo& file, LoadCheckpoint& checkpoint) override;
+    void WriteCheckpoint(const LoadCheckpoint& checkpoint) override;
+    void FinalizeFile() override;
+    void DiscardStagedFile() override;
+
+protected:
+    void ExecuteArray(const BindBuffer& buffer) override;
+    void ExecuteChargeArray(const ChargeColumns& charges, size_t first, size_t count) override;
+    void ExecuteTaxArray(const TaxColumns& taxes, size_t first, size_t count) override;
+
+private:
+    // Multi-row INSERT into one table, with statements cached per row count
+    // (see StatementRows).
+    struct TableInsert
+    {
+        std::string prefix;
+        int columnCount;
+        size_t maxRows;
+        std::map<size_t, sqlite3_stmt*> statements;
+    };
+
+    void Execute(const char* sql);
+    void Execute(sqlite3_stmt* stmt, const char* what);
+    sqlite3_stmt* Prepare(const std::string& sql);
+    // Rows of the next INSERT for remaining rows: the full batch size, or
+    // the largest power of two not above remaining.
+    size_t StatementRows(const TableInsert& table, size_t remaining) const;
+    sqlite3_stmt* InsertStatement(TableInsert& table, size_t rows);
+    void Step(sqlite3_stmt* stmt, const char* what);
+    void Check(int rc, const char* what);
+    int64_t InsertFile(const FileInfo& file);
+    void InsertAuditTotals(int64_t fileId, const AuditTotals& totals);
+    void ClearStage(int64_t stageId);
+
+    sqlite3* m_db;
+    TableInsert m_eventInsert;
+    TableInsert m_chargeInsert;
+    TableInsert m_taxInsert;
+    TableInsert m_eventStageInsert;
+    TableInsert m_chargeStageInsert;
+    TableInsert m_taxStageInsert;
+    sqlite3_stmt* m_begin;
+    sqlite3_stmt* m_commit;
+    sqlite3_stmt* m_rollback;
+    sqlite3_stmt* m_fileInsert;
+    sqlite3_stmt* m_auditInsert;
+    sqlite3_stmt* m_checkpointSelect;
+    sqlite3_stmt* m_checkpointInsert;
+    sqlite3_stmt* m_checkpointUpdate;
+    sqlite3_stmt* m_errorSelect;
+    sqlite3_stmt* m_errorInsert;
+    sqlite3_stmt* m_publish[3];         // call_event, charge_detail, tax_information
+    sqlite3_stmt* m_clearStage[5];      // the *_stage tables and load_checkpoint
+    int64_t m_fileId;                   // stage_id while a staged file is open
+    bool m_inTransaction;
+    bool m_staged;
+    FileInfo m_stagedFile;
+    size_t m_stagedErrorCount;          // record errors already in record_error_stage
+    bool m_hasAuditTotals;
+    AuditTotals m_auditTotals;          // of the staged file, written by FinalizeFile
+};
+
+} // namespace tap3
@@ -0,0 +1,497 @@
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+#include "BulkLoader.h"
+#include "DuplicateIndex.h"
+#include "FlatFileSink.h"
+#include "LoaderDaemon.h"
+#include "MappedFile.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "PreValidator.h"
+#include "Projection.h"
+#include "SqliteSink.h"
+#include "Tap3Error.h"
+#include "TapDecoder.h"
+#include "TapLoader.h"
+
+using namespace tap3;
+
+namespace {
+
+class SummaryHandler : public TapHandler
+{
+public:
+    explicit SummaryHandler(const TapDecoder& decoder) : m_decoder(decoder) {}
+
+    void OnBatchControlInfo(const BatchControlInfo& info) override
+    {
+        std::cout << "Sender: " << info.sender.AsString()
+            << ", recipient: " << info.recipient.AsString()
+            << ", file sequence: " << info.fileSequenceNumber.AsString()
+            << ", TAP " << info.specificationVersionNumber << "." << info.releaseVersionNumber << std::endl;
+    }
+
+    void OnEventBatch(const EventBatch& batch) override
+    {
+        for (size_t i = 0; i < kCallEventTypeCount; i++) {
+            const EventColumns& columns = batch.Columns(static_cast<CallEventType>(i));
+            m_counts[i] += columns.Size();
+            for (int64_t charge : columns.charge) {
+                m_totalCharge += charge;
+            }
+        }
+    }
+
+    void OnAuditControlInfo(const AuditControlInfo& info) override
+    {
+        std::cout << "AuditControlInfo: " << info.callEventDetailsCount << " events, total charge "
+            << info.totalCharge << std::endl;
+        m_auditReport = m_decoder.Audit().Compare(info);
+    }
+
+    const std::string& AuditReport() const { return m_auditReport; }
+
+    void OnNotification(const Notification& info) override
+    {
+        std::cout << "Notification from " << info.sender.AsString()
+            << ", file sequence: " << info.fileSequenceNumber.AsString() << std::endl;
+    }
+
+    void Print() const
+    {
+        for (size_t i = 0; i < kCallEventTypeCount; i++) {
+            if (m_counts[i] > 0) {
+                std::cout << CallEventTypeName(static_cast<CallEventType>(i)) << ": " << m_counts[i] << std::endl;
+            }
+        }
+        std::cout << "Decoded total charge: " << m_totalCharge << std::endl;
+    }
+
+private:
+    const TapDecoder& m_decoder;
+    std::string m_auditReport;
+    uint64_t m_counts[kCallEventTypeCount] = {};
+    int64_t m_totalCharge = 0;
+};
+
+// SIGINT/SIGTERM are blocked before any thread starts and later taken by a
+// dedicated thread, so workers are never interrupted in the middle of a
+// file.
+sigset_t BlockStopSignals()
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    return signals;
+}
+
+// Calls run() while a signal thread waits for SIGINT/SIGTERM and calls
+// stop() when one arrives.
+void RunUntilStopped(const sigset_t& signals, const std::function<void()>& run, const std::function<void()>& stop)
+{
+    std::atomic<bool> finished(false);
+    std::thread signalThread([&stop, &finished, signals]() {
+        int signal;
+        sigwait(&signals, &signal);
+        if (!finished) {
+            std::cout << "Signal " << signal << " received, stopping" << std::endl;
+            stop();
+        }
+    });
+    auto wakeSignalThread = [&finished, &signalThread]() {
+        finished = true;
+        // wake the signal thread if run() ended on its own
+        pthread_kill(signalThread.native_handle(), SIGTERM);
+        signalThread.join();
+    };
+    try {
+        run();
+    }
+    catch (...) {
+        wakeSignalThread();
+        throw;
+    }
+    wakeSignalThread();
+}
+
+int RunDaemon(const DaemonSettings& settings, const SessionPool::Factory& sinkFactory, uint16_t metricsPort)
+{
+    sigset_t signals = BlockStopSignals();
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (metricsPort != 0) {
+        metricsServer.reset(new MetricsServer(*settings.loader.metrics, metricsPort));
+    }
+    LoaderDaemon daemon(settings, sinkFactory);
+    RunUntilStopped(signals, [&daemon]() { daemon.Run(); }, [&daemon]() { daemon.Stop(); });
+    return 0;
+}
+
+int RunBulk(const BulkSettings& settings, const SessionPool::Factory& sinkFactory, const char* metricsFile)
+{
+    sigset_t signals = BlockStopSignals();
+    BulkLoader bulk(settings, sinkFactory);
+    BulkResult result;
+    RunUntilStopped(signals, [&bulk, &result]() { result = bulk.Run(); }, [&bulk]() { bulk.Stop(); });
+    if (metricsFile) {
+        settings.loader.metrics->WriteTextFile(metricsFile);
+    }
+    std::cout << settings.source << ": " << result.loadedCount << " of " << result.fileCount << " files loaded, "
+        << result.eventCount << " events in " << result.seconds << " s";
+    if (result.seconds > 0) {
+        std::cout << " (" << static_cast<uint64_t>(result.eventCount / result.seconds) << " events/s, "
+            << result.byteCount / result.seconds / 1e6 << " MB/s)";
+    }
+    std::cout << std::endl;
+    if (result.duplicateFileCount > 0) {
+        std::cout << result.duplicateFileCount << " files already loaded" << std::endl;
+    }
+    if (result.failedCount > 0) {
+        std::cout << result.failedCount << " files failed" << std::endl;
+    }
+    if (result.skippedCount > 0) {
+        std::cout << result.skippedCount << " files not attempted" << std::endl;
+    }
+    return result.loadedCount + result.duplicateFileCount == result.fileCount ? 0 : 2;
+}
+
+const size_t kMaxThreads = 1024;
+const size_t kMaxBatchSize = 1 << 20;
+const size_t kMaxQueueCapacity = 1 << 20;
+
+// Parses a decimal number in [min, max]; false on anything else.
+template <typename T>
+bool ParseNumber(const char* text, uint64_t min, uint64_t max, T& value)
+{
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    unsigned long long parsed = strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed < min || parsed > max) {
+        return false;
+    }
+    value = static_cast<T>(parsed);
+    return true;
+}
+
+void Usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [-t threads] [-d sqlite-db | -F output-dir [--flat-format csv|binary]]"
+        " [-b batch-size] [-c checkpoint-events] [-r rap-dir] [-x duplicate-index] [-P projection]"
+        " [--metrics-file path] [--max-inflated-mb size] <TAP file>" << std::endl
+        << "       " << program << " --check <TAP file>" << std::endl
+        << "       " << program << " --daemon <inbound dir> (-d sqlite-db | -F output-dir [--flat-format csv|binary])"
+        " -o <done dir> -e <error dir>"
+        " [-w workers] [-p sessions] [-q queue-capacity] [-t threads] [-b batch-size] [-c checkpoint-events]"
+        " [-r rap-dir] [-x duplicate-index] [-P projection] [--metrics-port port] [--metrics-file path]"
+        " [--max-inflated-mb size] [--inflate-slots n]" << std::endl
+        << "       " << program << " --bulk <directory|tar|zip> (-d sqlite-db | -F output-dir"
+        " [--flat-format csv|binary]) [-w workers] [-p sessions]"
+        " [-t threads] [-b batch-size] [-c checkpoint-events] [-r rap-dir] [-x duplicate-index] [-P projection]"
+        " [--metrics-file path] [--max-inflated-mb size] [--inflate-slots n]" << std::endl;
+}
+
+// The database sink, or the flat file sink when an output directory is
+// given instead.
+SessionPool::Factory SinkFactory(const char* database, const char* flatDirectory, FlatFileFormat flatFormat,
+    size_t sinkBatchSize, const Projection& projection)
+{
+    if (flatDirectory) {
+        std::string directory = flatDirectory;
+        return [directory, flatFormat, sinkBatchSize, &projection]() {
+            return std::unique_ptr<EventSink>(new FlatFileSink(directory, flatFormat, sinkBatchSize, projection));
+        };
+    }
+    std::string path = database;
+    return [path, sinkBatchSize, &projection]() {
+        return std::unique_ptr<EventSink>(new SqliteSink(path, sinkBatchSize, projection));
+    };
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t threadCount = std::thread::hardware_concurrency();
+    bool threadCountSet = false;
+    size_t sinkBatchSize = 10000;
+    const char* database = nullptr;
+    const char* flatDirectory = nullptr;
+    FlatFileFormat flatFormat = FlatFileFormat::Csv;
+    const char* path = nullptr;
+    DaemonSettings daemonSettings;
+    bool daemonMode = false;
+    BulkSettings bulkSettings;
+    bool bulkMode = false;
+    size_t workerCount = 0;
+    size_t sessionCount = 0;
+    bool checkOnly = false;
+    const char* rapDirectory = nullptr;
+    const char* metricsFile = nullptr;
+    uint16_t metricsPort = 0;
+    uint64_t checkpointEvents = 0;
+    const char* indexPath = nullptr;
+    const char* projectionPath = nullptr;
+    MappedFile::InflateLimits inflateLimits;
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            ok = ParseNumber(argv[++i], 1, kMaxThreads, threadCount);
+            threadCountSet = true;
+        }
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            ok = ParseNumber(argv[++i], 1, kMaxBatchSize, sinkBatchSize);
+        }
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            database = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-F") && i + 1 < argc) {
+            flatDirectory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--flat-format") && i + 1 < argc) {
+            const char* format = argv[++i];
+            if (!strcmp(format, "binary")) {
+                flatFormat = FlatFileFormat::Binary;
+            }
+            else if (strcmp(format, "csv")) {
+                std::cerr << "Unknown flat file format " << format << std::endl;
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            ok = ParseNumber(argv[++i], 0, UINT64_MAX, checkpointEvents);
+        }
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rapDirectory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-x") && i + 1 < argc) {
+            indexPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-P") && i + 1 < argc) {
+            projectionPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--metrics-port") && i + 1 < argc) {
+            ok = ParseNumber(argv[++i], 1, UINT16_MAX, metricsPort);
+        }
+        else if (!strcmp(argv[i], "--metrics-file") && i + 1 < argc) {
+            metricsFile = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--max-inflated-mb") && i + 1 < argc) {
+            uint64_t megabytes = 0;
+            ok = ParseNumber(argv[++i], 1, UINT64_MAX >> 20, megabytes);
+            inflateLimits.maxInflatedSize = megabytes << 20;
+        }
+        else if (!strcmp(argv[i], "--inflate-slots") && i + 1 < argc) {
+            ok = ParseNumber(argv[++i], 1, kMaxThreads, inflateLimits.maxConcurrent);
+        }
+        else if (!strcmp(argv[i], "--check")) {
+            checkOnly = true;
+        }
+        else if (!strcmp(argv[i], "--daemon") && i + 1 < argc) {
+            daemonMode = true;
+            daemonSettings.inputDirectory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--bulk") && i + 1 < argc) {
+            bulkMode = true;
+            bulkSettings.source = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            ok = ParseNumber(argv[++i], 1, kMaxThreads, workerCount);
+        }
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            ok = ParseNumber(argv[++i], 1, kMaxThreads, sessionCount);
+        }
+        else if (!strcmp(argv[i], "-q") && i + 1 < argc) {
+            ok = ParseNumber(argv[++i], 1, kMaxQueueCapacity, daemonSettings.queueCapacity);
+        }
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            daemonSettings.doneDirectory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc) {
+            daemonSettings.errorDirectory = argv[++i];
+        }
+        else if (argv[i][0] == '-' || path) {
+            // an unknown option, one without its value, or a second path
+            ok = false;
+        }
+        else {
+            path = argv[i];
+        }
+        if (!ok) {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    MappedFile::SetInflateLimits(inflateLimits);
+    if (bulkMode) {
+        if (!database && !flatDirectory) {
+            std::cerr << "Bulk mode needs -d or -F" << std::endl;
+            return 1;
+        }
+        // files are loaded side by side on all cores, each decoded on one
+        // thread unless -t says otherwise
+        bulkSettings.workerCount = workerCount > 0 ? workerCount : std::thread::hardware_concurrency();
+        bulkSettings.sessionCount = sessionCount;
+        bulkSettings.loader.decodeThreads = threadCountSet ? threadCount : 1;
+        bulkSettings.loader.checkpointEvents = checkpointEvents;
+        if (rapDirectory) {
+            bulkSettings.loader.rapDirectory = rapDirectory;
+        }
+        Metrics metrics;
+        if (metricsFile) {
+            bulkSettings.loader.metrics = &metrics;
+        }
+        try {
+            std::unique_ptr<DuplicateIndex> index;
+            if (indexPath) {
+                index.reset(new DuplicateIndex(indexPath));
+                bulkSettings.loader.duplicateIndex = index.get();
+            }
+            Projection projection;
+            if (projectionPath) {
+                projection = Projection::Load(projectionPath);
+                bulkSettings.loader.projection = &projection;
+            }
+            return RunBulk(bulkSettings, SinkFactory(database, flatDirectory, flatFormat, sinkBatchSize, projection),
+                metricsFile);
+        }
+        catch (const std::exception& ex) {
+            std::cerr << ex.what() << std::endl;
+            return 2;
+        }
+    }
+    if (daemonMode) {
+        if ((!database && !flatDirectory) || daemonSettings.doneDirectory.empty()
+            || daemonSettings.errorDirectory.empty()) {
+            std::cerr << "Daemon mode needs -d or -F, -o and -e" << std::endl;
+            return 1;
+        }
+        if (workerCount > 0) {
+            daemonSettings.workerCount = workerCount;
+        }
+        if (sessionCount > 0) {
+            daemonSettings.sessionCount = sessionCount;
+        }
+        daemonSettings.loader.decodeThreads = threadCount;
+        daemonSettings.loader.checkpointEvents = checkpointEvents;
+        if (rapDirectory) {
+            daemonSettings.loader.rapDirectory = rapDirectory;
+        }
+        Metrics metrics;
+        if (metricsPort != 0 || metricsFile) {
+            daemonSettings.loader.metrics = &metrics;
+        }
+        if (metricsFile) {
+            daemonSettings.metricsFile = metricsFile;
+        }
+        try {
+            std::unique_ptr<DuplicateIndex> index;
+            if (indexPath) {
+                index.reset(new DuplicateIndex(indexPath));
+                daemonSettings.loader.duplicateIndex = index.get();
+            }
+            Projection projection;
+            if (projectionPath) {
+                projection = Projection::Load(projectionPath);
+                daemonSettings.loader.projection = &projection;
+            }
+            return RunDaemon(daemonSettings, SinkFactory(database, flatDirectory, flatFormat, sinkBatchSize, projection),
+                metricsPort);
+        }
+        catch (const std::exception& ex) {
+            std::cerr << ex.what() << std::endl;
+            return 2;
+        }
+    }
+    if (!path) {
+        Usage(argv[0]);
+        return 1;
+    }
+    try {
+        if (checkOnly) {
+            MappedFile file(path);
+            PreValidate(file.View());
+            std::cout << path << ": no fatal errors" << std::endl;
+            return 0;
+        }
+        if (database || flatDirectory) {
+            Projection projection;
+            if (projectionPath) {
+                projection = Projection::Load(projectionPath);
+            }
+            std::unique_ptr<EventSink> sink = SinkFactory(database, flatDirectory, flatFormat, sinkBatchSize,
+                projection)();
+            LoaderSettings settings;
+            if (projectionPath) {
+                settings.projection = &projection;
+            }
+            settings.decodeThreads = threadCount;
+            settings.checkpointEvents = checkpointEvents;
+            if (rapDirectory) {
+                settings.rapDirectory = rapDirectory;
+            }
+            std::unique_ptr<DuplicateIndex> index;
+            if (indexPath) {
+                index.reset(new DuplicateIndex(indexPath));
+                settings.duplicateIndex = index.get();
+            }
+            Metrics metrics;
+            if (metricsFile) {
+                settings.metrics = &metrics;
+            }
+            TapLoader loader(settings);
+            LoadResult result;
+            try {
+                result = loader.LoadFile(path, *sink);
+            }
+            catch (...) {
+                if (metricsFile) {
+                    metrics.WriteTextFile(metricsFile);
+                }
+                throw;
+            }
+            if (metricsFile) {
+                metrics.WriteTextFile(metricsFile);
+            }
+            std::cout << path << ": loaded " << result.eventCount << " events from "
+                << result.file.sender << ", file sequence " << result.file.fileSequenceNumber << std::endl;
+            if (result.duplicateEventCount > 0) {
+                std::cout << result.duplicateEventCount << " duplicate events left out" << std::endl;
+            }
+            if (result.resumedEventCount > 0) {
+                std::cout << "Resumed after " << result.resumedEventCount << " events" << std::endl;
+            }
+            if (!result.rapFile.empty()) {
+                std::cout << result.severeErrorCount << " records returned in " << result.rapFile << std::endl;
+            }
+            return 0;
+        }
+        MappedFile file(path);
+        TapDecoder decoder(threadCount);
+        SummaryHandler handler(decoder);
+        decoder.SetAuditValidation(false);
+        decoder.Decode(file.View(), handler);
+        handler.Print();
+        if (!handler.AuditReport().empty()) {
+            std::cout << "AuditControlInfo mismatch: " << handler.AuditReport() << std::endl;
+        }
+    }
+    catch (const std::exception& ex) {
+        std::cerr << path << ": " << ex.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
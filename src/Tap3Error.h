@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+namespace tap3 {
+
+// Base class for all errors raised while reading, decoding or loading TAP files.
+class Tap3Error : public std::runtime_error
+{
+public:
+    explicit Tap3Error(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Malformed BER encoding: bad tag, bad length or value running past its container.
+class BerError : public Tap3Error
+{
+public:
+    BerError(const std::string& message, size_t offset)
+        : Tap3Error(message + " at offset " + std::to_string(offset)), m_offset(offset) {}
+
+    size_t Offset() const { return m_offset; }
+
+private:
+    size_t m_offset;
+};
+
+// Failure reported by a database sink. The file itself may be fine, the
+// session is suspect.
+class DatabaseError : public Tap3Error
+{
+public:
+    explicit DatabaseError(const std::string& message) : Tap3Error(message) {}
+};
+
+} // namespace tap3
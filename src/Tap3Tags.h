@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tap3 {
+
+// APPLICATION tag numbers from the TD.57 ASN.1 module (TAP 3.10 - 3.12).
+namespace tag {
+
+const uint32_t TransferBatch = 1;
+const uint32_t Notification = 2;
+const uint32_t CallEventDetailList = 3;
+const uint32_t BatchControlInfo = 4;
+const uint32_t AccountingInfo = 5;
+const uint32_t NetworkInfo = 6;
+const uint32_t MessageDescriptionInfoList = 8;
+const uint32_t MobileOriginatedCall = 9;
+const uint32_t MobileTerminatedCall = 10;
+const uint32_t SupplServiceEvent = 11;
+const uint32_t ServiceCentreUsage = 12;
+const uint32_t GprsCall = 14;
+const uint32_t AuditControlInfo = 15;
+const uint32_t LocalTimeStamp = 16;
+const uint32_t ContentTransaction = 17;
+const uint32_t BasicService = 36;
+const uint32_t BasicServiceUsedList = 38;
+const uint32_t BasicServiceUsed = 39;
+const uint32_t CallOriginator = 41;
+const uint32_t CallEventDetailsCount = 43;
+const uint32_t CallEventStartTimeStamp = 44;
+const uint32_t CamelServiceKey = 55;
+const uint32_t CamelServiceLevel = 56;
+const uint32_t CamelServiceUsed = 57;
+const uint32_t Charge = 62;
+const uint32_t ChargeDetail = 63;
+const uint32_t ChargeDetailList = 64;
+const uint32_t ChargeableUnits = 65;
+const uint32_t ChargedItem = 66;
+const uint32_t ChargedUnits = 68;
+const uint32_t ChargeInformation = 69;
+const uint32_t ChargeInformationList = 70;
+const uint32_t ChargeType = 71;
+const uint32_t ChargingTimeStamp = 74;
+const uint32_t CurrencyConversionList = 80;
+const uint32_t DefaultCallHandlingIndicator = 87;
+const uint32_t Destination = 89;
+const uint32_t DiscountCode = 91;
+const uint32_t Discounting = 94;
+const uint32_t DiscountingList = 95;
+const uint32_t DiscountInformation = 96;
+const uint32_t EarliestCallTimeStamp = 101;
+const uint32_t ExchangeRate = 104;
+const uint32_t ExchangeRateCode = 105;
+const uint32_t CurrencyConversion = 106;
+const uint32_t FileAvailableTimeStamp = 107;
+const uint32_t FileCreationTimeStamp = 108;
+const uint32_t FileSequenceNumber = 109;
+const uint32_t FileTypeIndicator = 110;
+const uint32_t GprsBasicCallInformation = 114;
+const uint32_t GprsChargeableSubscriber = 115;
+const uint32_t GprsServiceUsed = 121;
+const uint32_t Imei = 128;
+const uint32_t Imsi = 129;
+const uint32_t LatestCallTimeStamp = 133;
+const uint32_t LocalCurrency = 135;
+const uint32_t LocationInformation = 138;
+const uint32_t MessageDescriptionCode = 141;
+const uint32_t MessageDescription = 142;
+const uint32_t MoBasicCallInformation = 147;
+const uint32_t Msisdn = 152;
+const uint32_t MtBasicCallInformation = 153;
+const uint32_t NetworkLocation = 156;
+const uint32_t NumberOfDecimalPlaces = 159;
+const uint32_t OperatorSpecInfoList = 162;
+const uint32_t OperatorSpecInformation = 163;
+const uint32_t MessageDescriptionInformation = 174;
+const uint32_t RapFileSequenceNumber = 181;
+const uint32_t Recipient = 182;
+const uint32_t RecEntityInformation = 183;
+const uint32_t RecEntityCode = 184;
+const uint32_t RecEntityCodeList = 185;
+const uint32_t RecEntityType = 186;
+const uint32_t RecEntityInfoList = 188;
+const uint32_t ReleaseVersionNumber = 189;
+const uint32_t Sender = 196;
+const uint32_t SimChargeableSubscriber = 199;
+const uint32_t SpecificationVersionNumber = 201;
+const uint32_t SsParameters = 204;
+const uint32_t SupplServiceUsed = 206;
+const uint32_t SupplServiceActionCode = 208;
+const uint32_t SupplServiceCode = 209;
+const uint32_t TapCurrency = 210;
+const uint32_t TaxationList = 211;
+const uint32_t TaxInformation = 213;
+const uint32_t TaxInformationList = 214;
+const uint32_t TaxRate = 215;
+const uint32_t Taxation = 216;
+const uint32_t TaxCode = 217;
+const uint32_t TeleServiceCode = 218;
+const uint32_t TaxType = 220;
+const uint32_t TotalCallEventDuration = 223;
+const uint32_t TotalDiscountValue = 225;
+const uint32_t TotalTaxValue = 226;
+const uint32_t TransferCutOffTimeStamp = 227;
+const uint32_t UtcTimeOffset = 231;
+const uint32_t UtcTimeOffsetCode = 232;
+const uint32_t UtcTimeOffsetInfo = 233;
+const uint32_t UtcTimeOffsetInfoList = 234;
+const uint32_t SupplServiceUsedList = 237;
+const uint32_t TapDecimalPlaces = 244;
+const uint32_t DataVolumeIncoming = 250;
+const uint32_t DataVolumeOutgoing = 251;
+const uint32_t LocationService = 297;
+const uint32_t TotalTaxRefund = 353;
+const uint32_t TotalDiscountRefund = 354;
+const uint32_t TotalChargeRefund = 355;
+const uint32_t TaxValue = 397;
+const uint32_t TaxableAmount = 398;
+const uint32_t RecEntityId = 400;
+const uint32_t CallingNumber = 405;
+const uint32_t CalledNumber = 407;
+const uint32_t FixedDiscountValue = 411;
+const uint32_t Discount = 412;
+const uint32_t TotalCharge = 415;
+const uint32_t CamelInvocationFee = 422;
+const uint32_t BasicServiceCode = 426;
+const uint32_t ChargeableSubscriber = 427;
+const uint32_t ImeiOrEsn = 429;
+const uint32_t ThreeGcamelDestination = 431;
+const uint32_t MessagingEvent = 433;
+const uint32_t MobileSession = 434;
+const uint32_t MobileSessionService = 435;
+const uint32_t ChargedParty = 436;
+const uint32_t SessionChargeInformation = 440;
+const uint32_t SessionChargeInfoList = 441;
+const uint32_t ServiceStartTimestamp = 447;
+
+// TD.32 RAP 1.5 (ReturnBatch) elements.
+const uint32_t ErrorCode = 515;
+const uint32_t ErrorContext = 516;
+const uint32_t ErrorContextList = 517;
+const uint32_t ErrorDetail = 518;
+const uint32_t ErrorDetailList = 519;
+const uint32_t ItemOccurrence = 524;
+const uint32_t RapFileAvailableTimeStamp = 525;
+const uint32_t RapFileCreationTimeStamp = 526;
+const uint32_t ItemLevel = 529;
+const uint32_t PathItemId = 530;
+const uint32_t ReturnBatch = 534;
+const uint32_t SevereReturn = 535;
+const uint32_t ReturnDetailList = 536;
+const uint32_t RapBatchControlInfo = 537;
+const uint32_t RapAuditControlInfo = 541;
+const uint32_t ReturnDetailsCount = 542;
+const uint32_t RapReleaseVersionNumber = 543;
+const uint32_t RapSpecificationVersionNumber = 544;
+const uint32_t TotalSevereReturnValue = 545;
+
+} // namespace tag
+
+} // namespace tap3
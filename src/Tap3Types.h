@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Arena.h"
+#include "ByteView.h"
+
+namespace tap3 {
+
+// Decoded TAP3 structures. String and octet fields are views into the
+// mapped file; only the small header code tables are copied into vectors,
+// so memory per file does not grow with the number of call events.
+
+struct DateTimeLong
+{
+    ByteView localTimeStamp;      // "YYYYMMDDHHMMSS"
+    ByteView utcTimeOffset;       // "+HHMM"
+};
+
+struct BatchControlInfo
+{
+    ByteView sender;
+    ByteView recipient;
+    ByteView fileSequenceNumber;
+    DateTimeLong fileCreationTimeStamp;
+    DateTimeLong transferCutOffTimeStamp;
+    DateTimeLong fileAvailableTimeStamp;
+    int32_t specificationVersionNumber = 0;
+    int32_t releaseVersionNumber = 0;
+    ByteView fileTypeIndicator;
+    ByteView rapFileSequenceNumber;
+};
+
+// TAP releases the loader decodes. Files are decoded by the release their
+// BatchControlInfo states.
+enum class TapRelease : uint8_t
+{
+    Tap310,
+    Tap311,
+    Tap312
+};
+
+const TapRelease kLatestTapRelease = TapRelease::Tap312;
+
+// Throws Tap3Error for a version the loader has no decoder for.
+TapRelease TapReleaseOf(int32_t specificationVersionNumber, int32_t releaseVersionNumber);
+bool IsSupportedTapRelease(int32_t specificationVersionNumber, int32_t releaseVersionNumber);
+const char* TapReleaseName(TapRelease release);
+
+struct Notification
+{
+    ByteView sender;
+    ByteView recipient;
+    ByteView fileSequenceNumber;
+    ByteView rapFileSequenceNumber;
+    DateTimeLong fileCreationTimeStamp;
+    DateTimeLong fileAvailableTimeStamp;
+    DateTimeLong transferCutOffTimeStamp;
+    int32_t specificationVersionNumber = 0;
+    int32_t releaseVersionNumber = 0;
+    ByteView fileTypeIndicator;
+};
+
+struct Taxation
+{
+    int32_t taxCode = -1;
+    ByteView taxType;
+    ByteView taxRate;
+    ByteView chargeType;
+};
+
+struct Discounting
+{
+    int32_t discountCode = -1;
+    ByteView discountApplied;     // encoded DiscountApplied choice
+};
+
+struct CurrencyConversion
+{
+    int32_t exchangeRateCode = -1;
+    int32_t numberOfDecimalPlaces = 0;
+    int64_t exchangeRate = 0;
+};
+
+struct AccountingInfo
+{
+    std::vector<Taxation> taxation;
+    std::vector<Discounting> discounting;
+    ByteView localCurrency;
+    ByteView tapCurrency;
+    std::vector<CurrencyConversion> currencyConversion;
+    int32_t tapDecimalPlaces = -1;
+};
+
+struct UtcTimeOffsetInfo
+{
+    int32_t utcTimeOffsetCode = -1;
+    ByteView utcTimeOffset;
+};
+
+struct RecEntityInfo
+{
+    int32_t recEntityCode = -1;
+    int32_t recEntityType = -1;
+    ByteView recEntityId;
+};
+
+struct NetworkInfo
+{
+    std::vector<UtcTimeOffsetInfo> utcTimeOffsetInfo;
+    std::vector<RecEntityInfo> recEntityInfo;
+};
+
+struct MessageDescriptionInfo
+{
+    int32_t messageDescriptionCode = -1;
+    ByteView messageDescription;
+};
+
+struct AuditControlInfo
+{
+    DateTimeLong earliestCallTimeStamp;
+    DateTimeLong latestCallTimeStamp;
+    int64_t totalCharge = 0;
+    int64_t totalChargeRefund = 0;
+    int64_t totalTaxRefund = 0;
+    int64_t totalTaxValue = 0;
+    int64_t totalDiscountValue = 0;
+    int64_t totalDiscountRefund = 0;
+    int64_t callEventDetailsCount = 0;
+};
+
+enum class CallEventType : uint8_t
+{
+    MobileOriginatedCall,
+    MobileTerminatedCall,
+    SupplServiceEvent,
+    ServiceCentreUsage,
+    GprsCall,
+    ContentTransaction,
+    LocationService,
+    MessagingEvent,
+    MobileSession,
+    Count
+};
+
+const size_t kCallEventTypeCount = static_cast<size_t>(CallEventType::Count);
+
+const char* CallEventTypeName(CallEventType type);
+
+// Call event values the loader can materialise, in the column order of the
+// default call_event table, followed by the ChargeDetail and TaxInformation
+// row sets.
+enum class EventField : uint8_t
+{
+    LocalTimeStamp,
+    UtcTimeOffsetCode,
+    StartTimeUtc,
+    RecEntityCode,
+    ExchangeRateCode,
+    Duration,
+    Charge,
+    ChargeLocal,
+    ChargeableUnits,
+    TaxValue,
+    DiscountValue,
+    DataVolumeIncoming,
+    DataVolumeOutgoing,
+    Imsi,
+    Msisdn,
+    Imei,
+    OtherParty,
+    ChargeDetail,
+    TaxInformation,
+    Count
+};
+
+const size_t kEventFieldCount = static_cast<size_t>(EventField::Count);
+
+// Set of EventField bits.
+typedef uint32_t FieldSet;
+
+inline FieldSet FieldBit(EventField field) { return 1u << static_cast<unsigned>(field); }
+
+const FieldSet kAllFields = (1u << kEventFieldCount) - 1;
+
+struct ChargeDetail
+{
+    ByteView chargeType;
+    int64_t charge = 0;
+    int64_t chargeLocal = 0;      // in local currency, 0 if the exchange rate is unknown or it overflows
+    int64_t chargeableUnits = 0;
+    int64_t chargedUnits = 0;
+};
+
+struct TaxInformation
+{
+    int32_t taxCode = -1;
+    int64_t taxValue = 0;
+    int64_t taxableAmount = 0;
+};
+
+// Lists inside charge structures are allocated from the decoding thread's
+// arena and are valid until the arena is reset.
+struct ChargeInformation
+{
+    explicit ChargeInformation(Arena& arena)
+        : details(ArenaAllocator<ChargeDetail>(arena)), taxes(ArenaAllocator<TaxInformation>(arena)) {}
+
+    ByteView chargedItem;
+    int32_t exchangeRateCode = -1;
+    int32_t discountCode = -1;
+    int64_t discount = 0;
+    ArenaVector<ChargeDetail> details;
+    ArenaVector<TaxInformation> taxes;
+};
+
+// Charge part of CamelServiceUsed. Decoded with every event, as it counts
+// towards the event and AuditControlInfo totals.
+struct CamelCharge
+{
+    explicit CamelCharge(Arena& arena) : taxes(ArenaAllocator<TaxInformation>(arena)) {}
+
+    int32_t exchangeRateCode = -1;
+    int64_t camelInvocationFee = 0;
+    ArenaVector<TaxInformation> taxes;
+};
+
+// Rarely used sub-structures of a call event. The decoder only locates
+// them (see BlockRef); they are decoded on request by the matching
+// TapDecoder::Decode* function.
+
+// CamelServiceUsed without its charge part.
+struct CamelServiceUsed
+{
+    int32_t camelServiceLevel = -1;
+    int64_t camelServiceKey = -1;
+    int32_t defaultCallHandling = -1;
+    ByteView threeGcamelDestination;  // encoded ThreeGcamelDestination choice
+};
+
+// SupplServiceUsed without its ChargeInformation, which is decoded with the
+// event.
+struct SupplServiceUsed
+{
+    ByteView supplServiceCode;
+    int32_t supplServiceActionCode = -1;
+    ByteView ssParameters;
+    ByteView chargingTimeStamp;       // LocalTimeStamp
+};
+
+// Encoded sub-structure of a call event, located relative to the start of
+// the record; length is 0 when the record does not have it.
+struct BlockRef
+{
+    uint32_t offset = 0;
+    uint32_t length = 0;
+
+    bool Empty() const { return length == 0; }
+};
+
+enum CodeError : uint32_t
+{
+    kUnknownUtcTimeOffsetCode = 1 << 0,
+    kUnknownRecEntityCode = 1 << 1,
+    kUnknownExchangeRateCode = 1 << 2,
+    kUnknownTaxCode = 1 << 3,
+    kUnknownDiscountCode = 1 << 4,
+    kMissingLocalTimeStamp = 1 << 5,       // of the event start
+    kBadLocalTimeStamp = 1 << 6,
+    kLocalChargeOverflow = 1 << 7           // charge times exchange rate out of the int64 range
+};
+
+// Severe (record level) error found while decoding, kept to a few words
+// per record so files with many bad records stay cheap. The record itself
+// is copied from the mapped file when the RAP file is written.
+struct RecordError
+{
+    uint64_t recordOffset;
+    int64_t charge;
+    uint32_t recordLength;
+    uint32_t codeErrors;          // CodeError bits
+};
+
+// One CallEventDetail. Scalar fields are flattened to what the loader
+// needs: charges, taxes and discounts are summed over the whole record,
+// Charge only over ChargeType "00" (total charge) details. The full charge
+// structure is kept in charges/camel, allocated from arena. CamelServiceUsed,
+// SupplServiceUsedList and OperatorSpecInfoList are skipped apart from
+// their charges and only located.
+struct CallEvent
+{
+    explicit CallEvent(Arena& a)
+        : arena(&a), charges(ArenaAllocator<ChargeInformation>(a)) {}
+
+    Arena* arena;
+    CallEventType type = CallEventType::MobileOriginatedCall;
+    ByteView record;              // whole encoded CallEventDetail
+    size_t recordOffset = 0;      // offset of the record in the file
+    ByteView imsi;                // TBCD
+    ByteView msisdn;              // BCD
+    ByteView imei;                // BCD
+    ByteView otherParty;          // CalledNumber (MOC) or CallingNumber (MTC), BCD
+    ByteView startTimeStamp;      // LocalTimeStamp of the event start
+    int32_t utcTimeOffsetCode = -1;
+    int64_t startTimeUtc = 0;     // epoch seconds, 0 if the offset code is unknown
+    int32_t recEntityCode = -1;
+    int32_t exchangeRateCode = -1;
+    int64_t duration = 0;
+    int64_t charge = 0;
+    int64_t chargeLocal = 0;
+    int64_t chargeableUnits = 0;
+    int64_t taxValue = 0;
+    int64_t discountValue = 0;
+    int64_t dataVolumeIncoming = 0;
+    int64_t dataVolumeOutgoing = 0;
+    uint32_t chargeDetailCount = 0;
+    uint32_t codeErrors = 0;      // CodeError bits for references missing from the code tables
+    ArenaVector<ChargeInformation> charges;
+    CamelCharge* camel = nullptr;
+    BlockRef camelServiceUsed;
+    BlockRef supplServiceUsedList;
+    BlockRef operatorSpecInfoList;
+
+    // Resets all fields. Lists are re-created empty rather than cleared, as
+    // their old storage may have been rewound by Arena::Reset().
+    void Clear() { *this = CallEvent(*arena); }
+};
+
+} // namespace tap3
@@ -0,0 +1,940 @@
+#include "TapDecoder.h"
+
+#include "ParallelCallEventDecoder.h"
+#include "Tap3Error.h"
+#include "Tap3Tags.h"
+#include "TimeStamp.h"
+
+namespace tap3 {
+
+const char* CallEventTypeName(CallEventType type)
+{
+    switch (type) {
+    case CallEventType::MobileOriginatedCall: return "MOC";
+    case CallEventType::MobileTerminatedCall: return "MTC";
+    case CallEventType::SupplServiceEvent: return "SS";
+    case CallEventType::ServiceCentreUsage: return "SCU";
+    case CallEventType::GprsCall: return "GPRS";
+    case CallEventType::ContentTransaction: return "CONTENT";
+    case CallEventType::LocationService: return "LCS";
+    case CallEventType::MessagingEvent: return "MESSAGING";
+    case CallEventType::MobileSession: return "SESSION";
+    default: return "UNKNOWN";
+    }
+}
+
+TapRelease TapReleaseOf(int32_t specificationVersionNumber, int32_t releaseVersionNumber)
+{
+    if (specificationVersionNumber == 3) {
+        switch (releaseVersionNumber) {
+        case 10: return TapRelease::Tap310;
+        case 11: return TapRelease::Tap311;
+        case 12: return TapRelease::Tap312;
+        }
+    }
+    throw Tap3Error("Unsupported TAP release " + std::to_string(specificationVersionNumber) + "."
+        + std::to_string(releaseVersionNumber));
+}
+
+bool IsSupportedTapRelease(int32_t specificationVersionNumber, int32_t releaseVersionNumber)
+{
+    return specificationVersionNumber == 3 && releaseVersionNumber >= 10 && releaseVersionNumber <= 12;
+}
+
+const char* TapReleaseName(TapRelease release)
+{
+    switch (release) {
+    case TapRelease::Tap310: return "3.10";
+    case TapRelease::Tap311: return "3.11";
+    case TapRelease::Tap312: return "3.12";
+    default: return "UNKNOWN";
+    }
+}
+
+namespace {
+
+int32_t DecodeCode(const BerTlv& tlv)
+{
+    return static_cast<int32_t>(BerDecodeInteger(tlv.value));
+}
+
+void DecodeDateTimeLong(const BerReader& parent, const BerTlv& tlv, DateTimeLong& dt)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        if (child.IsApplication(tag::LocalTimeStamp)) {
+            dt.localTimeStamp = child.value;
+        }
+        else if (child.IsApplication(tag::UtcTimeOffset)) {
+            dt.utcTimeOffset = child.value;
+        }
+    }
+}
+
+// DateTime: LocalTimeStamp plus UtcTimeOffsetCode referencing NetworkInfo.
+void DecodeDateTime(const BerReader& parent, const BerTlv& tlv, ByteView& localTimeStamp, int32_t& utcTimeOffsetCode)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        if (child.IsApplication(tag::LocalTimeStamp)) {
+            localTimeStamp = child.value;
+        }
+        else if (child.IsApplication(tag::UtcTimeOffsetCode)) {
+            utcTimeOffsetCode = DecodeCode(child);
+        }
+    }
+}
+
+void DecodeChargeDetail(const BerReader& parent, const BerTlv& tlv, ChargeDetail& detail)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        switch (child.Tag()) {
+        case tag::ChargeType: detail.chargeType = child.value; break;
+        case tag::Charge: detail.charge = BerDecodeInteger(child.value); break;
+        case tag::ChargeableUnits: detail.chargeableUnits = BerDecodeInteger(child.value); break;
+        case tag::ChargedUnits: detail.chargedUnits = BerDecodeInteger(child.value); break;
+        }
+    }
+}
+
+void DecodeTaxInformationList(const BerReader& parent, const BerTlv& tlv, ArenaVector<TaxInformation>& taxes,
+    CallEvent& event)
+{
+    BerReader list = parent.Enter(tlv);
+    BerTlv item;
+    while (list.Next(item)) {
+        TaxInformation tax;
+        BerReader fields = list.Enter(item);
+        BerTlv field;
+        while (fields.Next(field)) {
+            switch (field.Tag()) {
+            case tag::TaxCode: tax.taxCode = DecodeCode(field); break;
+            case tag::TaxValue: tax.taxValue = BerDecodeInteger(field.value); break;
+            case tag::TaxableAmount: tax.taxableAmount = BerDecodeInteger(field.value); break;
+            }
+        }
+        event.taxValue += tax.taxValue;
+        taxes.push_back(tax);
+    }
+}
+
+void DecodeDiscountInformation(const BerReader& parent, const BerTlv& tlv, int32_t& code, int64_t& discount)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        if (child.IsApplication(tag::DiscountCode)) {
+            code = DecodeCode(child);
+        }
+        else if (child.IsApplication(tag::Discount)) {
+            discount = BerDecodeInteger(child.value);
+        }
+    }
+}
+
+// ChargeInformation and SessionChargeInformation share the fields we need.
+void DecodeChargeInformation(const BerReader& parent, const BerTlv& tlv, CallEvent& event,
+    const CodeTables& tables)
+{
+    ChargeInformation info(*event.arena);
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        switch (child.Tag()) {
+        case tag::ChargedItem:
+            info.chargedItem = child.value;
+            break;
+        case tag::ExchangeRateCode:
+            info.exchangeRateCode = DecodeCode(child);
+            if (event.exchangeRateCode < 0) {
+                event.exchangeRateCode = info.exchangeRateCode;
+            }
+            break;
+        case tag::ChargeDetailList: {
+            BerReader list = reader.Enter(child);
+            BerTlv item;
+            while (list.Next(item)) {
+                ChargeDetail detail;
+                DecodeChargeDetail(list, item, detail);
+                event.chargeDetailCount++;
+                if (detail.chargeType.AsString() == "00") {
+                    event.charge += detail.charge;
+                    if (event.chargeableUnits == 0) {
+                        event.chargeableUnits = detail.chargeableUnits;
+                    }
+                }
+                info.details.push_back(detail);
+            }
+            break;
+        }
+        case tag::TaxInformationList:
+            DecodeTaxInformationList(reader, child, info.taxes, event);
+            break;
+        case tag::DiscountInformation:
+            DecodeDiscountInformation(reader, child, info.discountCode, info.discount);
+            event.discountValue += info.discount;
+            break;
+        }
+    }
+    // Code references are resolved once the whole element has been read,
+    // as the exchange rate code may follow the charge details.
+    if (info.exchangeRateCode >= 0) {
+        if (const ExchangeRate* rate = tables.Exchange(info.exchangeRateCode)) {
+            for (ChargeDetail& detail : info.details) {
+                if (!CodeTables::ToLocalCurrency(detail.charge, *rate, detail.chargeLocal)) {
+                    event.codeErrors |= kLocalChargeOverflow;
+                }
+                else if (detail.chargeType.AsString() == "00") {
+                    event.chargeLocal += detail.chargeLocal;
+                }
+            }
+        }
+        else {
+            event.codeErrors |= kUnknownExchangeRateCode;
+        }
+    }
+    for (const TaxInformation& tax : info.taxes) {
+        if (!tables.Tax(tax.taxCode)) {
+            event.codeErrors |= kUnknownTaxCode;
+        }
+    }
+    if (info.discountCode >= 0 && !tables.Discount(info.discountCode)) {
+        event.codeErrors |= kUnknownDiscountCode;
+    }
+    event.charges.push_back(std::move(info));
+}
+
+// Only the charge part of CamelServiceUsed; the other fields are left to
+// TapDecoder::DecodeCamelServiceUsed.
+void DecodeCamelCharge(const BerReader& parent, const BerTlv& tlv, CallEvent& event, const CodeTables& tables)
+{
+    CamelCharge* camel = event.arena->New<CamelCharge>(*event.arena);
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        switch (child.Tag()) {
+        case tag::ExchangeRateCode: camel->exchangeRateCode = DecodeCode(child); break;
+        case tag::TaxInformationList: DecodeTaxInformationList(reader, child, camel->taxes, event); break;
+        case tag::DiscountInformation: {
+            int32_t code = -1;
+            int64_t discount = 0;
+            DecodeDiscountInformation(reader, child, code, discount);
+            event.discountValue += discount;
+            break;
+        }
+        case tag::CamelInvocationFee:
+            camel->camelInvocationFee = BerDecodeInteger(child.value);
+            event.charge += camel->camelInvocationFee;
+            break;
+        }
+    }
+    if (camel->camelInvocationFee != 0) {
+        if (const ExchangeRate* rate = tables.Exchange(camel->exchangeRateCode)) {
+            int64_t local;
+            if (CodeTables::ToLocalCurrency(camel->camelInvocationFee, *rate, local)) {
+                event.chargeLocal += local;
+            }
+            else {
+                event.codeErrors |= kLocalChargeOverflow;
+            }
+        }
+        else {
+            event.codeErrors |= kUnknownExchangeRateCode;
+        }
+    }
+    event.camel = camel;
+}
+
+// Only the ChargeInformation of every SupplServiceUsed.
+void DecodeSupplServiceCharges(const BerReader& parent, const BerTlv& tlv, CallEvent& event,
+    const CodeTables& tables)
+{
+    BerReader list = parent.Enter(tlv);
+    BerTlv item;
+    while (list.Next(item)) {
+        if (!item.Constructed()) {
+            continue;
+        }
+        BerReader fields = list.Enter(item);
+        BerTlv field;
+        while (fields.Next(field)) {
+            if (field.IsApplication(tag::ChargeInformation)) {
+                DecodeChargeInformation(fields, field, event, tables);
+            }
+        }
+    }
+}
+
+BlockRef Locate(const CallEvent& event, const BerTlv& tlv)
+{
+    BlockRef ref;
+    ref.offset = static_cast<uint32_t>(tlv.value.data - tlv.header.headerLength - event.record.data);
+    ref.length = static_cast<uint32_t>(tlv.totalLength);
+    return ref;
+}
+
+// Call event elements the loader reads, by what it does with them.
+enum class Element : uint8_t
+{
+    Other,                  // descended into when constructed, ignored otherwise
+    Skip,                   // constructed, but holds nothing the loader reads
+    Imsi,
+    Msisdn,
+    Imei,
+    OtherParty,
+    StartTimeStamp,
+    Duration,
+    RecEntityCode,
+    ChargeInformation,
+    CamelServiceUsed,
+    SupplServiceUsedList,
+    OperatorSpecInfoList,
+    DataVolumeIncoming,
+    DataVolumeOutgoing
+};
+
+// Above every APPLICATION tag the loader reads inside call events.
+const uint32_t kElementTableSize = 512;
+
+struct ElementTable
+{
+    Element elements[kElementTableSize];
+
+    constexpr Element Of(uint32_t tagNumber) const
+    {
+        return tagNumber < kElementTableSize ? elements[tagNumber] : Element::Other;
+    }
+};
+
+// Release traits. The elements the loader reads are the same in 3.10 and
+// 3.11, so both are decoded by the Tap311 instantiation; 3.12 adds
+// MobileSession and MessagingEvent with their own start time stamp and
+// charge information elements.
+struct Tap311
+{
+    static const bool kSessions = false;
+};
+
+struct Tap312
+{
+    static const bool kSessions = true;
+};
+
+template <typename Release>
+constexpr ElementTable BuildElementTable()
+{
+    ElementTable table{};
+    table.elements[tag::Imsi] = Element::Imsi;
+    table.elements[tag::Msisdn] = Element::Msisdn;
+    table.elements[tag::Imei] = Element::Imei;
+    table.elements[tag::CalledNumber] = Element::OtherParty;
+    table.elements[tag::CallingNumber] = Element::OtherParty;
+    table.elements[tag::CallEventStartTimeStamp] = Element::StartTimeStamp;
+    table.elements[tag::TotalCallEventDuration] = Element::Duration;
+    table.elements[tag::RecEntityCode] = Element::RecEntityCode;
+    table.elements[tag::ChargeInformation] = Element::ChargeInformation;
+    table.elements[tag::CamelServiceUsed] = Element::CamelServiceUsed;
+    table.elements[tag::SupplServiceUsedList] = Element::SupplServiceUsedList;
+    table.elements[tag::OperatorSpecInfoList] = Element::OperatorSpecInfoList;
+    table.elements[tag::DataVolumeIncoming] = Element::DataVolumeIncoming;
+    table.elements[tag::DataVolumeOutgoing] = Element::DataVolumeOutgoing;
+    table.elements[tag::BasicService] = Element::Skip;
+    if (Release::kSessions) {
+        table.elements[tag::ServiceStartTimestamp] = Element::StartTimeStamp;
+        table.elements[tag::SessionChargeInformation] = Element::ChargeInformation;
+    }
+    return table;
+}
+
+template <typename Release>
+struct Elements
+{
+    static constexpr ElementTable kTable = BuildElementTable<Release>();
+};
+
+// Walks the contents of a call event record. Record layouts differ between
+// event types but the leaf elements the loader needs have unique tags, so a
+// single recursive walk serves every type. Each release gets its own
+// instantiation, dispatching on a table fixed at compile time. Number,
+// duration and data volume elements not in fields are passed over by their
+// length and left empty or zero; charges, taxes, discounts and the start
+// time are always decoded, as the AuditControlInfo check needs them.
+template <typename Release>
+void WalkCallEvent(const BerReader& parent, const BerTlv& tlv, CallEvent& event, const CodeTables& tables,
+    FieldSet fields, int depth)
+{
+    if (depth > 16) {
+        throw BerError("Call event nesting too deep", parent.BaseOffset() + tlv.offset);
+    }
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        if (child.header.tagClass != BerClass::Application) {
+            continue;
+        }
+        switch (Elements<Release>::kTable.Of(child.Tag())) {
+        case Element::Imsi:
+            if (fields & FieldBit(EventField::Imsi)) {
+                event.imsi = child.value;
+            }
+            break;
+        case Element::Msisdn:
+            if (fields & FieldBit(EventField::Msisdn)) {
+                event.msisdn = child.value;
+            }
+            break;
+        case Element::Imei:
+            if (fields & FieldBit(EventField::Imei)) {
+                event.imei = child.value;
+            }
+            break;
+        case Element::OtherParty:
+            if (fields & FieldBit(EventField::OtherParty)) {
+                event.otherParty = child.value;
+            }
+            break;
+        case Element::StartTimeStamp:
+            DecodeDateTime(reader, child, event.startTimeStamp, event.utcTimeOffsetCode);
+            break;
+        case Element::Duration:
+            if (fields & FieldBit(EventField::Duration)) {
+                event.duration = BerDecodeInteger(child.value);
+            }
+            break;
+        case Element::RecEntityCode:
+            if (event.recEntityCode < 0) {
+                event.recEntityCode = DecodeCode(child);
+            }
+            break;
+        case Element::ChargeInformation:
+            DecodeChargeInformation(reader, child, event, tables);
+            break;
+        case Element::CamelServiceUsed:
+            event.camelServiceUsed = Locate(event, child);
+            DecodeCamelCharge(reader, child, event, tables);
+            break;
+        case Element::SupplServiceUsedList:
+            event.supplServiceUsedList = Locate(event, child);
+            DecodeSupplServiceCharges(reader, child, event, tables);
+            break;
+        case Element::OperatorSpecInfoList:
+            // free text for the partner, nothing the loader needs
+            event.operatorSpecInfoList = Locate(event, child);
+            break;
+        case Element::DataVolumeIncoming:
+            if (fields & FieldBit(EventField::DataVolumeIncoming)) {
+                event.dataVolumeIncoming += BerDecodeInteger(child.value);
+            }
+            break;
+        case Element::DataVolumeOutgoing:
+            if (fields & FieldBit(EventField::DataVolumeOutgoing)) {
+                event.dataVolumeOutgoing += BerDecodeInteger(child.value);
+            }
+            break;
+        case Element::Skip:
+            break;
+        case Element::Other:
+            if (child.Constructed()) {
+                WalkCallEvent<Release>(reader, child, event, tables, fields, depth + 1);
+            }
+            break;
+        }
+    }
+}
+
+template <typename Release>
+bool CallEventTypeFromTag(uint32_t tagNumber, CallEventType& type)
+{
+    switch (tagNumber) {
+    case tag::MobileOriginatedCall: type = CallEventType::MobileOriginatedCall; return true;
+    case tag::MobileTerminatedCall: type = CallEventType::MobileTerminatedCall; return true;
+    case tag::SupplServiceEvent: type = CallEventType::SupplServiceEvent; return true;
+    case tag::ServiceCentreUsage: type = CallEventType::ServiceCentreUsage; return true;
+    case tag::GprsCall: type = CallEventType::GprsCall; return true;
+    case tag::ContentTransaction: type = CallEventType::ContentTransaction; return true;
+    case tag::LocationService: type = CallEventType::LocationService; return true;
+    case tag::MessagingEvent: type = CallEventType::MessagingEvent; return Release::kSessions;
+    case tag::MobileSession: type = CallEventType::MobileSession; return Release::kSessions;
+    default: return false;
+    }
+}
+
+template <typename Release>
+bool DecodeReleaseCallEvent(const BerReader& parent, const BerTlv& tlv, CallEvent& event,
+    const CodeTables& tables, const FieldSelection& fields)
+{
+    event.Clear();
+    if (tlv.header.tagClass != BerClass::Application || !tlv.Constructed()
+        || !CallEventTypeFromTag<Release>(tlv.Tag(), event.type)) {
+        return false;
+    }
+    event.recordOffset = parent.BaseOffset() + tlv.offset;
+    event.record = ByteView(tlv.value.data - tlv.header.headerLength, tlv.totalLength);
+    WalkCallEvent<Release>(parent, tlv, event, tables, fields[static_cast<size_t>(event.type)], 0);
+    event.startTimeUtc = tables.ToUtc(event.startTimeStamp, event.utcTimeOffsetCode);
+    if (event.startTimeUtc == 0) {
+        int64_t local;
+        if (event.startTimeStamp.size == 0) {
+            event.codeErrors |= kMissingLocalTimeStamp;
+        }
+        else if (!ParseLocalTimeStamp(event.startTimeStamp, local)) {
+            event.codeErrors |= kBadLocalTimeStamp;
+        }
+        if (!tables.UtcOffset(event.utcTimeOffsetCode)) {
+            event.codeErrors |= kUnknownUtcTimeOffsetCode;
+        }
+    }
+    if (event.recEntityCode >= 0 && !tables.RecEntity(event.recEntityCode)) {
+        event.codeErrors |= kUnknownRecEntityCode;
+    }
+    return true;
+}
+
+} // namespace
+
+TapDecoder::TapDecoder(size_t threadCount, size_t batchSize)
+    : m_batchSize(batchSize > 0 ? batchSize : 1), m_validateAudit(true), m_auditSeen(false),
+      m_release(kLatestTapRelease), m_position(0), m_resumeOffset(0)
+{
+    if (threadCount > 1) {
+        m_parallel.reset(new ParallelCallEventDecoder(threadCount, m_batchSize));
+    }
+}
+
+TapDecoder::~TapDecoder()
+{
+}
+
+void TapDecoder::SetFields(const FieldSelection& fields)
+{
+    m_batch.SetFields(fields);
+    if (m_parallel) {
+        m_parallel->SetFields(fields);
+    }
+}
+
+void TapDecoder::ReleaseArenas()
+{
+    m_arena.Release();
+    if (m_parallel) {
+        m_parallel->ReleaseArenas();
+    }
+}
+
+void TapDecoder::Decode(ByteView file, TapHandler& handler)
+{
+    m_file = file;
+    m_tables.Clear();
+    m_audit.Clear();
+    m_recordErrors.clear();
+    m_auditSeen = false;
+    m_release = kLatestTapRelease;
+    m_position = 0;
+    m_resumeOffset = 0;
+    BerReader reader(file);
+    BerTlv tlv;
+    if (!reader.Next(tlv)) {
+        throw Tap3Error("Empty TAP file");
+    }
+    if (tlv.IsApplication(tag::TransferBatch) && tlv.Constructed()) {
+        DecodeTransferBatch(reader, tlv, handler);
+        if (m_validateAudit && !m_auditSeen) {
+            throw AuditError("AuditControlInfo missing");
+        }
+    }
+    else if (tlv.IsApplication(tag::Notification) && tlv.Constructed()) {
+        Notification notification;
+        DecodeNotification(reader, tlv, notification);
+        handler.OnNotification(notification);
+    }
+    else {
+        throw Tap3Error("File is neither TransferBatch nor Notification (tag "
+            + std::to_string(tlv.Tag()) + ")");
+    }
+}
+
+void TapDecoder::ResumeAt(uint64_t byteOffset, const AuditAccumulator& audit,
+    const std::vector<RecordError>& recordErrors)
+{
+    m_resumeOffset = byteOffset;
+    m_position = byteOffset;
+    m_audit = audit;
+    m_recordErrors = recordErrors;
+}
+
+void TapDecoder::DecodeTransferBatch(const BerReader& parent, const BerTlv& tlv, TapHandler& handler)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv block;
+    while (reader.Next(block)) {
+        switch (block.Tag()) {
+        case tag::BatchControlInfo: {
+            BatchControlInfo info;
+            DecodeBatchControlInfo(reader, block, info);
+            m_release = TapReleaseOf(info.specificationVersionNumber, info.releaseVersionNumber);
+            handler.OnBatchControlInfo(info);
+            break;
+        }
+        case tag::AccountingInfo: {
+            AccountingInfo info;
+            DecodeAccountingInfo(reader, block, info);
+            m_tables.Build(info);
+            handler.OnAccountingInfo(info);
+            break;
+        }
+        case tag::NetworkInfo: {
+            NetworkInfo info;
+            DecodeNetworkInfo(reader, block, info);
+            m_tables.Build(info);
+            handler.OnNetworkInfo(info);
+            break;
+        }
+        case tag::MessageDescriptionInfoList: {
+            std::vector<MessageDescriptionInfo> info;
+            DecodeMessageDescriptionInfo(reader, block, info);
+            m_tables.Build(info);
+            handler.OnMessageDescriptionInfo(info);
+            break;
+        }
+        case tag::CallEventDetailList: {
+            size_t listOffset = reader.BaseOffset() + block.offset + block.header.headerLength;
+            ByteView list = block.value;
+            if (m_resumeOffset != 0) {
+                if (m_resumeOffset < listOffset || m_resumeOffset > listOffset + list.size) {
+                    throw Tap3Error("Resume offset " + std::to_string(m_resumeOffset)
+                        + " is outside CallEventDetailList");
+                }
+                list = list.Sub(m_resumeOffset - listOffset, listOffset + list.size - m_resumeOffset);
+                listOffset = m_resumeOffset;
+            }
+            if (m_parallel) {
+                m_parallel->Decode(m_file, list, listOffset, m_release, m_tables, m_audit, m_recordErrors,
+                    m_position, handler);
+                break;
+            }
+            CallEventDecoder decode = CallEventDecoderFor(m_release);
+            BerReader records(list, listOffset);
+            BerTlv record;
+            CallEvent event(m_arena);
+            m_batch.Clear();
+            m_batch.SetSource(m_file);
+            m_arena.Reset();
+            while (records.Next(record)) {
+                m_audit.AddRecords(1);
+                m_position = records.BaseOffset() + record.offset + record.totalLength;
+                if (decode(records, record, event, m_tables, m_batch.Selection())) {
+                    CollectRecordError(event, m_recordErrors);
+                    m_batch.Append(event);
+                    if (m_batch.Size() >= m_batchSize) {
+                        m_audit.Add(m_batch);
+                        handler.OnEventBatch(m_batch);
+                        m_batch.Clear();
+                        m_arena.Reset();
+                    }
+                }
+            }
+            if (m_batch.Size() > 0) {
+                m_audit.Add(m_batch);
+                handler.OnEventBatch(m_batch);
+                m_batch.Clear();
+            }
+            break;
+        }
+        case tag::AuditControlInfo: {
+            AuditControlInfo info;
+            DecodeAuditControlInfo(reader, block, info);
+            handler.OnAuditControlInfo(info);
+            m_auditSeen = true;
+            if (m_validateAudit) {
+                std::string report = m_audit.Compare(info);
+                if (!report.empty()) {
+                    throw AuditError("AuditControlInfo mismatch: " + report);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+void TapDecoder::DecodeBatchControlInfo(const BerReader& parent, const BerTlv& tlv, BatchControlInfo& info)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        switch (child.Tag()) {
+        case tag::Sender: info.sender = child.value; break;
+        case tag::Recipient: info.recipient = child.value; break;
+        case tag::FileSequenceNumber: info.fileSequenceNumber = child.value; break;
+        case tag::FileCreationTimeStamp: DecodeDateTimeLong(reader, child, info.fileCreationTimeStamp); break;
+        case tag::TransferCutOffTimeStamp: DecodeDateTimeLong(reader, child, info.transferCutOffTimeStamp); break;
+        case tag::FileAvailableTimeStamp: DecodeDateTimeLong(reader, child, info.fileAvailableTimeStamp); break;
+        case tag::SpecificationVersionNumber: info.specificationVersionNumber = DecodeCode(child); break;
+        case tag::ReleaseVersionNumber: info.releaseVersionNumber = DecodeCode(child); break;
+        case tag::FileTypeIndicator: info.fileTypeIndicator = child.value; break;
+        case tag::RapFileSequenceNumber: info.rapFileSequenceNumber = child.value; break;
+        }
+    }
+}
+
+void TapDecoder::DecodeNotification(const BerReader& parent, const BerTlv& tlv, Notification& info)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        switch (child.Tag()) {
+        case tag::Sender: info.sender = child.value; break;
+        case tag::Recipient: info.recipient = child.value; break;
+        case tag::FileSequenceNumber: info.fileSequenceNumber = child.value; break;
+        case tag::RapFileSequenceNumber: info.rapFileSequenceNumber = child.value; break;
+        case tag::FileCreationTimeStamp: DecodeDateTimeLong(reader, child, info.fileCreationTimeStamp); break;
+        case tag::FileAvailableTimeStamp: DecodeDateTimeLong(reader, child, info.fileAvailableTimeStamp); break;
+        case tag::TransferCutOffTimeStamp: DecodeDateTimeLong(reader, child, info.transferCutOffTimeStamp); break;
+        case tag::SpecificationVersionNumber: info.specificationVersionNumber = DecodeCode(child); break;
+        case tag::ReleaseVersionNumber: info.releaseVersionNumber = DecodeCode(child); break;
+        case tag::FileTypeIndicator: info.fileTypeIndicator = child.value; break;
+        }
+    }
+}
+
+void TapDecoder::DecodeAccountingInfo(const BerReader& parent, const BerTlv& tlv, AccountingInfo& info)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        switch (child.Tag()) {
+        case tag::TaxationList: {
+            BerReader list = reader.Enter(child);
+            BerTlv item;
+            while (list.Next(item)) {
+                Taxation taxation;
+                BerReader fields = list.Enter(item);
+                BerTlv field;
+                while (fields.Next(field)) {
+                    switch (field.Tag()) {
+                    case tag::TaxCode: taxation.taxCode = DecodeCode(field); break;
+                    case tag::TaxType: taxation.taxType = field.value; break;
+                    case tag::TaxRate: taxation.taxRate = field.value; break;
+                    case tag::ChargeType: taxation.chargeType = field.value; break;
+                    }
+                }
+                info.taxation.push_back(taxation);
+            }
+            break;
+        }
+        case tag::DiscountingList: {
+            BerReader list = reader.Enter(child);
+            BerTlv item;
+            while (list.Next(item)) {
+                Discounting discounting;
+                BerReader fields = list.Enter(item);
+                BerTlv field;
+                while (fields.Next(field)) {
+                    if (field.IsApplication(tag::DiscountCode)) {
+                        discounting.discountCode = DecodeCode(field);
+                    }
+                    else {
+                        discounting.discountApplied = field.value;
+                    }
+                }
+                info.discounting.push_back(discounting);
+            }
+            break;
+        }
+        case tag::LocalCurrency: info.localCurrency = child.value; break;
+        case tag::TapCurrency: info.tapCurrency = child.value; break;
+        case tag::CurrencyConversionList: {
+            BerReader list = reader.Enter(child);
+            BerTlv item;
+            while (list.Next(item)) {
+                CurrencyConversion conversion;
+                BerReader fields = list.Enter(item);
+                BerTlv field;
+                while (fields.Next(field)) {
+                    switch (field.Tag()) {
+                    case tag::ExchangeRateCode: conversion.exchangeRateCode = DecodeCode(field); break;
+                    case tag::NumberOfDecimalPlaces: conversion.numberOfDecimalPlaces = DecodeCode(field); break;
+                    case tag::ExchangeRate: conversion.exchangeRate = BerDecodeInteger(field.value); break;
+                    }
+                }
+                info.currencyConversion.push_back(conversion);
+            }
+            break;
+        }
+        case tag::TapDecimalPlaces: info.tapDecimalPlaces = DecodeCode(child); break;
+        }
+    }
+}
+
+void TapDecoder::DecodeNetworkInfo(const BerReader& parent, const BerTlv& tlv, NetworkInfo& info)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        if (child.IsApplication(tag::UtcTimeOffsetInfoList)) {
+            BerReader list = reader.Enter(child);
+            BerTlv item;
+            while (list.Next(item)) {
+                UtcTimeOffsetInfo offset;
+                BerReader fields = list.Enter(item);
+                BerTlv field;
+                while (fields.Next(field)) {
+                    if (field.IsApplication(tag::UtcTimeOffsetCode)) {
+                        offset.utcTimeOffsetCode = DecodeCode(field);
+                    }
+                    else if (field.IsApplication(tag::UtcTimeOffset)) {
+                        offset.utcTimeOffset = field.value;
+                    }
+                }
+                info.utcTimeOffsetInfo.push_back(offset);
+            }
+        }
+        else if (child.IsApplication(tag::RecEntityInfoList)) {
+            BerReader list = reader.Enter(child);
+            BerTlv item;
+            while (list.Next(item)) {
+                RecEntityInfo entity;
+                BerReader fields = list.Enter(item);
+                BerTlv field;
+                while (fields.Next(field)) {
+                    switch (field.Tag()) {
+                    case tag::RecEntityCode: entity.recEntityCode = DecodeCode(field); break;
+                    case tag::RecEntityType: entity.recEntityType = DecodeCode(field); break;
+                    case tag::RecEntityId: entity.recEntityId = field.value; break;
+                    }
+                }
+                info.recEntityInfo.push_back(entity);
+            }
+        }
+    }
+}
+
+void TapDecoder::DecodeMessageDescriptionInfo(const BerReader& parent, const BerTlv& tlv,
+    std::vector<MessageDescriptionInfo>& info)
+{
+    BerReader list = parent.Enter(tlv);
+    BerTlv item;
+    while (list.Next(item)) {
+        MessageDescriptionInfo description;
+        BerReader fields = list.Enter(item);
+        BerTlv field;
+        while (fields.Next(field)) {
+            if (field.IsApplication(tag::MessageDescriptionCode)) {
+                description.messageDescriptionCode = DecodeCode(field);
+            }
+            else if (field.IsApplication(tag::MessageDescription)) {
+                description.messageDescription = field.value;
+            }
+        }
+        info.push_back(description);
+    }
+}
+
+void TapDecoder::DecodeAuditControlInfo(const BerReader& parent, const BerTlv& tlv, AuditControlInfo& info)
+{
+    BerReader reader = parent.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        switch (child.Tag()) {
+        case tag::EarliestCallTimeStamp: DecodeDateTimeLong(reader, child, info.earliestCallTimeStamp); break;
+        case tag::LatestCallTimeStamp: DecodeDateTimeLong(reader, child, info.latestCallTimeStamp); break;
+        case tag::TotalCharge: info.totalCharge = BerDecodeInteger(child.value); break;
+        case tag::TotalChargeRefund: info.totalChargeRefund = BerDecodeInteger(child.value); break;
+        case tag::TotalTaxRefund: info.totalTaxRefund = BerDecodeInteger(child.value); break;
+        case tag::TotalTaxValue: info.totalTaxValue = BerDecodeInteger(child.value); break;
+        case tag::TotalDiscountValue: info.totalDiscountValue = BerDecodeInteger(child.value); break;
+        case tag::TotalDiscountRefund: info.totalDiscountRefund = BerDecodeInteger(child.value); break;
+        case tag::CallEventDetailsCount: info.callEventDetailsCount = BerDecodeInteger(child.value); break;
+        }
+    }
+}
+
+void TapDecoder::DecodeCamelServiceUsed(ByteView encoded, size_t offset, CamelServiceUsed& camel)
+{
+    BerReader outer(encoded, offset);
+    BerTlv tlv;
+    if (!outer.Next(tlv) || !tlv.IsApplication(tag::CamelServiceUsed)) {
+        throw BerError("CamelServiceUsed expected", offset);
+    }
+    BerReader reader = outer.Enter(tlv);
+    BerTlv child;
+    while (reader.Next(child)) {
+        switch (child.Tag()) {
+        case tag::CamelServiceLevel: camel.camelServiceLevel = DecodeCode(child); break;
+        case tag::CamelServiceKey: camel.camelServiceKey = BerDecodeInteger(child.value); break;
+        case tag::DefaultCallHandlingIndicator: camel.defaultCallHandling = DecodeCode(child); break;
+        case tag::ThreeGcamelDestination: camel.threeGcamelDestination = child.value; break;
+        }
+    }
+}
+
+void TapDecoder::DecodeSupplServiceUsedList(ByteView encoded, size_t offset, std::vector<SupplServiceUsed>& list)
+{
+    BerReader outer(encoded, offset);
+    BerTlv tlv;
+    if (!outer.Next(tlv) || !tlv.IsApplication(tag::SupplServiceUsedList)) {
+        throw BerError("SupplServiceUsedList expected", offset);
+    }
+    BerReader items = outer.Enter(tlv);
+    BerTlv item;
+    while (items.Next(item)) {
+        if (!item.IsApplication(tag::SupplServiceUsed) || !item.Constructed()) {
+            continue;
+        }
+        SupplServiceUsed used;
+        BerReader fields = items.Enter(item);
+        BerTlv field;
+        while (fields.Next(field)) {
+            switch (field.Tag()) {
+            case tag::SupplServiceCode: used.supplServiceCode = field.value; break;
+            case tag::SupplServiceActionCode: used.supplServiceActionCode = DecodeCode(field); break;
+            case tag::SsParameters: used.ssParameters = field.value; break;
+            case tag::ChargingTimeStamp: {
+                int32_t utcTimeOffsetCode = -1;
+                DecodeDateTime(fields, field, used.chargingTimeStamp, utcTimeOffsetCode);
+                break;
+            }
+            }
+        }
+        list.push_back(used);
+    }
+}
+
+void TapDecoder::DecodeOperatorSpecInfoList(ByteView encoded, size_t offset, std::vector<ByteView>& list)
+{
+    BerReader outer(encoded, offset);
+    BerTlv tlv;
+    if (!outer.Next(tlv) || !tlv.IsApplication(tag::OperatorSpecInfoList)) {
+        throw BerError("OperatorSpecInfoList expected", offset);
+    }
+    BerReader items = outer.Enter(tlv);
+    BerTlv item;
+    while (items.Next(item)) {
+        if (item.IsApplication(tag::OperatorSpecInformation)) {
+            list.push_back(item.value);
+        }
+    }
+}
+
+TapDecoder::CallEventDecoder TapDecoder::CallEventDecoderFor(TapRelease release)
+{
+    switch (release) {
+    case TapRelease::Tap310:
+    case TapRelease::Tap311: return DecodeReleaseCallEvent<Tap311>;
+    default: return DecodeReleaseCallEvent<Tap312>;
+    }
+}
+
+bool TapDecoder::DecodeCallEvent(const BerReader& parent, const BerTlv& tlv, CallEvent& event,
+    const CodeTables& tables, TapRelease release, const FieldSelection& fields)
+{
+    return CallEventDecoderFor(release)(parent, tlv, event, tables, fields);
+}
+
+} // namespace tap3
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <memory>
+#include "AuditAccumulator.h"
+#include "BerReader.h"
+#include "EventColumns.h"
+#include "CodeTables.h"
+#include "Tap3Types.h"
+
+namespace tap3 {
+
+// Receives decoded structures in file order. Header views point into the
+// decoded buffer. Call events arrive as columnar batches that are reused
+// by the decoder once the call returns.
+class TapHandler
+{
+public:
+    virtual ~TapHandler() = default;
+
+    virtual void OnBatchControlInfo(const BatchControlInfo&) {}
+    virtual void OnAccountingInfo(const AccountingInfo&) {}
+    virtual void OnNetworkInfo(const NetworkInfo&) {}
+    virtual void OnMessageDescriptionInfo(const std::vector<MessageDescriptionInfo>&) {}
+    virtual void OnEventBatch(const EventBatch&) {}
+    virtual void OnAuditControlInfo(const AuditControlInfo&) {}
+    virtual void OnNotification(const Notification&) {}
+};
+
+class ParallelCallEventDecoder;
+
+// Streaming decoder of DataInterChange. The file is walked once with a
+// pull tokenizer and no tree is built: each CallEventDetail is decoded into
+// a reused CallEvent and appended to a column batch that is passed on every
+// batchSize events. Header blocks are always decoded sequentially.
+class TapDecoder
+{
+public:
+    // With threadCount > 1 the CallEventDetailList is decoded on a worker
+    // pool (see ParallelCallEventDecoder); the handler is still called from
+    // the decoding thread in record order.
+    explicit TapDecoder(size_t threadCount = 1, size_t batchSize = 4096);
+    ~TapDecoder();
+
+    void Decode(ByteView file, TapHandler& handler);
+
+    // When enabled (the default), AuditControlInfo is checked against the
+    // totals accumulated while the call events were decoded and AuditError
+    // is thrown on any difference or when AuditControlInfo is missing.
+    void SetAuditValidation(bool enabled) { m_validateAudit = enabled; }
+    // Fields decoded into the column batches, per record type (all by
+    // default). Values the AuditControlInfo check needs are always decoded.
+    void SetFields(const FieldSelection& fields);
+    // Totals of the last decoded file.
+    const AuditAccumulator& Audit() const { return m_audit; }
+    // Records of the last decoded file with severe errors, in file order,
+    // and the code tables they were checked against.
+    const std::vector<RecordError>& RecordErrors() const { return m_recordErrors; }
+    const CodeTables& Tables() const { return m_tables; }
+    // Release the call events of the last decoded file were decoded as.
+    TapRelease Release() const { return m_release; }
+
+    // Resumable loading. While OnEventBatch runs, Position() is the file
+    // offset just past the last record handed over so far, and Audit() and
+    // RecordErrors() cover exactly the records before it.
+    uint64_t Position() const { return m_position; }
+    // Skips the records before byteOffset, continuing from the totals and
+    // record errors an earlier attempt had reached there. Must be called
+    // before CallEventDetailList is reached, e.g. from OnBatchControlInfo.
+    void ResumeAt(uint64_t byteOffset, const AuditAccumulator& audit, const std::vector<RecordError>& recordErrors);
+
+    // Header decoders, also used by callers that locate the blocks themselves.
+    static void DecodeBatchControlInfo(const BerReader& parent, const BerTlv& tlv, BatchControlInfo& info);
+    static void DecodeAccountingInfo(const BerReader& parent, const BerTlv& tlv, AccountingInfo& info);
+    static void DecodeNetworkInfo(const BerReader& parent, const BerTlv& tlv, NetworkInfo& info);
+    static void DecodeMessageDescriptionInfo(const BerReader& parent, const BerTlv& tlv,
+        std::vector<MessageDescriptionInfo>& info);
+    static void DecodeAuditControlInfo(const BerReader& parent, const BerTlv& tlv, AuditControlInfo& info);
+    static void DecodeNotification(const BerReader& parent, const BerTlv& tlv, Notification& info);
+
+    // Decodes one CallEventDetail of a file of the given release. Returns
+    // false for record types the release does not define (the event is left
+    // cleared). Charge structures are allocated from event.arena. Code
+    // references (UTC offset, exchange rate, tax, discount, recording
+    // entity) are resolved against tables.
+    // CamelServiceUsed, SupplServiceUsedList and OperatorSpecInfoList are
+    // decoded only as far as they carry charges; the rest is skipped by
+    // length and located in the event's BlockRef fields. Number, duration
+    // and data volume elements outside the event type's fields are skipped.
+    static bool DecodeCallEvent(const BerReader& parent, const BerTlv& tlv, CallEvent& event,
+        const CodeTables& tables, TapRelease release = kLatestTapRelease,
+        const FieldSelection& fields = AllFields());
+
+    // DecodeCallEvent specialised for one release at compile time, to be
+    // looked up once per file rather than per record.
+    typedef bool (*CallEventDecoder)(const BerReader& parent, const BerTlv& tlv, CallEvent& event,
+        const CodeTables& tables, const FieldSelection& fields);
+    static CallEventDecoder CallEventDecoderFor(TapRelease release);
+
+    // Decoders of the sub-structures DecodeCallEvent only locates. encoded is
+    // the whole element, e.g. EventBatch::Block() of a BlockRef column, and
+    // offset its position in the file for error messages.
+    static void DecodeCamelServiceUsed(ByteView encoded, size_t offset, CamelServiceUsed& camel);
+    static void DecodeSupplServiceUsedList(ByteView encoded, size_t offset, std::vector<SupplServiceUsed>& list);
+    static void DecodeOperatorSpecInfoList(ByteView encoded, size_t offset, std::vector<ByteView>& list);
+
+    // Appends a RecordError for event if it has any.
+    static void CollectRecordError(const CallEvent& event, std::vector<RecordError>& errors)
+    {
+        if (event.codeErrors != 0) {
+            errors.push_back(RecordError{ event.recordOffset, event.charge,
+                static_cast<uint32_t>(event.record.size), event.codeErrors });
+        }
+    }
+
+    // Returns the decode arenas' memory to the system. Called once the
+    // decoded file has been committed; arenas are otherwise only rewound
+    // between batches.
+    void ReleaseArenas();
+
+private:
+    void DecodeTransferBatch(const BerReader& parent, const BerTlv& tlv, TapHandler& handler);
+
+    ByteView m_file;
+    size_t m_batchSize;
+    EventBatch m_batch;
+    Arena m_arena;
+    CodeTables m_tables;
+    AuditAccumulator m_audit;
+    std::vector<RecordError> m_recordErrors;
+    bool m_validateAudit;
+    bool m_auditSeen;
+    TapRelease m_release;
+    uint64_t m_position;
+    uint64_t m_resumeOffset;          // 0 when decoding from the first record
+    std::unique_ptr<ParallelCallEventDecoder> m_parallel;
+};
+
+} // namespace tap3
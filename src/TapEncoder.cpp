@@ -0,0 +1,225 @@
+#include "TapEncoder.h"
+
+#include "Tap3Error.h"
+#include "Tap3Tags.h"
+
+namespace tap3 {
+
+namespace {
+
+// Optional elements are left out when they were absent in the decoded
+// structure: empty views and negative codes.
+void EncodeOptional(BerBuffer& out, uint32_t tag, ByteView value)
+{
+    if (value.size > 0) {
+        out.Primitive(tag, value);
+    }
+}
+
+void EncodeOptionalCode(BerBuffer& out, uint32_t tag, int32_t code)
+{
+    if (code >= 0) {
+        out.Integer(tag, code);
+    }
+}
+
+void EncodeDateTimeLong(BerBuffer& out, uint32_t tag, const DateTimeLong& value)
+{
+    if (value.localTimeStamp.size == 0) {
+        return;
+    }
+    out.Begin(tag);
+    out.Primitive(tag::LocalTimeStamp, value.localTimeStamp);
+    EncodeOptional(out, tag::UtcTimeOffset, value.utcTimeOffset);
+    out.End();
+}
+
+} // namespace
+
+void TapEncoder::EncodeBatchControlInfo(const BatchControlInfo& info, BerBuffer& out)
+{
+    out.Begin(tag::BatchControlInfo);
+    EncodeOptional(out, tag::Sender, info.sender);
+    EncodeOptional(out, tag::Recipient, info.recipient);
+    EncodeOptional(out, tag::FileSequenceNumber, info.fileSequenceNumber);
+    EncodeDateTimeLong(out, tag::FileCreationTimeStamp, info.fileCreationTimeStamp);
+    EncodeDateTimeLong(out, tag::TransferCutOffTimeStamp, info.transferCutOffTimeStamp);
+    EncodeDateTimeLong(out, tag::FileAvailableTimeStamp, info.fileAvailableTimeStamp);
+    out.Integer(tag::SpecificationVersionNumber, info.specificationVersionNumber);
+    out.Integer(tag::ReleaseVersionNumber, info.releaseVersionNumber);
+    EncodeOptional(out, tag::FileTypeIndicator, info.fileTypeIndicator);
+    EncodeOptional(out, tag::RapFileSequenceNumber, info.rapFileSequenceNumber);
+    out.End();
+}
+
+void TapEncoder::EncodeAccountingInfo(const AccountingInfo& info, BerBuffer& out)
+{
+    out.Begin(tag::AccountingInfo);
+    if (!info.taxation.empty()) {
+        out.Begin(tag::TaxationList);
+        for (const Taxation& taxation : info.taxation) {
+            out.Begin(tag::Taxation);
+            out.Integer(tag::TaxCode, taxation.taxCode);
+            EncodeOptional(out, tag::TaxType, taxation.taxType);
+            EncodeOptional(out, tag::TaxRate, taxation.taxRate);
+            EncodeOptional(out, tag::ChargeType, taxation.chargeType);
+            out.End();
+        }
+        out.End();
+    }
+    if (!info.discounting.empty()) {
+        out.Begin(tag::DiscountingList);
+        for (const Discounting& discounting : info.discounting) {
+            out.Begin(tag::Discounting);
+            out.Integer(tag::DiscountCode, discounting.discountCode);
+            // the decoder keeps only the value of the DiscountApplied choice
+            out.Primitive(tag::FixedDiscountValue, discounting.discountApplied);
+            out.End();
+        }
+        out.End();
+    }
+    EncodeOptional(out, tag::LocalCurrency, info.localCurrency);
+    EncodeOptional(out, tag::TapCurrency, info.tapCurrency);
+    if (!info.currencyConversion.empty()) {
+        out.Begin(tag::CurrencyConversionList);
+        for (const CurrencyConversion& conversion : info.currencyConversion) {
+            out.Begin(tag::CurrencyConversion);
+            out.Integer(tag::ExchangeRateCode, conversion.exchangeRateCode);
+            out.Integer(tag::NumberOfDecimalPlaces, conversion.numberOfDecimalPlaces);
+            out.Integer(tag::ExchangeRate, conversion.exchangeRate);
+            out.End();
+        }
+        out.End();
+    }
+    EncodeOptionalCode(out, tag::TapDecimalPlaces, info.tapDecimalPlaces);
+    out.End();
+}
+
+void TapEncoder::EncodeNetworkInfo(const NetworkInfo& info, BerBuffer& out)
+{
+    out.Begin(tag::NetworkInfo);
+    if (!info.utcTimeOffsetInfo.empty()) {
+        out.Begin(tag::UtcTimeOffsetInfoList);
+        for (const UtcTimeOffsetInfo& offset : info.utcTimeOffsetInfo) {
+            out.Begin(tag::UtcTimeOffsetInfo);
+            out.Integer(tag::UtcTimeOffsetCode, offset.utcTimeOffsetCode);
+            out.Primitive(tag::UtcTimeOffset, offset.utcTimeOffset);
+            out.End();
+        }
+        out.End();
+    }
+    if (!info.recEntityInfo.empty()) {
+        out.Begin(tag::RecEntityInfoList);
+        for (const RecEntityInfo& entity : info.recEntityInfo) {
+            out.Begin(tag::RecEntityInformation);
+            out.Integer(tag::RecEntityCode, entity.recEntityCode);
+            EncodeOptionalCode(out, tag::RecEntityType, entity.recEntityType);
+            EncodeOptional(out, tag::RecEntityId, entity.recEntityId);
+            out.End();
+        }
+        out.End();
+    }
+    out.End();
+}
+
+void TapEncoder::EncodeMessageDescriptionInfo(const std::vector<MessageDescriptionInfo>& info, BerBuffer& out)
+{
+    out.Begin(tag::MessageDescriptionInfoList);
+    for (const MessageDescriptionInfo& description : info) {
+        out.Begin(tag::MessageDescriptionInformation);
+        out.Integer(tag::MessageDescriptionCode, description.messageDescriptionCode);
+        EncodeOptional(out, tag::MessageDescription, description.messageDescription);
+        out.End();
+    }
+    out.End();
+}
+
+void TapEncoder::EncodeAuditControlInfo(const AuditControlInfo& info, BerBuffer& out)
+{
+    out.Begin(tag::AuditControlInfo);
+    EncodeDateTimeLong(out, tag::EarliestCallTimeStamp, info.earliestCallTimeStamp);
+    EncodeDateTimeLong(out, tag::LatestCallTimeStamp, info.latestCallTimeStamp);
+    out.Integer(tag::TotalCharge, info.totalCharge);
+    if (info.totalChargeRefund != 0) {
+        out.Integer(tag::TotalChargeRefund, info.totalChargeRefund);
+    }
+    if (info.totalTaxRefund != 0) {
+        out.Integer(tag::TotalTaxRefund, info.totalTaxRefund);
+    }
+    out.Integer(tag::TotalTaxValue, info.totalTaxValue);
+    out.Integer(tag::TotalDiscountValue, info.totalDiscountValue);
+    if (info.totalDiscountRefund != 0) {
+        out.Integer(tag::TotalDiscountRefund, info.totalDiscountRefund);
+    }
+    out.Integer(tag::CallEventDetailsCount, info.callEventDetailsCount);
+    out.End();
+}
+
+void TapEncoder::EncodeNotification(const Notification& info, BerBuffer& out)
+{
+    out.Begin(tag::Notification);
+    EncodeOptional(out, tag::Sender, info.sender);
+    EncodeOptional(out, tag::Recipient, info.recipient);
+    EncodeOptional(out, tag::FileSequenceNumber, info.fileSequenceNumber);
+    EncodeOptional(out, tag::RapFileSequenceNumber, info.rapFileSequenceNumber);
+    EncodeDateTimeLong(out, tag::FileCreationTimeStamp, info.fileCreationTimeStamp);
+    EncodeDateTimeLong(out, tag::FileAvailableTimeStamp, info.fileAvailableTimeStamp);
+    EncodeDateTimeLong(out, tag::TransferCutOffTimeStamp, info.transferCutOffTimeStamp);
+    out.Integer(tag::SpecificationVersionNumber, info.specificationVersionNumber);
+    out.Integer(tag::ReleaseVersionNumber, info.releaseVersionNumber);
+    EncodeOptional(out, tag::FileTypeIndicator, info.fileTypeIndicator);
+    out.End();
+}
+
+void TapEncoder::BeginTransferBatch(const TransferBatchHeader& header, uint64_t callEventListLength,
+    const AuditControlInfo& audit)
+{
+    if (m_open) {
+        throw Tap3Error("TransferBatch already started");
+    }
+    m_header.Clear();
+    EncodeBatchControlInfo(header.batchControlInfo, m_header);
+    EncodeAccountingInfo(header.accountingInfo, m_header);
+    EncodeNetworkInfo(header.networkInfo, m_header);
+    if (!header.messageDescriptionInfo.empty()) {
+        EncodeMessageDescriptionInfo(header.messageDescriptionInfo, m_header);
+    }
+    m_audit.Clear();
+    EncodeAuditControlInfo(audit, m_audit);
+
+    size_t listLength = static_cast<size_t>(callEventListLength);
+    m_writer.Constructed(tag::TransferBatch,
+        m_header.Size() + BerWriter::TlvSize(tag::CallEventDetailList, listLength) + m_audit.Size());
+    m_writer.Raw(m_header.View());
+    m_writer.Constructed(tag::CallEventDetailList, listLength);
+    m_remaining = callEventListLength;
+    m_open = true;
+}
+
+void TapEncoder::WriteCallEvent(ByteView record)
+{
+    if (!m_open || record.size > m_remaining) {
+        throw Tap3Error("Call event exceeds the announced CallEventDetailList length");
+    }
+    m_writer.Raw(record);
+    m_remaining -= record.size;
+}
+
+void TapEncoder::EndTransferBatch()
+{
+    if (!m_open || m_remaining != 0) {
+        throw Tap3Error("CallEventDetailList is " + std::to_string(m_remaining)
+            + " bytes shorter than announced");
+    }
+    m_writer.Raw(m_audit.View());
+    m_open = false;
+}
+
+void TapEncoder::WriteNotification(const Notification& notification)
+{
+    m_header.Clear();
+    EncodeNotification(notification, m_header);
+    m_writer.Raw(m_header.View());
+}
+
+} // namespace tap3
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include "BerWriter.h"
+#include "Tap3Types.h"
+
+namespace tap3 {
+
+// Header blocks of a TransferBatch. MessageDescriptionInfoList is written
+// only when messageDescriptionInfo is not empty.
+struct TransferBatchHeader
+{
+    BatchControlInfo batchControlInfo;
+    AccountingInfo accountingInfo;
+    NetworkInfo networkInfo;
+    std::vector<MessageDescriptionInfo> messageDescriptionInfo;
+};
+
+// Streaming encoder of DataInterChange, the counterpart of TapDecoder. No
+// tree of the file is built: the header blocks and AuditControlInfo are
+// encoded in memory (they are small) and call events are written to the
+// output as they are produced, so the caller needs only the encoded length
+// of the whole CallEventDetailList up front - usually from a sizing pass
+// over its own deterministic input, or from the source file when
+// re-encoding. ReturnBatch output is done the same way by WriteRapFile.
+class TapEncoder
+{
+public:
+    explicit TapEncoder(OutputFile& output) : m_writer(output), m_remaining(0), m_open(false) {}
+
+    void BeginTransferBatch(const TransferBatchHeader& header, uint64_t callEventListLength,
+        const AuditControlInfo& audit);
+    // One complete encoded CallEventDetail, e.g. built with a BerBuffer or
+    // CallEvent::record of a decoded file.
+    void WriteCallEvent(ByteView record);
+    // Throws if the call events written do not add up to callEventListLength.
+    void EndTransferBatch();
+
+    void WriteNotification(const Notification& notification);
+
+    // Block encoders, the counterparts of TapDecoder's header decoders.
+    static void EncodeBatchControlInfo(const BatchControlInfo& info, BerBuffer& out);
+    static void EncodeAccountingInfo(const AccountingInfo& info, BerBuffer& out);
+    static void EncodeNetworkInfo(const NetworkInfo& info, BerBuffer& out);
+    static void EncodeMessageDescriptionInfo(const std::vector<MessageDescriptionInfo>& info, BerBuffer& out);
+    static void EncodeAuditControlInfo(const AuditControlInfo& info, BerBuffer& out);
+    static void EncodeNotification(const Notification& info, BerBuffer& out);
+
+private:
+    BerWriter m_writer;
+    BerBuffer m_header;
+    BerBuffer m_audit;
+    uint64_t m_remaining;
+    bool m_open;
+};
+
+} // namespace tap3
@@ -0,0 +1,417 @@
+#include "TapGenerator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "BerWriter.h"
+#include "Tap3Error.h"
+#include "Tap3Tags.h"
+#include "TapEncoder.h"
+#include "Tbcd.h"
+#include "TimeStamp.h"
+
+namespace tap3 {
+
+namespace {
+
+const char* const kUtcOffsets[] = { "+0100", "+0200", "+0300", "-0500", "+0530", "+0000", "+0800", "-0300" };
+const size_t kUtcOffsetCount = sizeof(kUtcOffsets) / sizeof(kUtcOffsets[0]);
+const int32_t kTapDecimalPlaces = 3;
+const int32_t kExchangeRateDecimalPlaces = 5;
+const int64_t kTaxPercent = 20;
+
+// splitmix64: fixed algorithm, unlike the std distributions, so output does
+// not depend on the standard library.
+class Random
+{
+public:
+    explicit Random(uint64_t seed) : m_state(seed) {}
+
+    uint64_t Next()
+    {
+        uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint32_t Below(uint32_t bound) { return bound > 0 ? static_cast<uint32_t>(Next() % bound) : 0; }
+    int64_t Between(int64_t low, int64_t high) { return low + static_cast<int64_t>(Next() % (high - low + 1)); }
+
+private:
+    uint64_t m_state;
+};
+
+enum class RecordKind
+{
+    Moc,
+    Mtc,
+    Gprs,
+    Sms,
+    Session
+};
+
+// Figures of one generated record needed for AuditControlInfo.
+struct RecordTotals
+{
+    int64_t charge = 0;
+    int64_t taxValue = 0;
+    int64_t startUtc = 0;
+    std::string localTimeStamp;
+    uint32_t utcTimeOffsetCode = 0;
+};
+
+class RecordGenerator
+{
+public:
+    explicit RecordGenerator(const GeneratorSettings& settings) : m_settings(settings)
+    {
+        m_weights[0] = settings.mocWeight;
+        m_weights[1] = settings.mtcWeight;
+        m_weights[2] = settings.gprsWeight + (settings.releaseVersionNumber < 12 ? settings.sessionWeight : 0);
+        m_weights[3] = settings.smsWeight;
+        m_weights[4] = settings.releaseVersionNumber < 12 ? 0 : settings.sessionWeight;
+        m_totalWeight = 0;
+        for (uint32_t weight : m_weights) {
+            m_totalWeight += weight;
+        }
+        if (m_totalWeight == 0) {
+            throw Tap3Error("Record mix weights are all zero");
+        }
+    }
+
+    void Generate(uint64_t index, BerBuffer& out, RecordTotals& totals)
+    {
+        Random random(m_settings.seed * 0x100000001b3ULL + index);
+        out.Clear();
+        totals = RecordTotals();
+        switch (PickKind(random)) {
+        case RecordKind::Moc: Call(random, index, tag::MobileOriginatedCall, "11", out, totals); break;
+        case RecordKind::Mtc: Call(random, index, tag::MobileTerminatedCall, "11", out, totals); break;
+        case RecordKind::Sms: Call(random, index, tag::MobileOriginatedCall, "22", out, totals); break;
+        case RecordKind::Gprs: Gprs(random, out, totals); break;
+        case RecordKind::Session: Session(random, out, totals); break;
+        }
+    }
+
+private:
+    RecordKind PickKind(Random& random)
+    {
+        uint32_t pick = random.Below(m_totalWeight);
+        for (size_t i = 0; i < 5; i++) {
+            if (pick < m_weights[i]) {
+                return static_cast<RecordKind>(i);
+            }
+            pick -= m_weights[i];
+        }
+        return RecordKind::Moc;
+    }
+
+    void Digits(BerBuffer& out, uint32_t numberTag, const char* prefix, uint64_t number, size_t width,
+        NibbleOrder order)
+    {
+        char digits[32];
+        int count = snprintf(digits, sizeof(digits), "%s%0*llu", prefix, static_cast<int>(width),
+            static_cast<unsigned long long>(number));
+        uint8_t packed[16];
+        out.Primitive(numberTag, ByteView(packed, EncodeDigits(digits, static_cast<size_t>(count), order, packed)));
+    }
+
+    void Subscriber(Random& random, BerBuffer& out)
+    {
+        uint64_t subscriber = random.Below(std::max<uint32_t>(m_settings.subscriberCount, 1));
+        Digits(out, tag::Imsi, "25001", subscriber, 10, NibbleOrder::LowFirst);
+        Digits(out, tag::Msisdn, "7916", subscriber, 7, NibbleOrder::HighFirst);
+    }
+
+    void ChargeableSubscriber(Random& random, BerBuffer& out)
+    {
+        out.Begin(tag::ChargeableSubscriber);
+        out.Begin(tag::SimChargeableSubscriber);
+        Subscriber(random, out);
+        out.End();
+        out.End();
+    }
+
+    void StartTimeStamp(Random& random, uint32_t timeStampTag, BerBuffer& out, RecordTotals& totals)
+    {
+        uint32_t days = std::min<uint32_t>(std::max<uint32_t>(m_settings.days, 1), 28);
+        uint32_t seconds = random.Below(days * 86400);
+        char local[16];
+        snprintf(local, sizeof(local), "202601%02u%02u%02u%02u", 1 + seconds / 86400, seconds / 3600 % 24,
+            seconds / 60 % 60, seconds % 60);
+        totals.localTimeStamp = local;
+        totals.utcTimeOffsetCode = random.Below(std::max<uint32_t>(m_settings.utcOffsetCodes, 1));
+        int64_t localSeconds = 0;
+        int32_t offset = 0;
+        ParseLocalTimeStamp(ByteView(reinterpret_cast<const uint8_t*>(local), 14), localSeconds);
+        const char* utcOffset = kUtcOffsets[totals.utcTimeOffsetCode % kUtcOffsetCount];
+        ParseUtcTimeOffset(ByteView(reinterpret_cast<const uint8_t*>(utcOffset), 5), offset);
+        totals.startUtc = localSeconds - offset;
+
+        out.Begin(timeStampTag);
+        out.Primitive(tag::LocalTimeStamp, totals.localTimeStamp);
+        out.Integer(tag::UtcTimeOffsetCode, totals.utcTimeOffsetCode);
+        out.End();
+    }
+
+    void ChargeInformation(Random& random, uint32_t chargeTag, const char* chargedItem, BerBuffer& out,
+        RecordTotals& totals)
+    {
+        uint32_t minDetails = std::max<uint32_t>(m_settings.minChargeDetails, 1);
+        uint32_t maxDetails = std::max(m_settings.maxChargeDetails, minDetails);
+        uint32_t details = static_cast<uint32_t>(random.Between(minDetails, maxDetails));
+        int64_t charge = random.Between(100, 100000);
+        int64_t units = random.Between(1, 3600);
+
+        out.Begin(chargeTag);
+        out.Primitive(tag::ChargedItem, std::string(chargedItem));
+        out.Integer(tag::ExchangeRateCode, random.Below(std::max<uint32_t>(m_settings.exchangeRateCodes, 1)));
+        out.Begin(tag::ChargeDetailList);
+        int64_t remaining = charge;
+        for (uint32_t i = 0; i < details; i++) {
+            // the total first, then components that add up to it
+            int64_t value = charge;
+            char chargeType[12] = "00";
+            if (i > 0) {
+                value = i + 1 < details ? remaining / 2 : remaining;
+                remaining -= value;
+                snprintf(chargeType, sizeof(chargeType), "%02u", i);
+            }
+            out.Begin(tag::ChargeDetail);
+            out.Primitive(tag::ChargeType, std::string(chargeType));
+            out.Integer(tag::Charge, value);
+            out.Integer(tag::ChargeableUnits, units);
+            out.Integer(tag::ChargedUnits, units);
+            out.End();
+        }
+        out.End();
+        if (m_settings.taxCodes > 0) {
+            int64_t tax = charge * kTaxPercent / 100;
+            out.Begin(tag::TaxInformationList);
+            out.Begin(tag::TaxInformation);
+            out.Integer(tag::TaxCode, random.Below(m_settings.taxCodes));
+            out.Integer(tag::TaxValue, tax);
+            out.End();
+            out.End();
+            totals.taxValue += tax;
+        }
+        out.End();
+        totals.charge += charge;
+    }
+
+    void Camel(Random& random, BerBuffer& out, RecordTotals& totals)
+    {
+        int64_t fee = random.Between(1, 500);
+        out.Begin(tag::CamelServiceUsed);
+        out.Integer(tag::CamelServiceLevel, random.Below(4));
+        out.Integer(tag::CamelServiceKey, random.Below(1000));
+        out.Integer(tag::DefaultCallHandlingIndicator, 0);
+        out.Integer(tag::ExchangeRateCode, random.Below(std::max<uint32_t>(m_settings.exchangeRateCodes, 1)));
+        out.Integer(tag::CamelInvocationFee, fee);
+        out.End();
+        totals.charge += fee;
+    }
+
+    // MO and MT calls, and SMS as MO calls with teleservice 22.
+    void Call(Random& random, uint64_t index, uint32_t recordTag, const char* teleService, BerBuffer& out,
+        RecordTotals& totals)
+    {
+        bool sms = recordTag == tag::MobileOriginatedCall && teleService[0] == '2';
+        bool originated = recordTag == tag::MobileOriginatedCall;
+        out.Begin(recordTag);
+        out.Begin(originated ? tag::MoBasicCallInformation : tag::MtBasicCallInformation);
+        ChargeableSubscriber(random, out);
+        out.Begin(originated ? tag::Destination : tag::CallOriginator);
+        Digits(out, originated ? tag::CalledNumber : tag::CallingNumber, "7495", random.Below(10000000), 7,
+            NibbleOrder::HighFirst);
+        out.End();
+        StartTimeStamp(random, tag::CallEventStartTimeStamp, out, totals);
+        out.Integer(tag::TotalCallEventDuration, sms ? 0 : random.Between(1, 3600));
+        out.End();
+        out.Begin(tag::LocationInformation);
+        out.Begin(tag::NetworkLocation);
+        out.Integer(tag::RecEntityCode, random.Below(std::max<uint32_t>(m_settings.recEntityCodes, 1)));
+        out.End();
+        out.End();
+        out.Begin(tag::ImeiOrEsn);
+        Digits(out, tag::Imei, "35", index % 1000000000000ULL, 12, NibbleOrder::HighFirst);
+        out.End();
+        out.Begin(tag::BasicServiceUsedList);
+        out.Begin(tag::BasicServiceUsed);
+        out.Begin(tag::BasicService);
+        out.Begin(tag::BasicServiceCode);
+        out.Primitive(tag::TeleServiceCode, std::string(teleService));
+        out.End();
+        out.End();
+        out.Begin(tag::ChargeInformationList);
+        ChargeInformation(random, tag::ChargeInformation, sms ? "E" : "D", out, totals);
+        out.End();
+        out.End();
+        out.End();
+        if (!sms && random.Below(100) < m_settings.camelPercent) {
+            Camel(random, out, totals);
+        }
+        out.End();
+    }
+
+    void Gprs(Random& random, BerBuffer& out, RecordTotals& totals)
+    {
+        out.Begin(tag::GprsCall);
+        out.Begin(tag::GprsBasicCallInformation);
+        out.Begin(tag::GprsChargeableSubscriber);
+        ChargeableSubscriber(random, out);
+        out.End();
+        StartTimeStamp(random, tag::CallEventStartTimeStamp, out, totals);
+        out.Integer(tag::TotalCallEventDuration, random.Between(1, 86400));
+        out.End();
+        out.Begin(tag::GprsServiceUsed);
+        out.Integer(tag::DataVolumeIncoming, random.Between(0, 100000000));
+        out.Integer(tag::DataVolumeOutgoing, random.Between(0, 10000000));
+        out.Begin(tag::ChargeInformationList);
+        ChargeInformation(random, tag::ChargeInformation, "X", out, totals);
+        out.End();
+        out.End();
+        out.End();
+    }
+
+    void Session(Random& random, BerBuffer& out, RecordTotals& totals)
+    {
+        out.Begin(tag::MobileSession);
+        out.Integer(tag::MobileSessionService, 1);
+        out.Begin(tag::ChargedParty);
+        Subscriber(random, out);
+        out.End();
+        out.Begin(tag::RecEntityCodeList);
+        out.Integer(tag::RecEntityCode, random.Below(std::max<uint32_t>(m_settings.recEntityCodes, 1)));
+        out.End();
+        StartTimeStamp(random, tag::ServiceStartTimestamp, out, totals);
+        out.Integer(tag::TotalCallEventDuration, random.Between(1, 3600));
+        out.Begin(tag::SessionChargeInfoList);
+        ChargeInformation(random, tag::SessionChargeInformation, "D", out, totals);
+        out.End();
+        out.End();
+    }
+
+    const GeneratorSettings& m_settings;
+    uint32_t m_weights[5];
+    uint32_t m_totalWeight;
+};
+
+ByteView View(const std::string& value)
+{
+    return ByteView(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+}
+
+} // namespace
+
+GeneratorResult GenerateTapFile(const std::string& path, const GeneratorSettings& settings)
+{
+    if (settings.releaseVersionNumber != 11 && settings.releaseVersionNumber != 12) {
+        throw Tap3Error("Only TAP 3.11 and 3.12 files can be generated");
+    }
+    RecordGenerator generator(settings);
+    BerBuffer record;
+    RecordTotals totals;
+
+    // sizing pass: CallEventDetailList length and AuditControlInfo
+    uint64_t listLength = 0;
+    AuditControlInfo audit;
+    std::string earliest, latest;
+    int64_t earliestUtc = INT64_MAX, latestUtc = INT64_MIN;
+    uint32_t earliestCode = 0, latestCode = 0;
+    for (uint64_t i = 0; i < settings.recordCount; i++) {
+        generator.Generate(i, record, totals);
+        listLength += record.Size();
+        audit.totalCharge += totals.charge;
+        audit.totalTaxValue += totals.taxValue;
+        if (totals.startUtc < earliestUtc) {
+            earliestUtc = totals.startUtc;
+            earliest = totals.localTimeStamp;
+            earliestCode = totals.utcTimeOffsetCode;
+        }
+        if (totals.startUtc > latestUtc) {
+            latestUtc = totals.startUtc;
+            latest = totals.localTimeStamp;
+            latestCode = totals.utcTimeOffsetCode;
+        }
+    }
+    audit.callEventDetailsCount = static_cast<int64_t>(settings.recordCount);
+    std::string earliestOffset = kUtcOffsets[earliestCode % kUtcOffsetCount];
+    std::string latestOffset = kUtcOffsets[latestCode % kUtcOffsetCount];
+    if (settings.recordCount > 0) {
+        audit.earliestCallTimeStamp = DateTimeLong{ View(earliest), View(earliestOffset) };
+        audit.latestCallTimeStamp = DateTimeLong{ View(latest), View(latestOffset) };
+    }
+
+    // header blocks; the strings behind their views live until the end
+    std::string fileTimeStamp = "20260201000000";
+    std::string fileOffset = "+0000";
+    std::string taxType = "01";
+    std::string taxRate = "2000000";
+    std::string localCurrency = "EUR";
+    std::string tapCurrency = "SDR";
+    std::vector<std::string> recEntityIds;
+    TransferBatchHeader header;
+    BatchControlInfo& control = header.batchControlInfo;
+    control.sender = View(settings.sender);
+    control.recipient = View(settings.recipient);
+    control.fileSequenceNumber = View(settings.fileSequenceNumber);
+    control.fileCreationTimeStamp = DateTimeLong{ View(fileTimeStamp), View(fileOffset) };
+    control.transferCutOffTimeStamp = DateTimeLong{ View(fileTimeStamp), View(fileOffset) };
+    control.fileAvailableTimeStamp = DateTimeLong{ View(fileTimeStamp), View(fileOffset) };
+    control.specificationVersionNumber = 3;
+    control.releaseVersionNumber = settings.releaseVersionNumber;
+    AccountingInfo& accounting = header.accountingInfo;
+    for (uint32_t code = 0; code < settings.taxCodes; code++) {
+        Taxation taxation;
+        taxation.taxCode = static_cast<int32_t>(code);
+        taxation.taxType = View(taxType);
+        taxation.taxRate = View(taxRate);
+        accounting.taxation.push_back(taxation);
+    }
+    accounting.localCurrency = View(localCurrency);
+    accounting.tapCurrency = View(tapCurrency);
+    for (uint32_t code = 0; code < std::max<uint32_t>(settings.exchangeRateCodes, 1); code++) {
+        CurrencyConversion conversion;
+        conversion.exchangeRateCode = static_cast<int32_t>(code);
+        conversion.numberOfDecimalPlaces = kExchangeRateDecimalPlaces;
+        conversion.exchangeRate = 100000 + code * 1234;
+        accounting.currencyConversion.push_back(conversion);
+    }
+    accounting.tapDecimalPlaces = kTapDecimalPlaces;
+    for (uint32_t code = 0; code < std::max<uint32_t>(settings.utcOffsetCodes, 1); code++) {
+        const char* offset = kUtcOffsets[code % kUtcOffsetCount];
+        header.networkInfo.utcTimeOffsetInfo.push_back(UtcTimeOffsetInfo{ static_cast<int32_t>(code),
+            ByteView(reinterpret_cast<const uint8_t*>(offset), 5) });
+    }
+    uint32_t recEntityCodes = std::max<uint32_t>(settings.recEntityCodes, 1);
+    recEntityIds.reserve(recEntityCodes);
+    for (uint32_t code = 0; code < recEntityCodes; code++) {
+        char id[16];
+        snprintf(id, sizeof(id), "7900%07u", code);
+        recEntityIds.push_back(id);
+        header.networkInfo.recEntityInfo.push_back(RecEntityInfo{ static_cast<int32_t>(code), 1,
+            View(recEntityIds.back()) });
+    }
+
+    // writing pass
+    OutputFile output(path);
+    TapEncoder encoder(output);
+    encoder.BeginTransferBatch(header, listLength, audit);
+    for (uint64_t i = 0; i < settings.recordCount; i++) {
+        generator.Generate(i, record, totals);
+        encoder.WriteCallEvent(record.View());
+    }
+    encoder.EndTransferBatch();
+    output.Commit();
+
+    GeneratorResult result;
+    result.recordCount = settings.recordCount;
+    result.fileSize = output.Written();
+    result.totalCharge = audit.totalCharge;
+    return result;
+}
+
+} // namespace tap3
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace tap3 {
+
+// Shape of a synthetic TransferBatch. Every record is derived from
+// (seed, record index) only, so the same settings always give the same
+// file, byte for byte, on every platform.
+struct GeneratorSettings
+{
+    uint64_t recordCount = 1000;
+    uint64_t seed = 1;
+    int32_t releaseVersionNumber = 12;      // TAP 3.11 or 3.12
+    std::string sender = "AAAAA";
+    std::string recipient = "BBBBB";
+    std::string fileSequenceNumber = "00001";
+
+    // Relative weights of the record types. SMS are MO calls with the
+    // short message teleservice. MobileSession exists only in TAP 3.12;
+    // for 3.11 its weight goes to GPRS.
+    uint32_t mocWeight = 40;
+    uint32_t mtcWeight = 25;
+    uint32_t gprsWeight = 20;
+    uint32_t smsWeight = 10;
+    uint32_t sessionWeight = 5;
+
+    // ChargeDetails per ChargeInformation: one total ("00") plus
+    // components when more than one.
+    uint32_t minChargeDetails = 1;
+    uint32_t maxChargeDetails = 3;
+    // Share of MO/MT calls with CamelServiceUsed (and an invocation fee).
+    uint32_t camelPercent = 10;
+
+    // Partner code tables; records reference random entries of each.
+    uint32_t utcOffsetCodes = 2;
+    uint32_t recEntityCodes = 8;
+    uint32_t exchangeRateCodes = 2;
+    uint32_t taxCodes = 2;
+
+    uint32_t subscriberCount = 100000;
+    uint32_t days = 1;                      // call start times spread over this many days (max 28)
+};
+
+struct GeneratorResult
+{
+    uint64_t recordCount = 0;
+    uint64_t fileSize = 0;
+    int64_t totalCharge = 0;
+};
+
+// Writes a TAP file that passes PreValidate and whose AuditControlInfo
+// matches its call events. Records are generated twice, once to size the
+// CallEventDetailList and once to stream it through TapEncoder, so memory
+// does not depend on recordCount.
+GeneratorResult GenerateTapFile(const std::string& path, const GeneratorSettings& settings);
+
+} // namespace tap3
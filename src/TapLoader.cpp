@@ -0,0 +1,416 @@
+#include "TapLoader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+
+#include "MappedFile.h"
+#include "PreValidator.h"
+#include "RapWriter.h"
+
+namespace tap3 {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double Seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+const size_t kFingerprintBytes = 64 << 10;
+
+// FNV-1a over the first and last 64 KB of the file: the headers with
+// BatchControlInfo and the AuditControlInfo with its totals, so a resent
+// file of the same size with other contents does not resume a checkpoint.
+uint64_t ContentFingerprint(ByteView file)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto add = [&hash](const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ data[i]) * 0x100000001B3ULL;
+        }
+    };
+    size_t head = std::min(file.size, kFingerprintBytes);
+    add(file.data, head);
+    size_t tail = std::min(file.size - head, kFingerprintBytes);
+    add(file.data + file.size - tail, tail);
+    return hash;
+}
+
+class SinkHandler : public TapHandler
+{
+public:
+    SinkHandler(EventSink& sink, LoadResult& result, TapDecoder& decoder, const LoaderSettings& settings)
+        : m_sink(sink), m_result(result), m_decoder(decoder), m_checkpointEvents(settings.checkpointEvents),
+          m_index(settings.duplicateIndex), m_projection(settings.projection), m_fileKey(0), m_begun(false), m_staged(false), m_indexed(false),
+          m_uncheckpointed(0), m_contentHash(0), m_tapDecimalPlaces(0), m_reportedErrors(0) {}
+
+    // Before the decode, for matching checkpoints against the file.
+    void SetContentHash(uint64_t hash) { m_contentHash = hash; }
+
+    void OnBatchControlInfo(const BatchControlInfo& info) override
+    {
+        m_result.file.sender = info.sender.ToString();
+        m_result.file.recipient = info.recipient.ToString();
+        m_result.file.fileSequenceNumber = info.fileSequenceNumber.ToString();
+        m_result.file.specificationVersionNumber = info.specificationVersionNumber;
+        m_result.file.releaseVersionNumber = info.releaseVersionNumber;
+        Begin();
+    }
+
+    void OnNotification(const Notification& info) override
+    {
+        m_result.file.sender = info.sender.ToString();
+        m_result.file.recipient = info.recipient.ToString();
+        m_result.file.fileSequenceNumber = info.fileSequenceNumber.ToString();
+        m_result.file.specificationVersionNumber = info.specificationVersionNumber;
+        m_result.file.releaseVersionNumber = info.releaseVersionNumber;
+        m_result.file.notification = true;
+        Begin();
+    }
+
+    void OnAccountingInfo(const AccountingInfo& info) override
+    {
+        m_tapDecimalPlaces = info.tapDecimalPlaces;
+    }
+
+    void OnAuditControlInfo(const AuditControlInfo& info) override
+    {
+        Begin();
+        Clock::time_point start = Clock::now();
+        AuditTotals totals;
+        totals.earliestCallTimeStamp = info.earliestCallTimeStamp.localTimeStamp.ToString()
+            + info.earliestCallTimeStamp.utcTimeOffset.ToString();
+        totals.latestCallTimeStamp = info.latestCallTimeStamp.localTimeStamp.ToString()
+            + info.latestCallTimeStamp.utcTimeOffset.ToString();
+        totals.totalCharge = info.totalCharge;
+        totals.totalTaxValue = info.totalTaxValue;
+        totals.totalDiscountValue = info.totalDiscountValue;
+        totals.callEventDetailsCount = info.callEventDetailsCount;
+        m_sink.WriteAuditTotals(totals);
+        m_result.timings.seconds[static_cast<size_t>(LoadStage::Bind)] += Seconds(start);
+    }
+
+    void OnEventBatch(const EventBatch& batch) override
+    {
+        Begin();
+        // the duplicate check is accounted as part of preparing the rows
+        Clock::time_point start = Clock::now();
+        const EventBatch& valid = WithoutRecordErrors(batch);
+        const EventBatch& loaded = m_index ? Deduplicate(valid) : valid;
+        m_sink.WriteEvents(loaded);
+        m_result.timings.seconds[static_cast<size_t>(LoadStage::Bind)] += Seconds(start);
+        for (size_t i = 0; i < kCallEventTypeCount; i++) {
+            CallEventType type = static_cast<CallEventType>(i);
+            if (Loads(type)) {
+                m_result.eventCount += loaded.Columns(type).Size();
+                m_result.timings.events[i] += loaded.Columns(type).Size();
+            }
+        }
+        m_uncheckpointed += batch.Size();
+        if (m_staged && m_uncheckpointed >= m_checkpointEvents) {
+            Checkpoint();
+        }
+    }
+
+    void Begin()
+    {
+        if (m_begun) {
+            return;
+        }
+        Clock::time_point start = Clock::now();
+        if (m_index) {
+            // before the sink sees the file, so a copy being loaded by
+            // another worker is not mistaken for an earlier attempt
+            m_fileKey = FileFingerprint(m_result.file.sender, m_result.file.recipient,
+                m_result.file.fileSequenceNumber);
+            m_index->BeginFile(m_fileKey);
+            m_indexed = true;
+        }
+        bool resumed = false;
+        m_staged = m_checkpointEvents > 0 && !m_result.file.notification && m_sink.SupportsStaging();
+        if (!m_staged) {
+            m_sink.BeginFile(m_result.file);
+        }
+        else if (m_sink.BeginStagedFile(m_result.file, m_checkpoint)) {
+            if (m_checkpoint.fileSize == m_result.timings.bytes && m_checkpoint.contentHash == m_contentHash) {
+                m_decoder.ResumeAt(m_checkpoint.byteOffset, m_checkpoint.audit, m_checkpoint.recordErrors);
+                m_result.eventCount = m_checkpoint.eventCount;
+                m_result.resumedEventCount = m_checkpoint.eventCount;
+                m_reportedErrors = m_decoder.RecordErrors().size();
+                resumed = true;
+            }
+            else {
+                // not the file the checkpoint was taken on
+                m_sink.DiscardStagedFile();
+                m_sink.BeginStagedFile(m_result.file, m_checkpoint);
+            }
+        }
+        if (m_index && !resumed) {
+            m_index->DiscardCheckpoints(m_fileKey);
+        }
+        m_result.timings.seconds[static_cast<size_t>(LoadStage::Bind)] += Seconds(start);
+        m_begun = true;
+    }
+
+    void Checkpoint()
+    {
+        Clock::time_point start = Clock::now();
+        m_checkpoint.fileSize = m_result.timings.bytes;
+        m_checkpoint.contentHash = m_contentHash;
+        m_checkpoint.byteOffset = m_decoder.Position();
+        m_checkpoint.eventCount = m_result.eventCount;
+        m_checkpoint.audit = m_decoder.Audit();
+        m_checkpoint.recordErrors = m_decoder.RecordErrors();
+        m_sink.WriteCheckpoint(m_checkpoint);
+        if (m_index) {
+            m_index->Checkpoint(m_fileKey);
+        }
+        m_uncheckpointed = 0;
+        m_result.timings.seconds[static_cast<size_t>(LoadStage::Commit)] += Seconds(start);
+    }
+
+    // Index updates for the end of the file, made after the sink's.
+    void CommitIndex()
+    {
+        if (m_indexed) {
+            m_indexed = false;
+            m_index->CommitFile(m_fileKey);
+        }
+    }
+    void RollbackIndex()
+    {
+        if (m_indexed) {
+            m_indexed = false;
+            m_index->RollbackFile(m_fileKey);
+        }
+    }
+    void DiscardIndex()
+    {
+        if (m_indexed) {
+            m_indexed = false;
+            m_index->DiscardFile(m_fileKey);
+        }
+    }
+
+    bool Begun() const { return m_begun; }
+    bool Staged() const { return m_staged; }
+    int32_t TapDecimalPlaces() const { return m_tapDecimalPlaces; }
+
+private:
+    bool Loads(CallEventType type) const { return !m_projection || m_projection->Loads(type); }
+
+    // Returns batch without the records the decoder found severe errors in:
+    // they go back to the sender in the RAP file instead of being loaded.
+    // Their errors are the ones reported since the previous batch.
+    const EventBatch& WithoutRecordErrors(const EventBatch& batch)
+    {
+        const std::vector<RecordError>& errors = m_decoder.RecordErrors();
+        if (m_reportedErrors == errors.size()) {
+            return batch;
+        }
+        m_rejected.clear();
+        for (size_t i = m_reportedErrors; i < errors.size(); i++) {
+            m_rejected.push_back(errors[i].recordOffset);
+        }
+        m_reportedErrors = errors.size();
+        std::sort(m_rejected.begin(), m_rejected.end());
+        m_valid.AssignExcept(batch, m_rejected);
+        return m_valid;
+    }
+
+    // Returns batch without the events the index already knows.
+    const EventBatch& Deduplicate(const EventBatch& batch)
+    {
+        m_fingerprints.clear();
+        m_offsets.clear();
+        for (size_t i = 0; i < kCallEventTypeCount; i++) {
+            CallEventType type = static_cast<CallEventType>(i);
+            if (!Loads(type)) {
+                continue;
+            }
+            const EventColumns& columns = batch.Columns(type);
+            for (size_t row = 0; row < columns.Size(); row++) {
+                m_fingerprints.push_back(EventFingerprint(type, columns, row));
+                m_offsets.push_back(columns.recordOffset[row]);
+            }
+        }
+        m_index->AddEvents(m_fileKey, m_fingerprints, m_duplicate);
+        m_dropped.clear();
+        for (size_t i = 0; i < m_duplicate.size(); i++) {
+            if (m_duplicate[i]) {
+                m_dropped.push_back(m_offsets[i]);
+            }
+        }
+        if (m_dropped.empty()) {
+            return batch;
+        }
+        std::sort(m_dropped.begin(), m_dropped.end());
+        m_result.duplicateEventCount += m_dropped.size();
+        m_filtered.AssignExcept(batch, m_dropped);
+        return m_filtered;
+    }
+
+    EventSink& m_sink;
+    LoadResult& m_result;
+    TapDecoder& m_decoder;
+    uint64_t m_checkpointEvents;
+    DuplicateIndex* m_index;
+    const Projection* m_projection;
+    uint64_t m_fileKey;
+    bool m_begun;
+    bool m_staged;
+    bool m_indexed;                   // BeginFile done, end of file not yet reported to the index
+    uint64_t m_uncheckpointed;        // events written since the last checkpoint
+    LoadCheckpoint m_checkpoint;
+    uint64_t m_contentHash;
+    int32_t m_tapDecimalPlaces;
+    std::vector<uint64_t> m_fingerprints;   // of the events of the current batch
+    std::vector<uint64_t> m_offsets;        // their record offsets
+    std::vector<uint8_t> m_duplicate;
+    std::vector<uint64_t> m_dropped;
+    EventBatch m_filtered;
+    size_t m_reportedErrors;                // decoder record errors already left out of a batch
+    std::vector<uint64_t> m_rejected;       // record offsets of the current batch's errors
+    EventBatch m_valid;
+};
+
+} // namespace
+
+TapLoader::TapLoader(const LoaderSettings& settings)
+    : m_settings(settings), m_decoder(settings.decodeThreads, settings.decodeBatchSize)
+{
+    m_decoder.SetAuditValidation(settings.validateAudit);
+    if (settings.projection) {
+        // the duplicate index fingerprints these as well
+        FieldSet indexed = settings.duplicateIndex
+            ? FieldBit(EventField::Imsi) | FieldBit(EventField::OtherParty) | FieldBit(EventField::Duration)
+                | FieldBit(EventField::DataVolumeIncoming) | FieldBit(EventField::DataVolumeOutgoing)
+            : 0;
+        m_decoder.SetFields(settings.projection->Selection(indexed));
+    }
+}
+
+LoadResult TapLoader::LoadFile(const std::string& path, EventSink& sink)
+{
+    return Load(path, nullptr, sink);
+}
+
+LoadResult TapLoader::LoadFile(const MappedFile& file, EventSink& sink)
+{
+    return Load(file.Path(), &file, sink);
+}
+
+LoadResult TapLoader::Load(const std::string& path, const MappedFile* opened, EventSink& sink)
+{
+    LoadResult result;
+    result.file.fileName = path;
+    SinkHandler handler(sink, result, m_decoder, m_settings);
+    double* seconds = result.timings.seconds;
+    // the RAP file keeps its .tmp name until the sink has committed the file
+    std::string rapTemp;
+    try {
+        Clock::time_point start = Clock::now();
+        std::unique_ptr<MappedFile> mapped;
+        if (!opened) {
+            mapped.reset(new MappedFile(path));
+            opened = mapped.get();
+        }
+        const MappedFile& file = *opened;
+        result.timings.bytes = file.Size();
+        if (m_settings.checkpointEvents > 0) {
+            handler.SetContentHash(ContentFingerprint(file.View()));
+        }
+        seconds[static_cast<size_t>(LoadStage::Read)] = Seconds(start);
+        if (m_settings.preValidate) {
+            start = Clock::now();
+            PreValidate(file.View());
+            seconds[static_cast<size_t>(LoadStage::Validation)] = Seconds(start);
+        }
+        start = Clock::now();
+        m_decoder.Decode(file.View(), handler);
+        result.severeErrorCount = m_decoder.RecordErrors().size();
+        if (result.severeErrorCount > 0 && !m_settings.rapDirectory.empty()) {
+            WriteRap(file.View(), handler.TapDecimalPlaces(), result);
+            rapTemp = result.rapFile + ".tmp";
+        }
+        handler.Begin();
+        // sink calls made from the handler are accounted as Bind, checkpoints as Commit
+        seconds[static_cast<size_t>(LoadStage::Decode)] = Seconds(start) - seconds[static_cast<size_t>(LoadStage::Bind)]
+            - seconds[static_cast<size_t>(LoadStage::Commit)];
+        start = Clock::now();
+        if (handler.Staged()) {
+            sink.FinalizeFile();
+        }
+        else {
+            sink.CommitFile();
+        }
+        seconds[static_cast<size_t>(LoadStage::Commit)] += Seconds(start);
+    }
+    catch (const DatabaseError&) {
+        // committed chunks of a staged file stay for the next attempt
+        m_decoder.ReleaseArenas();
+        if (!rapTemp.empty()) {
+            unlink(rapTemp.c_str());
+        }
+        if (handler.Begun()) {
+            sink.RollbackFile();
+        }
+        handler.RollbackIndex();
+        if (m_settings.metrics) {
+            m_settings.metrics->RecordFile(result.file.sender, result.timings, false);
+        }
+        throw;
+    }
+    catch (...) {
+        m_decoder.ReleaseArenas();
+        if (!rapTemp.empty()) {
+            unlink(rapTemp.c_str());
+        }
+        if (handler.Staged()) {
+            sink.DiscardStagedFile();
+        }
+        else if (handler.Begun()) {
+            sink.RollbackFile();
+        }
+        handler.DiscardIndex();
+        if (m_settings.metrics) {
+            m_settings.metrics->RecordFile(result.file.sender, result.timings, false);
+        }
+        throw;
+    }
+    // all decode temporaries of the file go at once
+    m_decoder.ReleaseArenas();
+    handler.CommitIndex();
+    if (m_settings.metrics) {
+        m_settings.metrics->RecordFile(result.file.sender, result.timings, true);
+    }
+    if (!rapTemp.empty() && rename(rapTemp.c_str(), result.rapFile.c_str()) != 0) {
+        int err = errno;
+        unlink(rapTemp.c_str());
+        throw Tap3Error("File loaded, but unable to rename " + rapTemp + ": " + strerror(err));
+    }
+    return result;
+}
+
+void TapLoader::WriteRap(ByteView file, int32_t tapDecimalPlaces, LoadResult& result)
+{
+    RapBatchInfo info;
+    info.sender = result.file.recipient;
+    info.recipient = result.file.sender;
+    info.rapFileSequenceNumber = result.file.fileSequenceNumber;
+    info.fileSequenceNumber = result.file.fileSequenceNumber;
+    info.tapDecimalPlaces = tapDecimalPlaces;
+    info.specificationVersionNumber = result.file.specificationVersionNumber;
+    info.releaseVersionNumber = result.file.releaseVersionNumber;
+    result.rapFile = m_settings.rapDirectory + "/" + RapFileName(info);
+    WriteRapFile(result.rapFile + ".tmp", file, info, m_decoder.RecordErrors(), m_decoder.Tables());
+}
+
+} // namespace tap3
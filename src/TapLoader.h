@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include "DuplicateIndex.h"
+#include "EventSink.h"
+#include "MappedFile.h"
+#include "Metrics.h"
+#include "Projection.h"
+#include "TapDecoder.h"
+
+namespace tap3 {
+
+struct LoaderSettings
+{
+    size_t decodeThreads = 1;
+    size_t decodeBatchSize = 4096;
+    bool validateAudit = true;
+    // Run PreValidate before decoding, so fatal files are rejected before
+    // the sink starts a transaction.
+    bool preValidate = true;
+    // Records with severe errors are never loaded. When set, they are
+    // returned in a RAP file written here before the file is committed. RAP file sequence numbers
+    // are not tracked per partner yet; the TAP file sequence number is used.
+    std::string rapDirectory;
+    // Per-file stage timings and event counts are published here if set.
+    Metrics* metrics = nullptr;
+    // When non-zero and the sink supports staging, TransferBatch files are
+    // loaded in committed chunks of at least this many call events (whole
+    // decode batches) and resumed from the last checkpoint after a failure.
+    uint64_t checkpointEvents = 0;
+    // When set, files already loaded are rejected with DuplicateFileError
+    // and call events already loaded are left out of the sink.
+    DuplicateIndex* duplicateIndex = nullptr;
+    // When set, the decoder skips the numbers, durations and data volumes
+    // it does not load (charges, taxes and time stamps are always decoded
+    // for the AuditControlInfo check), and events of record types it does
+    // not load are neither counted nor indexed. The sink must be created
+    // with the same projection.
+    const Projection* projection = nullptr;
+};
+
+struct LoadResult
+{
+    FileInfo file;
+    uint64_t eventCount = 0;          // of the record types loaded
+    uint64_t severeErrorCount = 0;
+    std::string rapFile;          // empty if none was written
+    uint64_t resumedEventCount = 0;   // events loaded by earlier attempts
+    uint64_t duplicateEventCount = 0; // events left out as already loaded
+    FileTimings timings;
+};
+
+// Decodes TAP files and streams their call events into a sink. A file is
+// committed only when the whole file decoded successfully, otherwise the
+// sink is rolled back and the error rethrown. With checkpoints, a staged
+// file that fails with DatabaseError keeps its committed chunks for the
+// next attempt; any other error discards them. The duplicate index, if
+// any, follows the sink and records a file only once the sink committed it,
+// and so does the RAP file, which keeps a .tmp name until then.
+// The loader keeps its decoder (and decode thread pool) across files; the
+// sink is passed per file so sessions can come from a SessionPool.
+class TapLoader
+{
+public:
+    explicit TapLoader(const LoaderSettings& settings);
+
+    LoadResult LoadFile(const std::string& path, EventSink& sink);
+    // Loads a file the caller has opened already, e.g. an archive member.
+    LoadResult LoadFile(const MappedFile& file, EventSink& sink);
+
+private:
+    LoadResult Load(const std::string& path, const MappedFile* opened, EventSink& sink);
+    void WriteRap(ByteView file, int32_t tapDecimalPlaces, LoadResult& result);
+
+    LoaderSettings m_settings;
+    TapDecoder m_decoder;
+};
+
+} // namespace tap3
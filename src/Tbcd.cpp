@@ -0,0 +1,240 @@
+#include "Tbcd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAP3_X86_KERNELS 1
+#endif
+
+namespace tap3 {
+
+namespace {
+
+const char kDigits[] = "0123456789*#abc";
+
+size_t DecodeNibbles(ByteView value, char* out, size_t capacity, bool lowFirst)
+{
+    if (capacity == 0) {
+        return 0;
+    }
+    size_t count = 0;
+    for (uint8_t octet : value) {
+        uint8_t nibbles[2] = { static_cast<uint8_t>(octet & 0x0F), static_cast<uint8_t>(octet >> 4) };
+        if (!lowFirst) {
+            std::swap(nibbles[0], nibbles[1]);
+        }
+        for (uint8_t nibble : nibbles) {
+            if (nibble == 0x0F || count + 1 >= capacity) {
+                out[count] = 0;
+                return count;
+            }
+            out[count++] = kDigits[nibble];
+        }
+    }
+    out[count] = 0;
+    return count;
+}
+
+void DecodeColumnScalar(const BytesColumn& column, size_t first, size_t count, NibbleOrder order,
+    char* out, size_t width)
+{
+    bool lowFirst = order == NibbleOrder::LowFirst;
+    for (size_t i = 0; i < count; i++) {
+        DecodeNibbles(column.At(first + i), out + i * width, width, lowFirst);
+    }
+}
+
+#ifdef TAP3_X86_KERNELS
+
+// Values are copied into a 16-byte block padded with filler octets, so the
+// kernels never read past the column buffer and stop at the value end.
+inline void LoadPadded(ByteView value, uint8_t* block)
+{
+    memset(block, 0xFF, 16);
+    if (value.size > 0) {
+        // an empty column has no buffer
+        memcpy(block, value.data, value.size);
+    }
+}
+
+// Copies the digits expanded from one value: up to the first filler
+// nibble, at most 2 * size digits and at most width - 1 characters.
+inline void StoreDigits(const char* digits, uint32_t fillerMask, size_t size, char* out, size_t width)
+{
+    size_t length = fillerMask ? static_cast<size_t>(__builtin_ctz(fillerMask)) : 32;
+    length = std::min(length, std::min(size * 2, width - 1));
+    memcpy(out, digits, length);
+    out[length] = 0;
+}
+
+__attribute__((target("ssse3")))
+void ExpandSsse3(const uint8_t* block, bool lowFirst, char* digits, uint32_t& fillerMask)
+{
+    const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits));
+    const __m128i low = _mm_set1_epi8(0x0F);
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    __m128i lo = _mm_and_si128(v, low);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low);
+    __m128i first = lowFirst ? lo : hi;
+    __m128i second = lowFirst ? hi : lo;
+    __m128i n0 = _mm_unpacklo_epi8(first, second);
+    __m128i n1 = _mm_unpackhi_epi8(first, second);
+    fillerMask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(n0, low)))
+        | (static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(n1, low))) << 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(digits), _mm_shuffle_epi8(table, n0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(digits + 16), _mm_shuffle_epi8(table, n1));
+}
+
+__attribute__((target("ssse3")))
+void DecodeColumnSsse3(const BytesColumn& column, size_t first, size_t count, NibbleOrder order,
+    char* out, size_t width)
+{
+    bool lowFirst = order == NibbleOrder::LowFirst;
+    alignas(16) uint8_t block[16];
+    alignas(16) char digits[32];
+    for (size_t i = 0; i < count; i++) {
+        ByteView value = column.At(first + i);
+        char* slot = out + i * width;
+        if (value.size > 16) {
+            DecodeNibbles(value, slot, width, lowFirst);
+            continue;
+        }
+        LoadPadded(value, block);
+        uint32_t fillerMask;
+        ExpandSsse3(block, lowFirst, digits, fillerMask);
+        StoreDigits(digits, fillerMask, value.size, slot, width);
+    }
+}
+
+// Two values per iteration, one in each 128-bit lane; every instruction
+// used works within lanes, so each lane is the SSSE3 kernel.
+__attribute__((target("avx2")))
+void DecodeColumnAvx2(const BytesColumn& column, size_t first, size_t count, NibbleOrder order,
+    char* out, size_t width)
+{
+    bool lowFirst = order == NibbleOrder::LowFirst;
+    const __m256i table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits)));
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    alignas(32) uint8_t blocks[32];
+    alignas(32) char digits[64];
+    size_t i = 0;
+    while (i < count) {
+        ByteView a = column.At(first + i);
+        ByteView b = i + 1 < count ? column.At(first + i + 1) : ByteView();
+        if (a.size > 16 || b.size > 16 || i + 1 >= count) {
+            DecodeColumnSsse3(column, first + i, 1, order, out + i * width, width);
+            i++;
+            continue;
+        }
+        LoadPadded(a, blocks);
+        LoadPadded(b, blocks + 16);
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(blocks));
+        __m256i lo = _mm256_and_si256(v, low);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+        __m256i firstNibbles = lowFirst ? lo : hi;
+        __m256i secondNibbles = lowFirst ? hi : lo;
+        // lane 0: digits 0-15 / 16-31 of a; lane 1: the same of b
+        __m256i n0 = _mm256_unpacklo_epi8(firstNibbles, secondNibbles);
+        __m256i n1 = _mm256_unpackhi_epi8(firstNibbles, secondNibbles);
+        uint32_t filler0 = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(n0, low)));
+        uint32_t filler1 = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(n1, low)));
+        __m256i d0 = _mm256_shuffle_epi8(table, n0);
+        __m256i d1 = _mm256_shuffle_epi8(table, n1);
+        // regroup to a's 32 digits followed by b's 32 digits
+        _mm256_store_si256(reinterpret_cast<__m256i*>(digits), _mm256_permute2x128_si256(d0, d1, 0x20));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(digits + 32), _mm256_permute2x128_si256(d0, d1, 0x31));
+        uint32_t fillerA = (filler0 & 0xFFFF) | ((filler1 & 0xFFFF) << 16);
+        uint32_t fillerB = (filler0 >> 16) | (filler1 & 0xFFFF0000);
+        StoreDigits(digits, fillerA, a.size, out + i * width, width);
+        StoreDigits(digits + 32, fillerB, b.size, out + (i + 1) * width, width);
+        i += 2;
+    }
+}
+
+#endif // TAP3_X86_KERNELS
+
+typedef void (*ColumnKernel)(const BytesColumn&, size_t, size_t, NibbleOrder, char*, size_t);
+
+struct KernelChoice
+{
+    ColumnKernel kernel;
+    const char* name;
+};
+
+// Kernels the CPU runs, fastest first.
+std::vector<KernelChoice> SupportedKernels()
+{
+    std::vector<KernelChoice> kernels;
+#ifdef TAP3_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({ DecodeColumnAvx2, "avx2" });
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        kernels.push_back({ DecodeColumnSsse3, "ssse3" });
+    }
+#endif
+    kernels.push_back({ DecodeColumnScalar, "scalar" });
+    return kernels;
+}
+
+KernelChoice& Kernel()
+{
+    static KernelChoice choice = SupportedKernels().front();
+    return choice;
+}
+
+} // namespace
+
+size_t DecodeTbcd(ByteView value, char* out, size_t capacity)
+{
+    return DecodeNibbles(value, out, capacity, true);
+}
+
+size_t DecodeBcd(ByteView value, char* out, size_t capacity)
+{
+    return DecodeNibbles(value, out, capacity, false);
+}
+
+void DecodeNumberColumn(const BytesColumn& column, size_t first, size_t count, NibbleOrder order,
+    char* out, size_t width)
+{
+    if (width == 0) {
+        return;
+    }
+    Kernel().kernel(column, first, count, order, out, width);
+}
+
+size_t EncodeDigits(const char* digits, size_t count, NibbleOrder order, uint8_t* out)
+{
+    size_t size = (count + 1) / 2;
+    for (size_t i = 0; i < size; i++) {
+        uint8_t first = static_cast<uint8_t>(digits[i * 2] - '0');
+        uint8_t second = i * 2 + 1 < count ? static_cast<uint8_t>(digits[i * 2 + 1] - '0') : 0x0f;
+        out[i] = order == NibbleOrder::LowFirst ? static_cast<uint8_t>(second << 4 | first)
+            : static_cast<uint8_t>(first << 4 | second);
+    }
+    return size;
+}
+
+const char* NumberKernelName()
+{
+    return Kernel().name;
+}
+
+bool SelectNumberKernel(const std::string& name)
+{
+    for (const KernelChoice& kernel : SupportedKernels()) {
+        if (name == kernel.name) {
+            Kernel() = kernel;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace tap3
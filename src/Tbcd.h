@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "ByteView.h"
+#include "EventColumns.h"
+
+namespace tap3 {
+
+// Digit string conversion of TAP number fields. TBCD (Imsi) stores the
+// first digit in the low nibble, BCD (Msisdn, Imei, CalledNumber) in the
+// high nibble. A filler nibble 0xF ends the number. Digits are written to
+// out (at most capacity - 1 of them) followed by a terminating zero;
+// the number of digits written is returned.
+size_t DecodeTbcd(ByteView value, char* out, size_t capacity);
+size_t DecodeBcd(ByteView value, char* out, size_t capacity);
+
+enum class NibbleOrder
+{
+    LowFirst,       // TBCD
+    HighFirst       // BCD
+};
+
+// Bulk conversion of rows [first, first + count) of a number column into
+// fixed-width zero-terminated slots out[0], out[width], ... Uses AVX2 or
+// SSSE3 kernels when the CPU has them and gives exactly the scalar result.
+void DecodeNumberColumn(const BytesColumn& column, size_t first, size_t count, NibbleOrder order,
+    char* out, size_t width);
+
+// Packs count decimal digits into out ((count + 1) / 2 bytes, an odd
+// count padded with a filler nibble); the inverse of DecodeTbcd/DecodeBcd.
+// Returns the number of bytes written.
+size_t EncodeDigits(const char* digits, size_t count, NibbleOrder order, uint8_t* out);
+
+// Name of the kernel DecodeNumberColumn dispatches to ("avx2", "ssse3" or
+// "scalar").
+const char* NumberKernelName();
+
+// Makes DecodeNumberColumn use the named kernel instead, e.g. to compare
+// the kernels in tests. Returns false if the CPU does not support it. Not
+// safe while other threads decode.
+bool SelectNumberKernel(const std::string& name);
+
+} // namespace tap3
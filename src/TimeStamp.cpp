@@ -0,0 +1,68 @@
+#include "TimeStamp.h"
+
+namespace tap3 {
+
+namespace {
+
+// Days per month; index 0 stands in for an invalid month, which is rejected
+// anyway.
+const uint8_t kMonthDays[13] = { 31, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+// UTC offsets of TD.57 lie within -1400..+1400.
+const int32_t kMaxUtcOffset = 14 * 3600;
+
+} // namespace
+
+int64_t DaysFromCivil(int64_t year, uint32_t month, uint32_t day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t yearOfEra = static_cast<uint32_t>(year - era * 400);
+    uint32_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+bool ParseLocalTimeStamp(ByteView value, int64_t& seconds)
+{
+    if (value.size != 14) {
+        return false;
+    }
+    uint32_t d[14];
+    uint32_t bad = 0;
+    for (int i = 0; i < 14; i++) {
+        d[i] = static_cast<uint32_t>(value[i]) - '0';
+        bad |= d[i] > 9;
+    }
+    uint32_t year = d[0] * 1000 + d[1] * 100 + d[2] * 10 + d[3];
+    uint32_t month = d[4] * 10 + d[5];
+    uint32_t day = d[6] * 10 + d[7];
+    uint32_t hour = d[8] * 10 + d[9];
+    uint32_t minute = d[10] * 10 + d[11];
+    uint32_t second = d[12] * 10 + d[13];
+    uint32_t leap = (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+    uint32_t monthDays = kMonthDays[month <= 12 ? month : 0] + (month == 2 ? leap : 0);
+    bad |= (month - 1 > 11) | (day - 1 >= monthDays) | (hour > 23) | (minute > 59) | (second > 59);
+    seconds = DaysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    return bad == 0;
+}
+
+bool ParseUtcTimeOffset(ByteView value, int32_t& seconds)
+{
+    if (value.size != 5 || (value[0] != '+' && value[0] != '-')) {
+        return false;
+    }
+    uint32_t d[4];
+    uint32_t bad = 0;
+    for (int i = 0; i < 4; i++) {
+        d[i] = static_cast<uint32_t>(value[i + 1]) - '0';
+        bad |= d[i] > 9;
+    }
+    uint32_t minutes = d[2] * 10 + d[3];
+    int32_t magnitude = static_cast<int32_t>((d[0] * 10 + d[1]) * 3600 + minutes * 60);
+    bad |= (minutes > 59) | (magnitude > kMaxUtcOffset);
+    seconds = value[0] == '-' ? -magnitude : magnitude;
+    return bad == 0;
+}
+
+} // namespace tap3
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include "ByteView.h"
+
+namespace tap3 {
+
+// Fixed-width timestamp parsing without libc: no strptime, mktime, locale
+// or TZ, so it is thread-safe and does not branch on the input digits.
+
+// "YYYYMMDDHHMMSS" to seconds since 1970-01-01 in the same local time.
+// Returns false (and leaves seconds undefined) on malformed input.
+bool ParseLocalTimeStamp(ByteView value, int64_t& seconds);
+
+// "+HHMM" / "-HHMM" to seconds east of UTC. Returns false on malformed
+// input, minutes above 59 or an offset beyond 14 hours.
+bool ParseUtcTimeOffset(ByteView value, int32_t& seconds);
+
+// Days since 1970-01-01 of a proleptic Gregorian date.
+int64_t DaysFromCivil(int64_t year, uint32_t month, uint32_t day);
+
+} // namespace tap3
@@ -0,0 +1,245 @@
+// Loads a generated TAP file into FlatFileSink and checks the partition
+// layout, the CSV quoting of a sender and file name holding separators and
+// quotes, the row counts against the generator, and that a commit failing
+// at the tap_file row leaves no files behind.
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "FlatFileSink.h"
+#include "Tap3Error.h"
+#include "TapGenerator.h"
+#include "TapLoader.h"
+
+using namespace tap3;
+
+namespace {
+
+int failures = 0;
+
+const char kSender[] = "A,\"BC";
+const char kSenderDirectory[] = "A__BC";
+const char kSenderCsv[] = "\"A,\"\"BC\"";
+const char kStem[] = "BBBBB_00001";
+
+void Check(bool condition, const std::string& what)
+{
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+void CheckEqual(int64_t actual, int64_t expected, const std::string& what)
+{
+    Check(actual == expected, what + ": " + std::to_string(actual) + ", expected " + std::to_string(expected));
+}
+
+// Regular files below directory, as paths relative to it.
+void ListFiles(const std::string& directory, const std::string& relative, std::vector<std::string>& files)
+{
+    DIR* dir = opendir((directory + "/" + relative).c_str());
+    if (!dir) {
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        std::string path = relative.empty() ? name : relative + "/" + name;
+        struct stat st;
+        if (stat((directory + "/" + path).c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            ListFiles(directory, path, files);
+        }
+        else {
+            files.push_back(path);
+        }
+    }
+    closedir(dir);
+}
+
+void RemoveTree(const std::string& path)
+{
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        if (DIR* dir = opendir(path.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..") {
+                    RemoveTree(path + "/" + name);
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(path.c_str());
+    }
+    else {
+        unlink(path.c_str());
+    }
+}
+
+std::vector<std::string> ReadLines(const std::string& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+std::vector<std::string> Split(const std::string& path)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', start)) {
+        parts.push_back(path.substr(start, slash - start));
+        start = slash + 1;
+    }
+    parts.push_back(path.substr(start));
+    return parts;
+}
+
+std::string CsvText(const std::string& value)
+{
+    std::string quoted = "\"";
+    for (char c : value) {
+        quoted += c == '"' ? "\"\"" : std::string(1, c);
+    }
+    return quoted + "\"";
+}
+
+LoadResult Load(const std::string& output, const std::string& tapFile)
+{
+    FlatFileSink sink(output, FlatFileFormat::Csv, 1000);
+    TapLoader loader{ LoaderSettings() };
+    return loader.LoadFile(tapFile, sink);
+}
+
+void TestLayout(const std::string& output, const std::string& tapFile, const GeneratorResult& generated)
+{
+    LoadResult result = Load(output, tapFile);
+    CheckEqual(static_cast<int64_t>(result.eventCount), static_cast<int64_t>(generated.recordCount), "loaded events");
+
+    std::set<std::string> typeNames;
+    for (size_t type = 0; type < kCallEventTypeCount; type++) {
+        typeNames.insert(CallEventTypeName(static_cast<CallEventType>(type)));
+    }
+    const std::string eventFile = std::string(kStem) + ".csv";
+    const std::string prefix = std::string(kSenderCsv) + ",00001,";
+    std::vector<std::string> files;
+    ListFiles(output, "", files);
+    int64_t eventRows = 0;
+    bool fileRow = false;
+    for (const std::string& file : files) {
+        std::vector<std::string> parts = Split(file);
+        std::vector<std::string> lines = ReadLines(output + "/" + file);
+        Check(!lines.empty(), file + ": header line");
+        if (parts.size() == 3 && parts[0] == "tap_file") {
+            Check(parts[1] == kSenderDirectory && parts[2] == eventFile, file + ": tap_file path");
+            CheckEqual(static_cast<int64_t>(lines.size()), 2, file + " lines");
+            if (lines.size() == 2) {
+                std::string expected = CsvText(tapFile) + "," + kSenderCsv + ",BBBBB,00001,";
+                std::string count = "," + std::to_string(generated.recordCount);
+                Check(lines[1].compare(0, expected.size(), expected) == 0, file + ": row starts with "
+                    + expected + ": " + lines[1]);
+                Check(lines[1].size() > count.size()
+                    && lines[1].compare(lines[1].size() - count.size(), count.size(), count) == 0,
+                    file + ": row ends with the event count: " + lines[1]);
+                fileRow = true;
+            }
+            continue;
+        }
+        bool dated = parts.size() == 4 && parts[0].size() == 8
+            && parts[0].find_first_not_of("0123456789") == std::string::npos;
+        Check(dated && parts[1] == kSenderDirectory && typeNames.count(parts[2]) > 0
+            && (parts[3] == eventFile || parts[3] == std::string(kStem) + ".charge_detail.csv"
+                || parts[3] == std::string(kStem) + ".tax_information.csv"), file + ": partition path");
+        for (size_t i = 1; i < lines.size(); i++) {
+            Check(lines[i].compare(0, prefix.size(), prefix) == 0, file + ": row starts with " + prefix);
+        }
+        if (dated && parts[3] == eventFile) {
+            eventRows += static_cast<int64_t>(lines.size()) - 1;
+            // record_type,record_offset,local_time_stamp after the prefix
+            for (size_t i = 1; i < lines.size(); i++) {
+                size_t timeStamp = lines[i].find(',', lines[i].find(',', prefix.size()) + 1) + 1;
+                Check(lines[i].compare(timeStamp, 8, parts[0]) == 0, file + ": call date of " + lines[i]);
+            }
+        }
+    }
+    Check(fileRow, "tap_file row written");
+    CheckEqual(eventRows, static_cast<int64_t>(generated.recordCount), "event rows");
+}
+
+// A directory where the tap_file row goes makes its rename fail after all
+// partition files were renamed into place.
+void TestCommitFailure(const std::string& output, const std::string& tapFile, const GeneratorResult& generated)
+{
+    std::string blocker = output + "/tap_file/" + kSenderDirectory + "/" + kStem + ".csv";
+    for (const std::string& directory : { output, output + "/tap_file", output + "/tap_file/" + kSenderDirectory,
+             blocker }) {
+        mkdir(directory.c_str(), 0755);
+    }
+    bool failed = false;
+    try {
+        Load(output, tapFile);
+    }
+    catch (const Tap3Error&) {
+        failed = true;
+    }
+    Check(failed, "commit fails when the tap_file row cannot be renamed");
+    std::vector<std::string> files;
+    ListFiles(output, "", files);
+    CheckEqual(static_cast<int64_t>(files.size()), 0, "files left by the failed commit");
+    for (const std::string& file : files) {
+        fprintf(stderr, "  left: %s\n", file.c_str());
+    }
+
+    rmdir(blocker.c_str());
+    LoadResult result = Load(output, tapFile);
+    CheckEqual(static_cast<int64_t>(result.eventCount), static_cast<int64_t>(generated.recordCount),
+        "events loaded after the failed commit");
+}
+
+} // namespace
+
+int main()
+{
+    const char* tmp = getenv("TMPDIR");
+    std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/FlatFileSinkTest.XXXXXX";
+    if (!mkdtemp(&pattern[0])) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const std::string directory = pattern;
+    const std::string tapFile = directory + "/CD,\"x\"00001";
+    try {
+        GeneratorSettings generator;
+        generator.recordCount = 3000;
+        generator.days = 3;
+        generator.sender = kSender;
+        GeneratorResult generated = GenerateTapFile(tapFile, generator);
+
+        TestLayout(directory + "/layout", tapFile, generated);
+        TestCommitFailure(directory + "/rollback", tapFile, generated);
+    }
+    catch (const std::exception& ex) {
+        fprintf(stderr, "FAILED: %s\n", ex.what());
+        failures++;
+    }
+    RemoveTree(directory);
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
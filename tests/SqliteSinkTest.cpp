@@ -0,0 +1,123 @@
+// Loads a generated TAP file into SqliteSink, sequentially and with
+// parallel decoding in checkpointed chunks, and checks the row counts and
+// totals in the database against the generator.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sqlite3.h>
+#include <unistd.h>
+
+#include "SqliteSink.h"
+#include "Tap3Error.h"
+#include "TapGenerator.h"
+#include "TapLoader.h"
+
+using namespace tap3;
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const std::string& what)
+{
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+int64_t QueryInt(const std::string& database, const std::string& sql)
+{
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(database.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        sqlite3_close(db);
+        throw Tap3Error("Unable to open " + database);
+    }
+    sqlite3_stmt* stmt = nullptr;
+    int64_t value = -1;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return value;
+}
+
+void CheckEqual(int64_t actual, int64_t expected, const std::string& what)
+{
+    Check(actual == expected, what + ": " + std::to_string(actual) + ", expected " + std::to_string(expected));
+}
+
+void TestLoad(const std::string& directory, const std::string& name, const LoaderSettings& settings,
+    const std::string& tapFile, const GeneratorResult& generated)
+{
+    std::string database = directory + "/" + name + ".db";
+    LoadResult result;
+    {
+        SqliteSink sink(database, 1000);
+        TapLoader loader(settings);
+        result = loader.LoadFile(tapFile, sink);
+    }
+    CheckEqual(static_cast<int64_t>(result.eventCount), static_cast<int64_t>(generated.recordCount),
+        name + " loaded events");
+    CheckEqual(QueryInt(database, "SELECT count(*) FROM tap_file"), 1, name + " tap_file rows");
+    CheckEqual(QueryInt(database, "SELECT count(*) FROM call_event"), static_cast<int64_t>(generated.recordCount),
+        name + " call_event rows");
+    CheckEqual(QueryInt(database, "SELECT count(DISTINCT record_offset) FROM call_event"),
+        static_cast<int64_t>(generated.recordCount), name + " distinct record offsets");
+    CheckEqual(QueryInt(database, "SELECT sum(charge) FROM call_event"), generated.totalCharge,
+        name + " call_event charge total");
+    CheckEqual(QueryInt(database, "SELECT total_charge FROM audit_total"), generated.totalCharge,
+        name + " audit_total total_charge");
+    CheckEqual(QueryInt(database, "SELECT call_event_details_count FROM audit_total"),
+        static_cast<int64_t>(generated.recordCount), name + " audit_total event count");
+    CheckEqual(QueryInt(database, "SELECT sum(tax_value) FROM tax_information"),
+        QueryInt(database, "SELECT total_tax_value FROM audit_total"), name + " tax total");
+    CheckEqual(QueryInt(database, "SELECT count(*) FROM charge_detail WHERE record_offset NOT IN"
+        " (SELECT record_offset FROM call_event)"), 0, name + " charge rows without an event");
+    CheckEqual(QueryInt(database, "SELECT count(*) FROM call_event_stage"), 0, name + " staged rows left");
+    for (const char* suffix : { "", "-wal", "-shm" }) {
+        unlink((database + suffix).c_str());
+    }
+}
+
+} // namespace
+
+int main()
+{
+    const char* tmp = getenv("TMPDIR");
+    std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/SqliteSinkTest.XXXXXX";
+    if (!mkdtemp(&pattern[0])) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const std::string directory = pattern;
+    const std::string tapFile = directory + "/CDBBBBBAAAAA00001";
+    try {
+        GeneratorSettings generator;
+        generator.recordCount = 5000;
+        generator.days = 3;
+        GeneratorResult generated = GenerateTapFile(tapFile, generator);
+
+        LoaderSettings sequential;
+        TestLoad(directory, "sequential", sequential, tapFile, generated);
+
+        LoaderSettings staged;
+        staged.decodeThreads = 4;
+        staged.decodeBatchSize = 512;
+        staged.checkpointEvents = 1000;
+        TestLoad(directory, "staged", staged, tapFile, generated);
+    }
+    catch (const std::exception& ex) {
+        fprintf(stderr, "FAILED: %s\n", ex.what());
+        failures++;
+    }
+    unlink(tapFile.c_str());
+    rmdir(directory.c_str());
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
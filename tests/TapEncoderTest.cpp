@@ -0,0 +1,165 @@
+// Round trip of generated TransferBatch files: decode the headers and
+// AuditControlInfo with TapDecoder, re-encode them with TapEncoder around
+// the call events copied from the source, and compare the two files byte
+// for byte.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "BerReader.h"
+#include "MappedFile.h"
+#include "RecordScanner.h"
+#include "Tap3Error.h"
+#include "Tap3Tags.h"
+#include "TapDecoder.h"
+#include "TapEncoder.h"
+#include "TapGenerator.h"
+
+using namespace tap3;
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const std::string& what)
+{
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+// Keeps the decoded header blocks; their views point into the mapped file.
+class HeaderHandler : public TapHandler
+{
+public:
+    void OnBatchControlInfo(const BatchControlInfo& info) override { header.batchControlInfo = info; }
+    void OnAccountingInfo(const AccountingInfo& info) override { header.accountingInfo = info; }
+    void OnNetworkInfo(const NetworkInfo& info) override { header.networkInfo = info; }
+    void OnMessageDescriptionInfo(const std::vector<MessageDescriptionInfo>& info) override
+    {
+        header.messageDescriptionInfo = info;
+    }
+    void OnEventBatch(const EventBatch& batch) override
+    {
+        for (size_t type = 0; type < kCallEventTypeCount; type++) {
+            const EventColumns& columns = batch.Columns(static_cast<CallEventType>(type));
+            recordOffsets.insert(recordOffsets.end(), columns.recordOffset.begin(), columns.recordOffset.end());
+        }
+    }
+    void OnAuditControlInfo(const AuditControlInfo& info) override { audit = info; }
+
+    TransferBatchHeader header;
+    AuditControlInfo audit;
+    std::vector<uint64_t> recordOffsets;
+};
+
+// The encoded CallEventDetailList of a TransferBatch file.
+BerTlv CallEventDetailList(ByteView file)
+{
+    BerReader top(file);
+    BerTlv batch;
+    if (!top.Next(batch) || !batch.IsApplication(tag::TransferBatch)) {
+        throw Tap3Error("Not a TransferBatch");
+    }
+    BerReader blocks = top.Enter(batch);
+    BerTlv block;
+    while (blocks.Next(block)) {
+        if (block.IsApplication(tag::CallEventDetailList)) {
+            block.offset += blocks.BaseOffset();
+            return block;
+        }
+    }
+    throw Tap3Error("No CallEventDetailList");
+}
+
+void TestRoundTrip(const std::string& directory, const std::string& name, const GeneratorSettings& settings)
+{
+    std::string sourcePath = directory + "/" + name + ".tap";
+    std::string encodedPath = directory + "/" + name + ".encoded.tap";
+    GenerateTapFile(sourcePath, settings);
+    {
+        MappedFile source(sourcePath);
+        HeaderHandler handler;
+        TapDecoder decoder;
+        decoder.Decode(source.View(), handler);
+
+        BerTlv list = CallEventDetailList(source.View());
+        std::vector<RecordSpan> records;
+        ScanRecordBoundaries(list.value, list.offset + list.header.headerLength, records);
+        Check(records.size() == settings.recordCount, name + ": " + std::to_string(records.size()) + " records");
+        std::sort(handler.recordOffsets.begin(), handler.recordOffsets.end());
+        bool sameOffsets = handler.recordOffsets.size() == records.size();
+        for (size_t i = 0; sameOffsets && i < records.size(); i++) {
+            sameOffsets = handler.recordOffsets[i] == records[i].offset;
+        }
+        Check(sameOffsets, name + ": decoded record offsets match the record boundaries");
+
+        OutputFile output(encodedPath);
+        TapEncoder encoder(output);
+        encoder.BeginTransferBatch(handler.header, list.value.size, handler.audit);
+        for (const RecordSpan& record : records) {
+            encoder.WriteCallEvent(source.View().Sub(record.offset, record.length));
+        }
+        encoder.EndTransferBatch();
+        output.Commit();
+
+        MappedFile encoded(encodedPath);
+        ByteView a = source.View();
+        ByteView b = encoded.View();
+        size_t common = std::min(a.size, b.size);
+        size_t mismatch = std::mismatch(a.data, a.data + common, b.data).first - a.data;
+        Check(a.size == b.size && mismatch == common, name + ": re-encoded file differs at byte "
+            + std::to_string(mismatch) + " (sizes " + std::to_string(a.size) + " and " + std::to_string(b.size) + ")");
+    }
+    unlink(sourcePath.c_str());
+    unlink(encodedPath.c_str());
+}
+
+} // namespace
+
+int main()
+{
+    const char* tmp = getenv("TMPDIR");
+    std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/TapEncoderTest.XXXXXX";
+    if (!mkdtemp(&pattern[0])) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const std::string directory = pattern;
+    try {
+        GeneratorSettings tap312;
+        tap312.recordCount = 3000;
+        tap312.days = 2;
+        TestRoundTrip(directory, "tap312", tap312);
+
+        GeneratorSettings tap311;
+        tap311.recordCount = 2000;
+        tap311.seed = 11;
+        tap311.releaseVersionNumber = 11;
+        tap311.camelPercent = 50;
+        tap311.maxChargeDetails = 5;
+        tap311.utcOffsetCodes = 5;
+        tap311.taxCodes = 4;
+        TestRoundTrip(directory, "tap311", tap311);
+
+        GeneratorSettings empty;
+        empty.recordCount = 0;
+        TestRoundTrip(directory, "empty", empty);
+    }
+    catch (const std::exception& ex) {
+        fprintf(stderr, "FAILED: %s\n", ex.what());
+        failures++;
+    }
+    rmdir(directory.c_str());
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Compares every number kernel the CPU supports with the scalar
+// DecodeTbcd/DecodeBcd on random values: lengths up to past the 16-octet
+// SIMD block, filler nibbles anywhere, slots narrower and wider than the
+// digits, odd row counts and offsets for the two-row AVX2 steps.
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Tbcd.h"
+
+using namespace tap3;
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const std::string& what)
+{
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+std::string Hex(ByteView value)
+{
+    std::string hex;
+    char octet[3];
+    for (uint8_t b : value) {
+        snprintf(octet, sizeof(octet), "%02x", b);
+        hex += octet;
+    }
+    return hex;
+}
+
+BytesColumn RandomColumn(std::mt19937& random, size_t rows)
+{
+    BytesColumn column;
+    std::vector<uint8_t> value;
+    for (size_t row = 0; row < rows; row++) {
+        value.resize(random() % 21);
+        for (uint8_t& octet : value) {
+            // mostly digits, sometimes a filler or one of *#abc
+            uint8_t low = random() % 8 == 0 ? static_cast<uint8_t>(10 + random() % 6) : static_cast<uint8_t>(random() % 10);
+            uint8_t high = random() % 8 == 0 ? static_cast<uint8_t>(10 + random() % 6) : static_cast<uint8_t>(random() % 10);
+            octet = static_cast<uint8_t>(high << 4 | low);
+        }
+        column.Append(ByteView(value.data(), value.size()));
+    }
+    return column;
+}
+
+void CompareKernel(const std::string& kernel, const BytesColumn& column, size_t first, size_t count,
+    NibbleOrder order, size_t width)
+{
+    std::vector<char> slots(count * width, 'x');
+    DecodeNumberColumn(column, first, count, order, slots.data(), width);
+    std::vector<char> expected(width);
+    for (size_t i = 0; i < count; i++) {
+        ByteView value = column.At(first + i);
+        if (order == NibbleOrder::LowFirst) {
+            DecodeTbcd(value, expected.data(), width);
+        }
+        else {
+            DecodeBcd(value, expected.data(), width);
+        }
+        const char* slot = slots.data() + i * width;
+        Check(strcmp(slot, expected.data()) == 0, kernel + (order == NibbleOrder::LowFirst ? " TBCD " : " BCD ")
+            + Hex(value) + " width " + std::to_string(width) + ": '" + slot + "', expected '" + expected.data() + "'");
+    }
+}
+
+void TestKernel(const std::string& kernel)
+{
+    if (!SelectNumberKernel(kernel)) {
+        printf("%s: not supported by this CPU, skipped\n", kernel.c_str());
+        return;
+    }
+    Check(kernel == NumberKernelName(), "selected kernel " + kernel);
+    std::mt19937 random(8);
+    for (int round = 0; round < 2000; round++) {
+        BytesColumn column = RandomColumn(random, 1 + random() % 9);
+        size_t first = random() % column.Size();
+        size_t count = column.Size() - first;
+        size_t width = 1 + random() % 45;
+        CompareKernel(kernel, column, first, count, NibbleOrder::LowFirst, width);
+        CompareKernel(kernel, column, first, count, NibbleOrder::HighFirst, width);
+    }
+    // only empty values: the column has no buffer at all
+    BytesColumn empty;
+    for (int i = 0; i < 3; i++) {
+        empty.Append(ByteView());
+    }
+    CompareKernel(kernel, empty, 0, empty.Size(), NibbleOrder::LowFirst, 16);
+    CompareKernel(kernel, empty, 0, empty.Size(), NibbleOrder::HighFirst, 16);
+}
+
+void TestEncodeDigits()
+{
+    const char digits[] = "310150123456789";
+    for (size_t count = 0; count <= strlen(digits); count++) {
+        for (NibbleOrder order : { NibbleOrder::LowFirst, NibbleOrder::HighFirst }) {
+            uint8_t packed[8];
+            size_t size = EncodeDigits(digits, count, order, packed);
+            char decoded[32];
+            size_t length = order == NibbleOrder::LowFirst ? DecodeTbcd(ByteView(packed, size), decoded, sizeof(decoded))
+                : DecodeBcd(ByteView(packed, size), decoded, sizeof(decoded));
+            Check(length == count && std::string(decoded) == std::string(digits, count),
+                "EncodeDigits round trip of " + std::string(digits, count));
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    for (const char* kernel : { "scalar", "ssse3", "avx2" }) {
+        TestKernel(kernel);
+    }
+    TestEncodeDigits();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
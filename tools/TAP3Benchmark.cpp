@@ -0,0 +1,394 @@
+// Per-stage throughput benchmark over generated TAP files. Built like
+// TAP3Generator, from all of src/ except TAP3Loader.cpp:
+//   g++ -std=c++17 -O2 -pthread -I../src -o TAP3Benchmark TAP3Benchmark.cpp
+//       $(ls ../src/*.cpp | grep -v TAP3Loader.cpp) -lsqlite3 -lz
+// adding -lzstd when <zstd.h> is installed (zstd input is compiled in then).
+//
+// Stages, each run separately on every file size:
+//   validation   PreValidate (fatal error checks and BER structure scan)
+//   decode       TapDecoder into column batches, handler does nothing
+//   transform    column batches to bind arrays (ArrayBindSink, no database)
+//   sink         SqliteSink; only the time spent inside the sink counts
+//   end_to_end   TapLoader::LoadFile into SqliteSink, wall time
+// Results are printed and written as JSON for comparison between builds.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "ArrayBindSink.h"
+#include "MappedFile.h"
+#include "PreValidator.h"
+#include "SqliteSink.h"
+#include "Tap3Error.h"
+#include "TapDecoder.h"
+#include "TapGenerator.h"
+#include "TapLoader.h"
+#include "Tbcd.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations(0);
+
+} // namespace
+
+// Counting global allocator: allocations per event are a regression signal
+// of their own, independent of timer noise. Allocations made by SQLite
+// through malloc are not seen.
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size > 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+using namespace tap3;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double Seconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Peak RSS is reset before every stage run (Linux clear_refs), so VmHWM
+// afterwards is the peak of that run alone.
+void ResetPeakRss()
+{
+    if (FILE* f = fopen("/proc/self/clear_refs", "w")) {
+        fputs("5", f);
+        fclose(f);
+    }
+}
+
+uint64_t PeakRssKb()
+{
+    uint64_t peak = 0;
+    if (FILE* f = fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (fgets(line, sizeof(line), f)) {
+            if (!strncmp(line, "VmHWM:", 6)) {
+                peak = strtoull(line + 6, nullptr, 10);
+            }
+        }
+        fclose(f);
+    }
+    return peak;
+}
+
+struct StageResult
+{
+    std::string stage;
+    uint64_t events = 0;
+    uint64_t fileBytes = 0;
+    double seconds = 0;
+    uint64_t allocations = 0;
+    uint64_t peakRssKb = 0;
+};
+
+// Time and allocations of the measured part of one run.
+struct Measurement
+{
+    double seconds = 0;
+    uint64_t allocations = 0;
+
+    void Add(Clock::time_point start, uint64_t allocationsBefore)
+    {
+        seconds += Seconds(start, Clock::now());
+        allocations += g_allocations.load(std::memory_order_relaxed) - allocationsBefore;
+    }
+};
+
+class NullHandler : public TapHandler
+{
+};
+
+// Transformation only: rows are converted into bind arrays but not sent.
+class NullBindSink : public ArrayBindSink
+{
+public:
+    explicit NullBindSink(size_t batchSize) : ArrayBindSink(batchSize) {}
+
+    void BeginFile(const FileInfo&) override {}
+    void WriteAuditTotals(const AuditTotals&) override {}
+    void CommitFile() override { Flush(); }
+    void RollbackFile() override { Discard(); }
+
+protected:
+    void ExecuteArray(const BindBuffer&) override {}
+    void ExecuteChargeArray(const ChargeColumns&, size_t, size_t) override {}
+    void ExecuteTaxArray(const TaxColumns&, size_t, size_t) override {}
+};
+
+// Forwards to a sink and measures only the time spent inside it, so the
+// decode feeding it is excluded.
+class TimedSink : public EventSink
+{
+public:
+    TimedSink(EventSink& sink, Measurement& measurement) : m_sink(sink), m_measurement(measurement) {}
+
+    void BeginFile(const FileInfo& file) override { Timed([&] { m_sink.BeginFile(file); }); }
+    void WriteEvents(const EventBatch& batch) override { Timed([&] { m_sink.WriteEvents(batch); }); }
+    void WriteAuditTotals(const AuditTotals& totals) override { Timed([&] { m_sink.WriteAuditTotals(totals); }); }
+    void CommitFile() override { Timed([&] { m_sink.CommitFile(); }); }
+    void RollbackFile() override { m_sink.RollbackFile(); }
+
+private:
+    template <typename F>
+    void Timed(F call)
+    {
+        uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+        Clock::time_point start = Clock::now();
+        call();
+        m_measurement.Add(start, allocations);
+    }
+
+    EventSink& m_sink;
+    Measurement& m_measurement;
+};
+
+struct BenchmarkSettings
+{
+    std::vector<uint64_t> sizes { 1000, 100000, 5000000 };
+    size_t threads = std::thread::hardware_concurrency();
+    size_t sinkBatchSize = 10000;
+    int repeats = 1;
+    std::string workDirectory = "/tmp";
+    std::string output = "benchmark.json";
+    bool reuseFiles = false;
+};
+
+class Benchmark
+{
+public:
+    explicit Benchmark(const BenchmarkSettings& settings) : m_settings(settings) {}
+
+    void Run()
+    {
+        for (uint64_t size : m_settings.sizes) {
+            std::string path = m_settings.workDirectory + "/tap3bench_" + std::to_string(size) + ".tap";
+            struct stat st;
+            if (!m_settings.reuseFiles || stat(path.c_str(), &st) != 0) {
+                GeneratorSettings generator;
+                generator.recordCount = size;
+                GenerateTapFile(path, generator);
+            }
+            RunStages(path, size);
+        }
+    }
+
+    void WriteJson(const std::string& path) const
+    {
+        std::ofstream out(path);
+        out << "{\n  \"threads\": " << m_settings.threads
+            << ",\n  \"sink_batch_size\": " << m_settings.sinkBatchSize
+            << ",\n  \"repeats\": " << m_settings.repeats
+            << ",\n  \"number_kernel\": \"" << NumberKernelName() << "\""
+            << ",\n  \"results\": [";
+        for (size_t i = 0; i < m_results.size(); i++) {
+            const StageResult& r = m_results[i];
+            char line[512];
+            snprintf(line, sizeof(line),
+                "%s\n    {\"stage\": \"%s\", \"events\": %llu, \"file_bytes\": %llu, \"seconds\": %.6f, "
+                "\"events_per_sec\": %.1f, \"mb_per_sec\": %.2f, \"peak_rss_kb\": %llu, "
+                "\"allocations_per_event\": %.4f}",
+                i > 0 ? "," : "", r.stage.c_str(), static_cast<unsigned long long>(r.events),
+                static_cast<unsigned long long>(r.fileBytes), r.seconds, EventsPerSecond(r), MbPerSecond(r),
+                static_cast<unsigned long long>(r.peakRssKb), AllocationsPerEvent(r));
+            out << line;
+        }
+        out << "\n  ]\n}\n";
+        if (!out) {
+            throw Tap3Error("Unable to write " + path);
+        }
+    }
+
+private:
+    static double EventsPerSecond(const StageResult& r) { return r.seconds > 0 ? r.events / r.seconds : 0; }
+    static double MbPerSecond(const StageResult& r) { return r.seconds > 0 ? r.fileBytes / r.seconds / 1e6 : 0; }
+    static double AllocationsPerEvent(const StageResult& r)
+    {
+        return r.events > 0 ? static_cast<double>(r.allocations) / r.events : 0;
+    }
+
+    // Runs stage repeats times and keeps the fastest run.
+    template <typename F>
+    void Stage(const char* name, const std::string& path, uint64_t events, F run)
+    {
+        struct stat st;
+        stat(path.c_str(), &st);
+        StageResult best;
+        for (int i = 0; i < std::max(m_settings.repeats, 1); i++) {
+            ResetPeakRss();
+            Measurement measurement = run();
+            if (i == 0 || measurement.seconds < best.seconds) {
+                best.seconds = measurement.seconds;
+                best.allocations = measurement.allocations;
+            }
+            best.peakRssKb = std::max(best.peakRssKb, PeakRssKb());
+        }
+        best.stage = name;
+        best.events = events;
+        best.fileBytes = static_cast<uint64_t>(st.st_size);
+        m_results.push_back(best);
+        printf("%-10llu %-11s %10.3f s %14.0f ev/s %10.1f MB/s %10llu kB %8.3f alloc/ev\n",
+            static_cast<unsigned long long>(events), name, best.seconds, EventsPerSecond(best),
+            MbPerSecond(best), static_cast<unsigned long long>(best.peakRssKb), AllocationsPerEvent(best));
+        fflush(stdout);
+    }
+
+    void RunStages(const std::string& path, uint64_t events)
+    {
+        TapDecoder decoder(m_settings.threads);
+        decoder.SetAuditValidation(false);
+        std::string database = m_settings.workDirectory + "/tap3bench.db";
+
+        Stage("validation", path, events, [&] {
+            MappedFile file(path);
+            Measurement measurement;
+            uint64_t allocations = g_allocations.load();
+            Clock::time_point start = Clock::now();
+            PreValidate(file.View());
+            measurement.Add(start, allocations);
+            return measurement;
+        });
+        Stage("decode", path, events, [&] {
+            MappedFile file(path);
+            NullHandler handler;
+            Measurement measurement;
+            uint64_t allocations = g_allocations.load();
+            Clock::time_point start = Clock::now();
+            decoder.Decode(file.View(), handler);
+            measurement.Add(start, allocations);
+            decoder.ReleaseArenas();
+            return measurement;
+        });
+        Stage("transform", path, events, [&] {
+            Measurement measurement;
+            NullBindSink sink(m_settings.sinkBatchSize);
+            TimedSink timed(sink, measurement);
+            Load(path, timed);
+            return measurement;
+        });
+        Stage("sink", path, events, [&] {
+            Measurement measurement;
+            RemoveDatabase(database);
+            SqliteSink sink(database, m_settings.sinkBatchSize);
+            TimedSink timed(sink, measurement);
+            Load(path, timed);
+            return measurement;
+        });
+        Stage("end_to_end", path, events, [&] {
+            Measurement measurement;
+            RemoveDatabase(database);
+            uint64_t allocations = g_allocations.load();
+            Clock::time_point start = Clock::now();
+            SqliteSink sink(database, m_settings.sinkBatchSize);
+            Load(path, sink);
+            measurement.Add(start, allocations);
+            return measurement;
+        });
+        RemoveDatabase(database);
+    }
+
+    void Load(const std::string& path, EventSink& sink)
+    {
+        LoaderSettings settings;
+        settings.decodeThreads = m_settings.threads;
+        TapLoader loader(settings);
+        loader.LoadFile(path, sink);
+    }
+
+    static void RemoveDatabase(const std::string& path)
+    {
+        unlink(path.c_str());
+        unlink((path + "-wal").c_str());
+        unlink((path + "-shm").c_str());
+    }
+
+    BenchmarkSettings m_settings;
+    std::vector<StageResult> m_results;
+};
+
+std::vector<uint64_t> ParseSizes(const char* text)
+{
+    std::vector<uint64_t> sizes;
+    while (*text) {
+        char* end;
+        sizes.push_back(strtoull(text, &end, 10));
+        text = *end == ',' ? end + 1 : end;
+        if (end == text && *text) {
+            break;
+        }
+    }
+    return sizes;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    BenchmarkSettings settings;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            settings.sizes = ParseSizes(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            settings.threads = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            settings.sinkBatchSize = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            settings.repeats = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            settings.workDirectory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            settings.output = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--reuse")) {
+            settings.reuseFiles = true;
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [-n sizes, default 1000,100000,5000000] [-t threads]"
+                " [-b sink-batch-size] [-r repeats] [-w work-dir] [-o results.json] [--reuse]" << std::endl;
+            return 1;
+        }
+    }
+    try {
+        Benchmark benchmark(settings);
+        benchmark.Run();
+        benchmark.WriteJson(settings.output);
+        std::cout << "Results written to " << settings.output << std::endl;
+    }
+    catch (const Tap3Error& ex) {
+        std::cerr << ex.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
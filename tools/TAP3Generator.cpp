@@ -0,0 +1,125 @@
+// Synthetic TAP file generator for load tests and benchmarks. Built from
+// the loader sources, all of src/ except TAP3Loader.cpp:
+//   g++ -std=c++17 -O2 -pthread -I../src -o TAP3Generator TAP3Generator.cpp
+//       $(ls ../src/*.cpp | grep -v TAP3Loader.cpp) -lsqlite3 -lz
+// adding -lzstd when <zstd.h> is installed (zstd input is compiled in then).
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "Tap3Error.h"
+#include "TapGenerator.h"
+
+using namespace tap3;
+
+namespace {
+
+// Parses "a:b:c..." into count unsigned values; false on a malformed list.
+bool ParseList(const char* text, uint32_t* values, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        char* end;
+        unsigned long value = strtoul(text, &end, 10);
+        if (end == text || (i + 1 < count ? *end != ':' : *end != '\0')) {
+            return false;
+        }
+        values[i] = static_cast<uint32_t>(value);
+        text = end + 1;
+    }
+    return true;
+}
+
+void Usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [-n records] [-s seed] [-r 11|12]"
+        " [-m moc:mtc:gprs:sms:session] [-c min:max charge details] [-k camel-percent]"
+        " [-T utc:recentity:exchange:tax codes] [-u subscribers] [-D days]"
+        " [-S sender] [-R recipient] [-f file-sequence] <output file>" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    GeneratorSettings settings;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            settings.recordCount = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            settings.seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            settings.releaseVersionNumber = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+            uint32_t mix[5];
+            ok = ParseList(argv[++i], mix, 5);
+            settings.mocWeight = mix[0];
+            settings.mtcWeight = mix[1];
+            settings.gprsWeight = mix[2];
+            settings.smsWeight = mix[3];
+            settings.sessionWeight = mix[4];
+        }
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            uint32_t range[2];
+            ok = ParseList(argv[++i], range, 2);
+            settings.minChargeDetails = range[0];
+            settings.maxChargeDetails = range[1];
+        }
+        else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+            settings.camelPercent = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "-T") && i + 1 < argc) {
+            uint32_t codes[4];
+            ok = ParseList(argv[++i], codes, 4);
+            settings.utcOffsetCodes = codes[0];
+            settings.recEntityCodes = codes[1];
+            settings.exchangeRateCodes = codes[2];
+            settings.taxCodes = codes[3];
+        }
+        else if (!strcmp(argv[i], "-u") && i + 1 < argc) {
+            settings.subscriberCount = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "-D") && i + 1 < argc) {
+            settings.days = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "-S") && i + 1 < argc) {
+            settings.sender = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-R") && i + 1 < argc) {
+            settings.recipient = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            settings.fileSequenceNumber = argv[++i];
+        }
+        else if (argv[i][0] == '-' || path) {
+            // an unknown option, one without its value, or a second path
+            ok = false;
+        }
+        else {
+            path = argv[i];
+        }
+        if (!ok) {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!path) {
+        Usage(argv[0]);
+        return 1;
+    }
+    try {
+        GeneratorResult result = GenerateTapFile(path, settings);
+        std::cout << path << ": " << result.recordCount << " records, " << result.fileSize
+            << " bytes, total charge " << result.totalCharge << std::endl;
+    }
+    catch (const Tap3Error& ex) {
+        std::cerr << path << ": " << ex.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}